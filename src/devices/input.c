@@ -1,16 +1,30 @@
 #include "devices/input.h"
 #include <debug.h>
+#include <list.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/synch.h"
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* A thread sleeping in input_wait(). */
+struct input_waiter 
+  {
+    struct list_elem elem;      /* Element in `waiters'. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+  };
+
+/* Threads sleeping in input_wait().  Only accessed with
+   interrupts off. */
+static struct list waiters;
+
 /* Initializes the input buffer. */
 void
 input_init (void) 
 {
   intq_init (&buffer);
+  list_init (&waiters);
 }
 
 /* Adds a key to the input buffer.
@@ -23,6 +37,7 @@ input_putc (uint8_t key)
 
   intq_putc (&buffer, key);
   serial_notify ();
+  input_wake_waiters ();
 }
 
 /* Retrieves a key from the input buffer.
@@ -41,6 +56,46 @@ input_getc (void)
   return key;
 }
 
+/* Sleeps until a key is added to the input buffer or
+   input_wake_waiters() is called.  Unlike input_getc(), takes
+   no key, so callers that wait for something else as well must
+   check the buffer again on return.  Any number of threads may
+   wait at once.  Interrupts must be off. */
+void
+input_wait (void) 
+{
+  struct input_waiter w;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!intr_context ());
+
+  sema_init (&w.sema, 0);
+  list_push_back (&waiters, &w.elem);
+  sema_down (&w.sema);
+}
+
+/* Wakes every thread sleeping in input_wait().  May be called
+   from an external interrupt handler. */
+void
+input_wake_waiters (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  while (!list_empty (&waiters))
+    sema_up (&list_entry (list_pop_front (&waiters),
+                          struct input_waiter, elem)->sema);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the input buffer is empty, so that
+   input_getc() would wait, false otherwise.
+   Interrupts must be off. */
+bool
+input_empty (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return intq_empty (&buffer);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -7,6 +7,9 @@
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+void input_wait (void);
+void input_wake_waiters (void);
+bool input_empty (void);
 bool input_full (void);
 
 #endif /* devices/input.h */
@@ -16,6 +16,11 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
+  /* Clone the file, sharing its blocks instead of copying them,
+     if the file system can. */
+  if (reflink (argv[1], argv[2]))
+    return EXIT_SUCCESS;
+
   /* Open input file. */
   in_fd = open (argv[1]);
   if (in_fd < 0) 
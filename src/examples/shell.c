@@ -3,8 +3,12 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -44,6 +50,73 @@ main (void)
   return EXIT_SUCCESS;
 }
 
+/* Runs each of the `|'-separated commands in COMMAND at once,
+   with the output of each one fed to the input of the next
+   through a pipe, then waits for them all. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  char *stage, *save_ptr;
+  int stage_cnt = 0;
+  int in = -1;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr)) 
+    {
+      char *end = stage + strlen (stage);
+
+      while (*stage == ' ')
+        stage++;
+      while (end > stage && end[-1] == ' ')
+        *--end = '\0';
+      if (stage_cnt >= MAX_STAGES) 
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = stage;
+    }
+
+  /* Start each command with its standard input and output
+     redirected to the pipes that connect it to its neighbors.
+     The children inherit the redirection, and closing our own
+     descriptors afterward restores the console. */
+  for (i = 0; i < stage_cnt; i++) 
+    {
+      int fds[2] = { -1, -1 };
+
+      if (i + 1 < stage_cnt && !pipe (fds)) 
+        {
+          printf ("pipe failed\n");
+          stage_cnt = i;
+          break;
+        }
+      if (in >= 0)
+        dup2 (in, STDIN_FILENO);
+      if (fds[1] >= 0)
+        dup2 (fds[1], STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+      close (STDIN_FILENO);
+      close (STDOUT_FILENO);
+      if (in >= 0)
+        close (in);
+      if (fds[1] >= 0)
+        close (fds[1]);
+      in = fds[0];
+    }
+  if (in >= 0)
+    close (in);
+
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -1,7 +1,7 @@
 /* cache.c */
 
 #include "filesys/cache.h"
-#include <hash.h>
+#include <ohash.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <bitmap.h>
@@ -22,7 +22,6 @@
 
 struct cache_entry
 {
-   struct hash_elem hash_elem; /* Each cache_entry is an element in the buffer_cache hash table */
    struct list_elem list_elem; /* Member in lru list */
    block_sector_t sector;      /* The key is block_sector_t and the data returned is data */
    void * data;                /* Actual data read from the block */
@@ -30,19 +29,23 @@ struct cache_entry
    bool dirty;                 /* Indicates if this entry was modified */
 };
 
-struct hash buffer_cache;
+struct ohash buffer_cache;     /* Maps sector number to cache_entry */
 struct list lru;	       /* Used for evicting LRU cache line */	
 struct list_elem * update_lru (struct cache_entry *e, bool insert);
+static void cache_discard (struct cache_entry *e);
 
 int entries_in_cache = 0;
 int disk_access = 0;	       /* Used for measuring performance improvement due to cache */	
 int total_access = 0;
+long long cache_hits = 0;      /* Reads and writes that found their sector cached */
+long long cache_misses = 0;    /* Reads and writes that did not */
 int64_t time = 0;
 
 void buffer_cache_init (void)  		  
 {
    /* Hash Table Initialization */
-   hash_init (&buffer_cache, block_hash, block_less, NULL);
+   if (!ohash_init (&buffer_cache, CACHE_SIZE))
+     PANIC ("buffer cache table allocation failed");
    list_init (&lru);
    time = timer_ticks ();      /* Get current time */
 }
@@ -93,6 +96,82 @@ int block_cache_write_partial (struct block * block, block_sector_t sector,
    return rc;
 }
 
+/* Reads SECTOR into BUFFER without caching it.  A cached copy,
+   which may be newer than the disk's, is used if there is one */
+void block_cache_read_uncached (struct block *block, block_sector_t sector,
+          void *buffer)
+{
+   struct cache_entry *found = cache_lookup (sector);
+   total_access++;
+   timer_update();
+   if (found)
+     {
+	memcpy (buffer, found->data, BLOCK_SECTOR_SIZE);
+     }
+   else
+     {
+	block_read (block, sector, buffer);
+	disk_access++;
+     }
+}
+
+/* Writes BUFFER to SECTOR on disk without caching it.  A cached
+   copy is dropped without being written back, since BUFFER
+   supersedes it */
+void block_cache_write_uncached (struct block *block, block_sector_t sector,
+          const void *buffer)
+{
+   struct cache_entry *found = cache_lookup (sector);
+   total_access++;
+   timer_update();
+   if (found)
+     {
+	cache_discard (found);
+     }
+   block_write (block, sector, buffer);
+   disk_access++;
+}
+
+/* Reads CNT sectors starting at SECTOR straight from disk into
+   BUFFER in a single request, without caching them.  Sectors
+   that are cached are copied from the cache instead, since their
+   cached copies may be newer */
+void block_cache_read_uncached_multiple (struct block *block,
+          block_sector_t sector, size_t cnt, void *buffer)
+{
+   uint8_t *dst = buffer;
+   size_t i;
+   total_access += cnt;
+   timer_update();
+   block_read_multiple (block, sector, cnt, buffer);
+   disk_access++;
+   for (i = 0; i < cnt; i++)
+     {
+	struct cache_entry *found = cache_lookup (sector + i);
+	if (found)
+	  memcpy (dst + i * BLOCK_SECTOR_SIZE, found->data, BLOCK_SECTOR_SIZE);
+     }
+}
+
+/* Writes CNT sectors from BUFFER to disk starting at SECTOR in a
+   single request, without caching them.  Cached copies are
+   dropped without being written back */
+void block_cache_write_uncached_multiple (struct block *block,
+          block_sector_t sector, size_t cnt, const void *buffer)
+{
+   size_t i;
+   total_access += cnt;
+   timer_update();
+   for (i = 0; i < cnt; i++)
+     {
+	struct cache_entry *found = cache_lookup (sector + i);
+	if (found)
+	  cache_discard (found);
+     }
+   block_write_multiple (block, sector, cnt, buffer);
+   disk_access++;
+}
+
 int cache_insert (struct block *block, block_sector_t sector, void *buffer, enum access_t access)
 {
    struct cache_entry *buf = malloc (sizeof(struct cache_entry));	
@@ -105,6 +184,7 @@ int cache_insert (struct block *block, block_sector_t sector, void *buffer, enum
      }
    else				/* Read from disk and populate cache */
      {			      
+       buf->dirty = false;
        block_read (block_get_role (BLOCK_FILESYS), sector, buf->data); 
        disk_access++;
        memcpy (buffer, buf->data, BLOCK_SECTOR_SIZE);
@@ -114,7 +194,11 @@ int cache_insert (struct block *block, block_sector_t sector, void *buffer, enum
      {
        cache_evict (full);
      }
-   hash_insert (&buffer_cache, &buf->hash_elem);
+   /* The table has room for CACHE_SIZE entries without growing,
+      eviction keeps it within that, and SECTOR was not cached, so
+      this cannot fail. */
+   if (!ohash_insert (&buffer_cache, sector, buf))
+     NOT_REACHED ();
    entries_in_cache++;
    return SUCCESS;
 }
@@ -126,6 +210,7 @@ int cache_read (struct block *block, block_sector_t sector, void *buffer)
    struct cache_entry *found = cache_lookup (sector);
    if (found)
      {
+	cache_hits++;
 	found->accessed = true;
 	memcpy (buffer, found->data, BLOCK_SECTOR_SIZE);
 	/* Update corresponding item in lru list */
@@ -134,6 +219,7 @@ int cache_read (struct block *block, block_sector_t sector, void *buffer)
      }
    else
      {
+	cache_misses++;
 	return (cache_insert (block, sector, buffer, READ));
      }
 }
@@ -146,17 +232,17 @@ int cache_write (struct block *block, block_sector_t sector, const void *buffer)
    struct cache_entry *found = cache_lookup (sector);
    if (found)
      {
+	cache_hits++;
 	found->dirty = true;
 	found->accessed = true;
 	memcpy (found->data, buffer, BLOCK_SECTOR_SIZE);
 	/* TODO: Synch call to hash access so only one person can modify cache AND lru list */
-	/* Update Hash Table */
-	struct hash_elem *old = hash_replace (&buffer_cache, &found->hash_elem); 
 	update_lru (found, false);
 	return SUCCESS;
      }
    else 
      {
+	cache_misses++;
 	return cache_insert (block, sector, buffer, WRITE);	
      }
 }
@@ -171,11 +257,11 @@ void cache_evict (struct list_elem *e)
           {
      	    block_write (block_get_role (BLOCK_FILESYS), lru_entry->sector, lru_entry->data); 
 	    disk_access++;
-	    free (lru_entry->data);
-	    lru_entry->data = NULL;
    	  }
+        free (lru_entry->data);
+        lru_entry->data = NULL;
         /* Delete line from buffer_cache */ 	
-        hash_delete (&buffer_cache, &lru_entry->hash_elem);
+        ohash_delete (&buffer_cache, lru_entry->sector);
 	/* Free resources */
         free (lru_entry);			
 	lru_entry = NULL;
@@ -184,11 +270,34 @@ void cache_evict (struct list_elem *e)
      }
 }
 
+/* Removes entry E from the cache without writing it back */
+static void cache_discard (struct cache_entry *e)
+{
+   list_remove (&e->list_elem);
+   ohash_delete (&buffer_cache, e->sector);
+   free (e->data);
+   free (e);
+   entries_in_cache--;
+}
+
 bool cache_is_full (void)
 {
    return (entries_in_cache >= CACHE_SIZE);
 }
 
+/* Stores the number of cache hits and misses so far */
+void cache_get_stats (long long *hits, long long *misses)
+{
+   *hits = cache_hits;
+   *misses = cache_misses;
+}
+
+/* Prints cache statistics */
+void cache_print_stats (void)
+{
+   printf ("Buffer cache: %lld hits, %lld misses\n", cache_hits, cache_misses);
+}
+
 /* Called periodically (every 30 seconds) by timer interrupt event */
 void cache_flush (void)
 {
@@ -238,29 +347,10 @@ struct list_elem * update_lru (struct cache_entry *e, bool insert)
      }
 }
 
-/* HASH TABLE ACCESSES FOR BUFFER CACHE - Basic hash table manipulation from Pintos Reference Doc */
-                                      
-unsigned block_hash (const struct hash_elem *p_, void *aux UNUSED)
-{
-   const struct cache_entry *p = hash_entry (p_, struct cache_entry, hash_elem);
-   return hash_bytes (&p->sector, sizeof p->sector);
-}
-
-bool block_less (const struct hash_elem *a_, const struct hash_elem *b_,
-                void *aux UNUSED)
-{
-   const struct cache_entry *a = hash_entry (a_, struct cache_entry, hash_elem);
-   const struct cache_entry *b = hash_entry (b_, struct cache_entry, hash_elem);
-
-   return a->sector < b->sector;
-}
+/* HASH TABLE ACCESSES FOR BUFFER CACHE - keyed directly by sector number */
 
 struct cache_entry * cache_lookup (block_sector_t sector)
 {
-   struct cache_entry p;
-   struct hash_elem *e;
-   p.sector = sector;
-   e = hash_find (&buffer_cache, &p.hash_elem);
-   return e != NULL ? hash_entry (e, struct cache_entry, hash_elem) : NULL;
+   return ohash_find (&buffer_cache, sector);
 }
 
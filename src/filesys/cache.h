@@ -1,7 +1,8 @@
 /* cache.h */
 #ifndef CACHE_H
 #define CACHE_H
-#include <hash.h>
+#include <list.h>
+#include <ohash.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include "threads/malloc.h"
@@ -10,7 +11,7 @@
 #include <string.h>
 #define SUCCESS 1
 #define FAILURE 0
-struct hash buffer_cache;
+struct ohash buffer_cache;
 
 enum access_t
 {
@@ -24,6 +25,14 @@ int block_cache_read_partial (struct block *block, block_sector_t sector,
 int block_cache_write (struct block *block, block_sector_t sector, const void *buffer);
 int block_cache_write_partial (struct block * block, block_sector_t sector,
           void *buffer, int ofs, int chunk_size);
+void block_cache_read_uncached (struct block *block, block_sector_t sector,
+          void *buffer);
+void block_cache_write_uncached (struct block *block, block_sector_t sector,
+          const void *buffer);
+void block_cache_read_uncached_multiple (struct block *block,
+          block_sector_t sector, size_t cnt, void *buffer);
+void block_cache_write_uncached_multiple (struct block *block,
+          block_sector_t sector, size_t cnt, const void *buffer);
 int cache_insert (struct block *block, block_sector_t sector, void *buffer, enum access_t);
 int cache_read (struct block *block, block_sector_t sector, void *buffer);
 int cache_write (struct block *block, block_sector_t sector, const void *buffer);
@@ -31,9 +40,9 @@ bool cache_is_full(void);
 void cache_flush (void);
 void cache_evict (struct list_elem *e);
 
-unsigned block_hash (const struct hash_elem *p_, void *aux UNUSED);
-bool block_less (const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED);
 struct cache_entry * cache_lookup (block_sector_t sector);
 void timer_update (void);
+void cache_get_stats (long long *hits, long long *misses);
+void cache_print_stats (void);
 
 #endif
@@ -9,6 +9,7 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    bool direct;                /* Bypass the buffer cache? */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -23,6 +24,7 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->direct = false;
       return file;
     }
   else
@@ -68,7 +70,7 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read = file_read_at (file, buffer, size, file->pos);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -81,6 +83,8 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) 
 {
+  if (file->direct)
+    return inode_read_uncached (file->inode, buffer, size, file_ofs);
   return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -94,7 +98,7 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written = file_write_at (file, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -110,6 +114,8 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
+  if (file->direct)
+    return inode_write_uncached (file->inode, buffer, size, file_ofs);
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -148,6 +154,65 @@ file_length (struct file *file)
   return inode_length (file->inode);
 }
 
+/* Sets the size of FILE to LENGTH bytes, freeing the space past
+   the new end if it shrinks.  The file's current position is
+   unaffected.  Returns true if successful, false otherwise. */
+bool
+file_truncate (struct file *file, off_t length) 
+{
+  ASSERT (file != NULL);
+  return inode_truncate (file->inode, length);
+}
+
+/* Reserves disk space for bytes OFFSET through OFFSET + LEN - 1
+   of FILE, growing it if necessary, without writing the data.
+   Returns true if successful, false otherwise. */
+bool
+file_allocate (struct file *file, off_t offset, off_t len) 
+{
+  ASSERT (file != NULL);
+  return inode_allocate (file->inode, offset, len);
+}
+
+/* Makes reads and writes of whole sectors through FILE bypass
+   the buffer cache if DIRECT is true, or use it (the default)
+   if DIRECT is false.  Suits large streaming transfers, which
+   would otherwise evict everything else from the cache. */
+void
+file_set_direct (struct file *file, bool direct) 
+{
+  ASSERT (file != NULL);
+  file->direct = direct;
+}
+
+/* Makes FILE store its data compressed if COMPRESSED is true, or
+   uncompressed if it is false.  Unlike direct I/O, this is a
+   property of the file rather than of FILE, and it can only be
+   changed while the file is empty.  Returns true if successful,
+   false otherwise. */
+bool
+file_set_compressed (struct file *file, bool compressed) 
+{
+  ASSERT (file != NULL);
+  return inode_set_compressed (file->inode, compressed);
+}
+
+/* Returns true if FILE's data is stored compressed. */
+bool
+file_is_compressed (struct file *file) 
+{
+  ASSERT (file != NULL);
+  return inode_is_compressed (file->inode);
+}
+
+/* Returns true if FILE bypasses the buffer cache. */
+bool
+file_is_direct (struct file *file) 
+{
+  ASSERT (file != NULL);
+  return file->direct;
+}
+
 /* Sets the current position in FILE to NEW_POS bytes from the
    start of the file. */
 void
@@ -1,18 +1,27 @@
 #include "filesys/filesys.h"
 #include <debug.h>
+#include <ohash.h>
 #include <stdio.h>
 #include <string.h>
 #include "filesys/file.h"
 #include "filesys/free-map.h"
+#include "filesys/refcount.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/cache.h"
 /* Partition that contains the file system. */
 struct block *fs_device;
+
+/* Sectors per block.  Set before formatting to choose the block
+   size of the new file system, or read from disk otherwise. */
+size_t fs_block_sectors = 1;
 bool
 filesys_create_dir (struct dir *cur_dir, const char *name, off_t initial_size);
 
 static void do_format (void);
+static void read_block_sectors (void);
+static void abandon_inode (block_sector_t, bool created);
+static bool defrag_sector (block_sector_t);
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
 void
@@ -24,12 +33,16 @@ filesys_init (bool format)
 
   buffer_cache_init ();
   inode_init ();
+  if (!format)
+    read_block_sectors ();
   free_map_init ();
+  refcount_init ();
 
   if (format) 
     do_format ();
 
   free_map_open ();
+  refcount_open ();
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -37,9 +50,18 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
-  cache_flush();
+  filesys_flush ();
+  refcount_close ();
   free_map_close ();
 }
+
+/* Writes all modified file system data to disk. */
+void
+filesys_flush (void) 
+{
+  inode_flush ();
+  cache_flush ();
+}
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
@@ -50,12 +72,13 @@ filesys_create (const char *name, off_t initial_size)
 {
   block_sector_t inode_sector = 0;
   struct dir *dir = dir_open_root ();
+  bool created = false;
   bool success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
+                  && (created = inode_create (inode_sector, initial_size))
                   && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
+    abandon_inode (inode_sector, created);
   dir_close (dir);
 
   return success;
@@ -74,12 +97,13 @@ filesys_create_dir (struct dir *cur_dir, const char *name, off_t initial_size)
     {
        dir = dir_open_root ();
     }
+  bool created = false;
   bool success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
+                  && (created = inode_create (inode_sector, initial_size))
                   && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0)
-    free_map_release (inode_sector, 1);
+    abandon_inode (inode_sector, created);
   dir_close (dir);
 
   return success;
@@ -135,12 +159,178 @@ filesys_remove (const char *name)
   return success;
 }
 
-/* Formats the file system. */
+/* Creates a file named NEW_NAME that is a copy of the file
+   named NAME.  The copy shares NAME's data blocks, which are
+   copied only when one of the two files writes to them, so
+   cloning takes time and space in proportion to the size of
+   NAME's block map rather than its data.
+   Returns true if successful, false on failure.
+   Fails if no file named NAME exists, if a file named NEW_NAME
+   already exists, or if memory or disk allocation fails. */
+bool
+filesys_clone (const char *name, const char *new_name) 
+{
+  block_sector_t inode_sector = 0;
+  struct dir *dir = dir_open_root ();
+  struct inode *inode = NULL;
+  bool created = false;
+  bool success = (dir != NULL
+                  && dir_lookup (dir, name, &inode)
+                  && free_map_allocate (1, &inode_sector)
+                  && (created = inode_clone (inode, inode_sector))
+                  && dir_add (dir, new_name, inode_sector));
+  if (!success && inode_sector != 0) 
+    abandon_inode (inode_sector, created);
+  inode_close (inode);
+  dir_close (dir);
+
+  return success;
+}
+
+/* Defragments the file named NAME, or if NAME is a null pointer,
+   every file including the free map and the root directory.
+   Each file's blocks are moved into a single run of sectors
+   (see inode_defrag()).  Defragmenting every file also compacts
+   free space toward the end of the disk, by moving files into
+   earlier free runs until none fits any more.
+   Returns the number of moves made, which may count a file more
+   than once, or -1 if no file named NAME exists.  The caller
+   must keep the files from being written meanwhile. */
+int
+filesys_defrag (const char *name) 
+{
+  struct dir *dir = dir_open_root ();
+  struct inode *inode;
+  int moved = 0;
+  int before;
+
+  if (dir == NULL)
+    return -1;
+  if (name != NULL)
+    {
+      if (dir_lookup (dir, name, &inode))
+        {
+          moved = inode_defrag (inode);
+          inode_close (inode);
+        }
+      else
+        moved = -1;
+      dir_close (dir);
+      return moved;
+    }
+
+  /* Every move either joins a fragmented file into one run or
+     brings a file closer to the start of the disk, so this
+     terminates. */
+  do
+    {
+      struct dir *pass = dir_reopen (dir);
+      char entry[NAME_MAX + 1];
+
+      before = moved;
+      moved += defrag_sector (FREE_MAP_SECTOR);
+      moved += defrag_sector (ROOT_DIR_SECTOR);
+      moved += defrag_sector (REFCOUNT_SECTOR);
+      while (pass != NULL && dir_readdir (pass, entry))
+        if (dir_lookup (pass, entry, &inode))
+          {
+            moved += inode_defrag (inode);
+            inode_close (inode);
+          }
+      dir_close (pass);
+    }
+  while (moved > before);
+  dir_close (dir);
+  return moved;
+}
+
+/* Defragments the inode in SECTOR.  Returns true if it moved. */
+static bool
+defrag_sector (block_sector_t sector) 
+{
+  struct inode *inode = inode_open (sector);
+  bool moved = inode != NULL && inode_defrag (inode);
+
+  inode_close (inode);
+  return moved;
+}
+
+/* Makes identical data blocks of the files in the root
+   directory share a single sector, freeing the others, as
+   clones do (see inode_dedup()).  Returns the number of blocks
+   that were merged, or -1 if memory runs out. */
+int
+filesys_dedup (void) 
+{
+  struct dir *dir = dir_open_root ();
+  struct ohash index;
+  struct inode *inode;
+  char entry[NAME_MAX + 1];
+  int merged = 0;
+
+  if (dir == NULL)
+    return -1;
+  if (!ohash_init (&index, 0))
+    {
+      dir_close (dir);
+      return -1;
+    }
+  while (dir_readdir (dir, entry))
+    if (dir_lookup (dir, entry, &inode))
+      {
+        merged += inode_dedup (inode, &index);
+        inode_close (inode);
+      }
+  ohash_destroy (&index);
+  dir_close (dir);
+  return merged;
+}
+
+/* Frees inode SECTOR, which was allocated for a file that could
+   not be created after all.  If CREATED is true, the inode was
+   written to disk along with its data blocks, which are freed
+   too. */
+static void
+abandon_inode (block_sector_t sector, bool created)
+{
+  if (created)
+    {
+      struct inode *inode = inode_open (sector);
+      if (inode != NULL)
+        {
+          inode_remove (inode);
+          inode_close (inode);
+        }
+    }
+  else
+    free_map_release (sector, 1);
+}
+
+/* Sets fs_block_sectors to the block size that the file system
+   was formatted with, which the free map's inode records. */
+static void
+read_block_sectors (void)
+{
+  struct inode *inode = inode_open (FREE_MAP_SECTOR);
+
+  if (inode == NULL)
+    PANIC ("can't open free map");
+  fs_block_sectors = inode_block_sectors (inode);
+  inode_close (inode);
+  if (fs_block_sectors > MAX_BLOCK_SECTORS)
+    PANIC ("file system has unsupported block size of %zu sectors",
+           fs_block_sectors);
+}
+
+/* Formats the file system with blocks of fs_block_sectors
+   sectors. */
 static void
 do_format (void)
 {
+  ASSERT (fs_block_sectors >= 1 && fs_block_sectors <= MAX_BLOCK_SECTORS);
   printf ("Formatting file system...");
   free_map_create ();
+  refcount_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
@@ -2,20 +2,32 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 #include "filesys/directory.h"
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define REFCOUNT_SECTOR 2       /* Reference count file inode sector. */
 
 /* Block device that contains the file system. */
 struct block *fs_device;
 
+/* Sectors per block, the unit in which the file system allocates
+   disk space and maps file data.  Chosen when the file system is
+   formatted, from 1 to MAX_BLOCK_SECTORS. */
+#define MAX_BLOCK_SECTORS 8
+extern size_t fs_block_sectors;
+
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_flush (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+bool filesys_clone (const char *name, const char *new_name);
+int filesys_defrag (const char *name);
+int filesys_dedup (void);
 struct file *
 filesys_open_in_dir (const char *name, struct dir *d);
 
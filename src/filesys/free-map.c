@@ -6,47 +6,103 @@
 #include "filesys/inode.h"
 
 static struct file *free_map_file;   /* Free map file. */
-static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *free_map;      /* Free map, one bit per block. */
+static int batch_depth;              /* Nesting of free_map_begin_batch(). */
+static bool batch_dirty;             /* Changed since the batch began? */
 
-/* Initializes the free map. */
+/* Writes the free map to disk, or if a batch is in progress,
+   notes that it must be written when the batch ends.  Returns
+   false if the write fails. */
+static bool
+write_map (void)
+{
+  if (batch_depth > 0)
+    {
+      batch_dirty = true;
+      return true;
+    }
+  return bitmap_write (free_map, free_map_file);
+}
+
+/* Initializes the free map, which has a bit for each block of
+   fs_block_sectors sectors.  Sectors past the last whole block
+   are never used. */
 void
 free_map_init (void) 
 {
-  free_map = bitmap_create (block_size (fs_device));
+  free_map = bitmap_create (block_size (fs_device) / fs_block_sectors);
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
-  bitmap_mark (free_map, FREE_MAP_SECTOR);
-  bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_mark (free_map, FREE_MAP_SECTOR / fs_block_sectors);
+  bitmap_mark (free_map, ROOT_DIR_SECTOR / fs_block_sectors);
+  bitmap_mark (free_map, REFCOUNT_SECTOR / fs_block_sectors);
 }
 
-/* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+/* Allocates CNT consecutive blocks from the free map and stores
+   the first sector of the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
+   blocks were available or if the free_map file could not be
    written. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
+  size_t block = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  if (block != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !write_map ())
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      bitmap_set_multiple (free_map, block, cnt, false); 
+      block = BITMAP_ERROR;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
-  return sector != BITMAP_ERROR;
+  if (block != BITMAP_ERROR)
+    *sectorp = block * fs_block_sectors;
+  return block != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT blocks starting at the block whose first sector is
+   SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
-  ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  size_t block = sector / fs_block_sectors;
+
+  ASSERT (sector % fs_block_sectors == 0);
+  ASSERT (bitmap_all (free_map, block, cnt));
+  bitmap_set_multiple (free_map, block, cnt, false);
+  write_map ();
+}
+
+/* Starts a batch of free map updates.  Until the matching call
+   to free_map_end_batch(), allocations and releases change only
+   the in-memory free map, which is then written to disk once.
+   Batches may nest. */
+void
+free_map_begin_batch (void)
+{
+  batch_depth++;
+}
+
+/* Ends a batch of free map updates started by
+   free_map_begin_batch(), writing the free map to disk if the
+   outermost batch changed it. */
+void
+free_map_end_batch (void)
+{
+  ASSERT (batch_depth > 0);
+  if (--batch_depth == 0 && batch_dirty)
+    {
+      batch_dirty = false;
+      if (free_map_file != NULL)
+        bitmap_write (free_map, free_map_file);
+    }
+}
+
+/* Returns true if the block that contains SECTOR is marked in
+   use. */
+bool
+free_map_in_use (block_sector_t sector)
+{
+  return bitmap_test (free_map, sector / fs_block_sectors);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -65,6 +121,7 @@ void
 free_map_close (void) 
 {
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
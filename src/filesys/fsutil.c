@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,10 +8,15 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/layout.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Number of sectors that fsutil_extract() and fsutil_append()
+   move between the scratch device and a file at a time. */
+#define TRANSFER_SECTORS 128
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -67,7 +73,10 @@ fsutil_rm (char **argv)
 }
 
 /* Extracts a ustar-format tar archive from the scratch block
-   device into the Pintos file system. */
+   device into the Pintos file system.  Each file's space is
+   allocated in one contiguous run before its data is read from
+   the scratch device and written to the file, many sectors per
+   request in both directions, bypassing the buffer cache. */
 void
 fsutil_extract (char **argv UNUSED) 
 {
@@ -78,7 +87,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = malloc (TRANSFER_SECTORS * BLOCK_SECTOR_SIZE);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -116,20 +125,30 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
-          if (!filesys_create (file_name, size))
+          /* Create destination file, preallocating its space
+             without zeroing it. */
+          if (!filesys_create (file_name, 0))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
+          if (size > 0 && !file_allocate (dst, 0, size))
+            PANIC ("%s: allocate failed", file_name);
+          file_set_direct (dst, true);
 
           /* Do copy. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              size_t cnt = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+              int chunk_size;
+
+              if (cnt > TRANSFER_SECTORS)
+                cnt = TRANSFER_SECTORS;
+              chunk_size = (size > (int) (cnt * BLOCK_SECTOR_SIZE)
+                            ? (int) (cnt * BLOCK_SECTOR_SIZE)
+                            : size);
+              block_read_multiple (src, sector, cnt, data);
+              sector += cnt;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -161,7 +180,8 @@ fsutil_extract (char **argv UNUSED)
    beginning of the scratch device.  Later calls advance across
    the device.  This position is independent of that used for
    fsutil_extract(), so `extract' should precede all
-   `append's. */
+   `append's.  Like fsutil_extract(), moves many sectors per
+   request and bypasses the buffer cache. */
 void
 fsutil_append (char **argv)
 {
@@ -176,7 +196,7 @@ fsutil_append (char **argv)
   printf ("Appending '%s' to ustar archive on scratch device...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (BLOCK_SECTOR_SIZE);
+  buffer = malloc (TRANSFER_SECTORS * BLOCK_SECTOR_SIZE);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -185,6 +205,7 @@ fsutil_append (char **argv)
   if (src == NULL)
     PANIC ("%s: open failed", file_name);
   size = file_length (src);
+  file_set_direct (src, true);
 
   /* Open target block device. */
   dst = block_get_role (BLOCK_SCRATCH);
@@ -199,24 +220,49 @@ fsutil_append (char **argv)
   /* Do copy. */
   while (size > 0) 
     {
-      int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
-      if (sector >= block_size (dst))
+      size_t cnt = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+      off_t chunk_size;
+
+      if (cnt > TRANSFER_SECTORS)
+        cnt = TRANSFER_SECTORS;
+      chunk_size = (size > (off_t) (cnt * BLOCK_SECTOR_SIZE)
+                    ? (off_t) (cnt * BLOCK_SECTOR_SIZE)
+                    : size);
+      if (cnt > block_size (dst) - sector)
         PANIC ("%s: out of space on scratch device", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-      memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-      block_write (dst, sector++, buffer);
+      memset (buffer + chunk_size, 0, cnt * BLOCK_SECTOR_SIZE - chunk_size);
+      block_write_multiple (dst, sector, cnt, buffer);
+      sector += cnt;
       size -= chunk_size;
     }
 
   /* Write ustar end-of-archive marker, which is two consecutive
      sectors full of zeros.  Don't advance our position past
      them, though, in case we have more files to append. */
-  memset (buffer, 0, BLOCK_SECTOR_SIZE);
-  block_write (dst, sector, buffer);
-  block_write (dst, sector, buffer + 1);
+  if (block_size (dst) - sector < 2)
+    PANIC ("%s: out of space on scratch device", file_name);
+  memset (buffer, 0, 2 * BLOCK_SECTOR_SIZE);
+  block_write_multiple (dst, sector, 2, buffer);
 
   /* Finish up. */
   file_close (src);
   free (buffer);
 }
+
+/* Prints how the file system is laid out on disk. */
+void
+fsutil_layout (char **argv UNUSED) 
+{
+  if (!layout_print ())
+    printf ("layout: file system metadata is inconsistent\n");
+}
+
+/* Defragments every file and compacts free space. */
+void
+fsutil_defrag (char **argv UNUSED) 
+{
+  printf ("Defragmenting file system...");
+  printf ("%d moves.\n", filesys_defrag (NULL));
+}
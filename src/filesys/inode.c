@@ -1,10 +1,14 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <ohash.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
+#include <lzf.h>
+#include <stddef.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/refcount.h"
 #include "threads/malloc.h"
 #include "filesys/cache.h"
 
@@ -23,7 +27,13 @@
 #define INDIRECT_BLOCKS 125		
 #define DBL_INDIRECT_BLOCKS 125	
 #define TOTAL_BLOCKS 15760	
-#define MAX_FILE_SIZE 8069120		/* Appx. 8 MB */
+#define BLOCK_SIZE ((off_t) (fs_block_sectors * BLOCK_SECTOR_SIZE))
+#define MAX_FILE_SIZE (TOTAL_BLOCKS * BLOCK_SIZE) /* 7.7 to 61.6 MB */
+#define CLUSTER_BLOCKS 8		/* Blocks per compressed cluster. */
+#define CLUSTER_SIZE (CLUSTER_BLOCKS * BLOCK_SIZE)
+#define MAX_CLUSTER_SIZE \
+  (CLUSTER_BLOCKS * MAX_BLOCK_SECTORS * BLOCK_SECTOR_SIZE)
+#define CLUSTER_CNT DIV_ROUND_UP (TOTAL_BLOCKS, CLUSTER_BLOCKS)
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 
@@ -42,12 +52,20 @@ struct inode_disk
     unsigned indirect_used;		/* Indicates if indirect used */
     unsigned dbl_indirect_used ;	/* Indicates if dbl_indirect is used */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[110];               /* Not used. */
+    off_t unwritten;                    /* Preallocated bytes at the end
+                                           that were never written. */
+    unsigned compressed;                /* Nonzero if data is compressed. */
+    uint32_t raw[DIV_ROUND_UP (CLUSTER_CNT, 32)];
+                                        /* Clusters stored uncompressed. */
+    unsigned block_sectors;             /* Sectors per block of the file
+                                           system, or 0 for 1. */
+    uint32_t unused[45];                /* Not used. */
   };
 
 /* On-disk indirect block - Each indirect block contains an array of 125 
-   blocks each of which can hold BLOCK_SECTOR_SIZE bytes of data for a total
-   of 125 * BLOCK_SECTOR_SIZE bytes of data */
+   blocks each of which can hold BLOCK_SIZE bytes of data for a total
+   of 125 * BLOCK_SIZE bytes of data.  Like the inode, it takes up a
+   whole block but only uses the block's first sector. */
 struct inode_indirect
   {
     block_sector_t sector;		/* sector containing this data structure */
@@ -65,452 +83,513 @@ struct inode_dbl_indirect
     off_t length;			/* # of indirect blocks used */
     block_sector_t indirect[INDIRECT_BLOCKS];
   };
-/* Returns the number of sectors to allocate for an inode SIZE
+/* Returns the number of blocks to allocate for an inode SIZE
    bytes long. */
 static inline size_t
-bytes_to_sectors (off_t size)
+bytes_to_blocks (off_t size)
 {
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+  return DIV_ROUND_UP (size, BLOCK_SIZE);
 }
 
-/* Each inode can address 128 + (128*128)* blocks which contain 
-   a total of 8.0625 MB. The direct blocks will be used for small 
-   files (for quick access)*/
+/* Each inode can address 10 + 125 + (125*125) blocks which contain 
+   a total of about 7.7 MB per sector in a block. The direct blocks
+   will be used for small files (for quick access)*/
 
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
-
-    off_t length;
-    struct inode_indirect ind_data;     /* Each indirect block holds 128 block #s */
-    struct inode_dbl_indirect dbl_indirect;
-					/* One dbly indirect block can address 16384 blocks */
+    struct cluster *cluster;            /* Compressed files' current cluster. */
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* Block map entry for a block that has no sector, which only
+   compressed files have.  Sector 0 holds the free map's inode,
+   so it is never a data block. */
+#define NO_SECTOR 0
+
+/* Offset of the first sector number within an indirect or
+   double indirect block.  The two have the same layout. */
+#define INDEX_OFS offsetof (struct inode_indirect, blocks)
+
+/* Returns entry IDX of the indirect or double indirect block in
+   SECTOR. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+read_index (block_sector_t sector, size_t idx)
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
-    return -1;
-}
+  block_sector_t entry;
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+  ASSERT (idx < INDIRECT_BLOCKS);
+  block_cache_read_partial (fs_device, sector, &entry,
+                            INDEX_OFS + idx * sizeof entry, sizeof entry);
+  return entry;
+}
 
-/* Initializes the inode module. */
-void
-inode_init (void) 
+/* Sets entry IDX of the indirect or double indirect block in
+   SECTOR to ENTRY. */
+static void
+write_index (block_sector_t sector, size_t idx, block_sector_t entry)
 {
-  list_init (&open_inodes);
+  ASSERT (idx < INDIRECT_BLOCKS);
+  block_cache_write_partial (fs_device, sector, &entry,
+                             INDEX_OFS + idx * sizeof entry, sizeof entry);
 }
 
-/* Initializes an inode with LENGTH bytes of data and
-   writes the new inode to sector SECTOR on the file system
-   device.
-   Returns true if successful.
-   Returns false if memory or disk allocation fails. */
-bool
-inode_create (block_sector_t sector, off_t length)
+/* Returns the first sector of data block IDX of the inode whose
+   on-disk form is DATA.  The block must be allocated. */
+static block_sector_t
+lookup_block (const struct inode_disk *data, size_t idx)
 {
-  struct inode_disk *disk_inode = NULL;
-  struct inode_indirect *disk_indirect = NULL;
-  struct inode_dbl_indirect *disk_dbindirect = NULL;
-  size_t direct = 0, indirect = 0, dbl_indirect = 0, remaining = 0;
-  bool success = false;
+  if (idx < DIRECT_BLOCKS)
+    return data->blocks[idx];
+  idx -= DIRECT_BLOCKS;
+  if (idx < INDIRECT_BLOCKS)
+    return read_index (data->indirect, idx);
+  idx -= INDIRECT_BLOCKS;
+  return read_index (read_index (data->dbl_indirect, idx / INDIRECT_BLOCKS),
+                     idx % INDIRECT_BLOCKS);
+}
 
-  ASSERT (length >= 0);
+/* Sets the map entry for data block IDX of the inode whose
+   on-disk form is DATA to SECTOR, the first sector of a block.
+   The indirect blocks needed to reach it must already exist. */
+static void
+set_block (struct inode_disk *data, size_t idx, block_sector_t sector)
+{
+  if (idx < DIRECT_BLOCKS)
+    data->blocks[idx] = sector;
+  else if (idx < DIRECT_BLOCKS + INDIRECT_BLOCKS)
+    write_index (data->indirect, idx - DIRECT_BLOCKS, sector);
+  else
+    {
+      idx -= DIRECT_BLOCKS + INDIRECT_BLOCKS;
+      write_index (read_index (data->dbl_indirect, idx / INDIRECT_BLOCKS),
+                   idx % INDIRECT_BLOCKS, sector);
+    }
+}
 
-  /* If this assertion fails, the inode structure is not exactly
-     one sector in size, and you should fix that. */
-  ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+/* Reads SIZE bytes starting at byte OFS of the block whose first
+   sector is BLOCK into BUFFER, bypassing the buffer cache for
+   whole sectors if UNCACHED is true. */
+static void
+read_block (block_sector_t block, int ofs, void *buffer_, int size,
+            bool uncached)
+{
+  uint8_t *buffer = buffer_;
 
-  disk_inode = calloc (1, sizeof *disk_inode);
-  disk_indirect = calloc (1, sizeof *disk_indirect);
-  disk_dbindirect = calloc (1, sizeof *disk_dbindirect);
-   
-  if (disk_inode != NULL && disk_indirect != NULL && disk_dbindirect != NULL)
-    {
-      size_t sectors = bytes_to_sectors (length);
-      if (sector_allocation (sectors, &direct, &indirect, &dbl_indirect, &remaining))
-	{
-	  success = true;
-	}
-      else				/* File too big */
-	{
-	  free_resources (disk_inode, disk_indirect, disk_dbindirect);
-	  return false;
-	}
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      disk_inode->self = sector;	/* Not needed */
-      /* IMPORTANT TODO: What about files with 0 file_size? */
-      if (direct)
-	{
-	  alloc_direct_sectors (disk_inode->blocks, 0, direct);
-	}
-      /* Allocate block in disk for struct inode_indirect */ 	
-      if (indirect)
-        {
-          if (!free_map_allocate (1, &disk_inode->indirect))
-	    {	
-	      success = false;
-	    }
-	  else
-	    {
-	      alloc_indirect_sectors (disk_indirect->blocks, 0, indirect);
-      	      block_cache_write (fs_device, disk_inode->indirect, disk_indirect);
-	    }
-        }
-      /* Allocate block in disk for struct inode_dbl_indirect */
-      if (dbl_indirect || remaining)
-        {
-	  if (!free_map_allocate (1, &disk_inode->dbl_indirect))
-	    {
-	      success = false;
-	    }
-	  else
-	    {
-              alloc_double_indirect_sectors (disk_dbindirect->indirect, 
-	                                 0, dbl_indirect, remaining);
-      	      block_cache_write (fs_device, disk_inode->dbl_indirect, disk_dbindirect);
-	    }
-        }
-      /* TODO: If not success, roll back the writes */
-      if (success)
-	{
- 	  block_cache_write (fs_device, sector, disk_inode);
-	}
-      free_resources (disk_inode, disk_indirect, disk_dbindirect);
+  while (size > 0)
+    {
+      block_sector_t sector = block + ofs / BLOCK_SECTOR_SIZE;
+      int sector_ofs = ofs % BLOCK_SECTOR_SIZE;
+      int chunk_size = MIN (size, BLOCK_SECTOR_SIZE - sector_ofs);
+
+      if (chunk_size < BLOCK_SECTOR_SIZE)
+        block_cache_read_partial (fs_device, sector, buffer, sector_ofs,
+                                  chunk_size);
+      else if (uncached)
+        block_cache_read_uncached (fs_device, sector, buffer);
+      else
+        block_cache_read (fs_device, sector, buffer);
+      ofs += chunk_size;
+      buffer += chunk_size;
+      size -= chunk_size;
     }
-  return success;
 }
 
-void free_resources (void * p1, void * p2, void * p3)
+/* Writes SIZE bytes from BUFFER starting at byte OFS of the block
+   whose first sector is BLOCK, bypassing the buffer cache for
+   whole sectors if UNCACHED is true. */
+static void
+write_block (block_sector_t block, int ofs, const void *buffer_, int size,
+             bool uncached)
 {
-  free (p1);
-  free (p2);
-  free (p3);
+  const uint8_t *buffer = buffer_;
+
+  while (size > 0)
+    {
+      block_sector_t sector = block + ofs / BLOCK_SECTOR_SIZE;
+      int sector_ofs = ofs % BLOCK_SECTOR_SIZE;
+      int chunk_size = MIN (size, BLOCK_SECTOR_SIZE - sector_ofs);
+
+      if (chunk_size < BLOCK_SECTOR_SIZE)
+        block_cache_write_partial (fs_device, sector, buffer, sector_ofs,
+                                   chunk_size);
+      else if (uncached)
+        block_cache_write_uncached (fs_device, sector, buffer);
+      else
+        block_cache_write (fs_device, sector, buffer);
+      ofs += chunk_size;
+      buffer += chunk_size;
+      size -= chunk_size;
+    }
 }
 
-/* Input: # of sectors. Output: how many of each type is required to fill those sectors */
-bool sector_allocation (size_t sectors, size_t *direct_p, 
-	size_t *indirect_p, size_t *dbl_p, size_t *remain_p)
+/* Returns the number of data blocks of the inode whose on-disk
+   form is DATA, starting at block IDX and at most CNT, that lie
+   one after another on disk from FIRST, the first sector of
+   block IDX onward, so that they can be transferred in a single
+   request.  If UNSHARED is true, the run also ends before a
+   block shared with another file. */
+static size_t
+contiguous_blocks (const struct inode_disk *data, size_t idx, size_t cnt,
+                   block_sector_t first, bool unshared)
 {
-  size_t direct = 0, indirect = 0, dbl = 0, remain = 0;
-  
-  direct = MIN (sectors, DIRECT_BLOCKS);
-  sectors -= MIN (direct, sectors);
-  
-  indirect = MIN (sectors, INDIRECT_BLOCKS);
-  sectors -= indirect;
+  size_t n;
+
+  for (n = 1; n < cnt; n++)
+    {
+      block_sector_t sector = lookup_block (data, idx + n);
 
-  dbl = MIN ((sectors / INDIRECT_BLOCKS), DBL_INDIRECT_BLOCKS);
-  sectors -= dbl * INDIRECT_BLOCKS;
+      if (sector != first + n * fs_block_sectors
+          || (unshared && refcount_shared (sector)))
+        break;
+    }
+  return n;
+}
 
-  remain = sectors % INDIRECT_BLOCKS;
-  sectors -= remain;
+/* Zeros SIZE bytes starting at byte OFS within the block whose
+   first sector is BLOCK. */
+static void
+clear_partial (block_sector_t block, int ofs, int size)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
 
-  *direct_p   = direct;
-  *indirect_p = indirect; 
-  *dbl_p      = dbl;
-  *remain_p   = remain;
- 
-  if (sectors)
+  while (size > 0)
     {
-      return false;	/* File too big! Return failure, but use allocated blocks */	
+      int chunk_size = MIN (size, BLOCK_SECTOR_SIZE - ofs % BLOCK_SECTOR_SIZE);
+
+      write_block (block, ofs, zeros, chunk_size, false);
+      ofs += chunk_size;
+      size -= chunk_size;
     }
-  return true;		/* SUCCESS */
 }
 
-/* Allocates and initializes sectors # of blocks starting from ptr[index] 
-   and returns # of sectors successfully allocated */
-size_t alloc_direct_sectors (block_sector_t *ptr, int index, size_t sectors)
+/* Fills SECTOR with zeros. */
+static void
+clear_sector (block_sector_t sector)
 {
-  int i = index, count = 0;
-  i = index;
-  static char zeros[BLOCK_SECTOR_SIZE];
-  if (!sectors)
+  clear_partial (sector, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Run of free blocks set aside by extend_blocks() for the blocks
+   it is about to allocate, so that they land next to each other
+   on disk. */
+static struct
+  {
+    block_sector_t next;        /* First sector of next block to hand out. */
+    size_t left;                /* Number of blocks left. */
+  }
+reserve;
+
+/* How to fill in a newly allocated block. */
+enum block_fill
+  {
+    FILL_ZERO,                  /* Allocate a block and zero it. */
+    FILL_INDEX,                 /* Allocate a block and zero the first
+                                   sector, all an index block uses. */
+    FILL_NONE,                  /* Allocate a block, leave it as is. */
+    FILL_HOLE                   /* Map no block at all. */
+  };
+
+/* Allocates a block and stores its first sector in *SECTORP,
+   filling it according to FILL, or just stores NO_SECTOR if
+   FILL is FILL_HOLE.  Returns true if successful, false if the
+   disk is full. */
+static bool
+allocate_sector (block_sector_t *sectorp, enum block_fill fill)
+{
+  if (fill == FILL_HOLE)
     {
-      return 0;
+      *sectorp = NO_SECTOR;
+      return true;
     }
-  count = MIN (sectors, DIRECT_BLOCKS);
-  while (count--)
+  if (reserve.left > 0)
     {
-      if (free_map_allocate (1, &ptr[i]))
-        {
-	  block_cache_write (fs_device, ptr[i], zeros); 
-	  i++;
-        }	
+      *sectorp = reserve.next;
+      reserve.next += fs_block_sectors;
+      reserve.left--;
     }
-  return i;
+  else if (!free_map_allocate (1, sectorp))
+    return false;
+  if (fill == FILL_ZERO)
+    clear_partial (*sectorp, 0, BLOCK_SIZE);
+  else if (fill == FILL_INDEX)
+    clear_sector (*sectorp);
+  return true;
 }
 
-/* Allocates and initializes sectors # of blocks starting from ptr[index] 
-   and returns # of sectors successfully allocated */
-size_t alloc_indirect_sectors (block_sector_t *ptr, int index, size_t sectors)
+/* Allocates a block, filled according to FILL, and stores its
+   first sector in entry IDX of the indirect or double indirect
+   block in SECTOR.  Returns true if successful, false if the
+   disk is full. */
+static bool
+allocate_index (block_sector_t sector, size_t idx, enum block_fill fill)
 {
-  int i = index, count = 0;
-  static char zeros[BLOCK_SECTOR_SIZE];
-  if (!sectors)
+  block_sector_t entry;
+
+  if (!allocate_sector (&entry, fill))
+    return false;
+  write_index (sector, idx, entry);
+  return true;
+}
+
+/* Allocates data block IDX of the inode whose on-disk form is
+   DATA, which must be the block just past the last one
+   allocated, along with the indirect blocks needed to reach it.
+   The data block is filled according to FILL; indirect blocks
+   are always cleared.  Returns true if successful.  On failure,
+   returns false without allocating anything. */
+static bool
+allocate_block (struct inode_disk *data, size_t idx, enum block_fill fill)
+{
+  block_sector_t indirect;
+
+  if (idx < DIRECT_BLOCKS)
+    return allocate_sector (&data->blocks[idx], fill);
+  idx -= DIRECT_BLOCKS;
+
+  if (idx < INDIRECT_BLOCKS)
     {
-      return 0;
+      if (idx == 0 && !allocate_sector (&data->indirect, FILL_INDEX))
+        return false;
+      if (allocate_index (data->indirect, idx, fill))
+        return true;
+      if (idx == 0)
+        free_map_release (data->indirect, 1);
+      return false;
     }
-  /* Not needed but good to have */
-  count = MIN (sectors, INDIRECT_BLOCKS);
-  while (count--)
+  idx -= INDIRECT_BLOCKS;
+
+  if (idx == 0 && !allocate_sector (&data->dbl_indirect, FILL_INDEX))
+    return false;
+  if (idx % INDIRECT_BLOCKS == 0
+      && !allocate_index (data->dbl_indirect, idx / INDIRECT_BLOCKS,
+                          FILL_INDEX))
     {
-      if (free_map_allocate (1, &ptr[i]))
-        {
-	  block_cache_write (fs_device, ptr[i], zeros); 
-	  i++;
-        }	
+      if (idx == 0)
+        free_map_release (data->dbl_indirect, 1);
+      return false;
     }
-  return i;
+  indirect = read_index (data->dbl_indirect, idx / INDIRECT_BLOCKS);
+  if (allocate_index (indirect, idx % INDIRECT_BLOCKS, fill))
+    return true;
+  if (idx % INDIRECT_BLOCKS == 0)
+    free_map_release (indirect, 1);
+  if (idx == 0)
+    free_map_release (data->dbl_indirect, 1);
+  return false;
+}
+
+/* Returns the number of indirect blocks that hang off the double
+   indirect block of an inode with BLOCKS data blocks. */
+static size_t
+dbl_indirect_cnt (size_t blocks)
+{
+  if (blocks <= DIRECT_BLOCKS + INDIRECT_BLOCKS)
+    return 0;
+  return DIV_ROUND_UP (blocks - DIRECT_BLOCKS - INDIRECT_BLOCKS,
+                       INDIRECT_BLOCKS);
+}
+
+/* Returns the number of indirect and double indirect blocks
+   needed to map BLOCKS data blocks. */
+static size_t
+index_cnt (size_t blocks)
+{
+  size_t cnt = 0;
+
+  if (blocks > DIRECT_BLOCKS)
+    cnt++;
+  if (blocks > DIRECT_BLOCKS + INDIRECT_BLOCKS)
+    cnt += 1 + dbl_indirect_cnt (blocks);
+  return cnt;
+}
+
+/* Run of consecutive blocks gathered by release_sector(). */
+struct run
+  {
+    block_sector_t start;       /* First sector of first block. */
+    size_t cnt;                 /* Number of blocks. */
+  };
+
+/* Releases the blocks in RUN and empties it. */
+static void
+release_run (struct run *run)
+{
+  if (run->cnt > 0)
+    free_map_release (run->start, run->cnt);
+  run->cnt = 0;
 }
 
-/* Allocates double indirect blocks and initializes them */
-size_t alloc_double_indirect_sectors (block_sector_t *ptr, int index,  
-  					size_t sectors, size_t remaining)
+/* Adds the block whose first sector is SECTOR to RUN, first
+   releasing the blocks already in RUN if it does not immediately
+   follow them.  Ignores NO_SECTOR.  A block that other files
+   share only loses a reference. */
+static void
+release_sector (struct run *run, block_sector_t sector)
 {
-  int i = index, count = 0;
-  if (!sectors && !remaining)
+  if (sector == NO_SECTOR || refcount_unref (sector))
+    return;
+  if (run->cnt > 0 && sector == run->start + run->cnt * fs_block_sectors)
     {
-      return 0;
+      run->cnt++;
+      return;
     }
-  count = MIN (sectors, DBL_INDIRECT_BLOCKS);
-  if (remaining)
+  release_run (run);
+  run->start = sector;
+  run->cnt = 1;
+}
+
+/* Releases data blocks KEEP through CNT - 1 of the inode whose
+   on-disk form is DATA, which has CNT blocks allocated, along
+   with the indirect blocks that only those blocks needed.
+   Blocks are visited in the order that extend_blocks()
+   allocates them, so that a file laid out in a single run is
+   released with a single free map update. */
+static void
+release_blocks (const struct inode_disk *data, size_t cnt, size_t keep)
+{
+  struct run run = {0, 0};
+  size_t i;
+
+  free_map_begin_batch ();
+  refcount_begin_batch ();
+  for (i = keep; i < cnt; i++)
     {
-      count++;				/* For the remaining sectors */
+      size_t dbl_idx = i - DIRECT_BLOCKS - INDIRECT_BLOCKS;
+
+      if (i == DIRECT_BLOCKS)
+        release_sector (&run, data->indirect);
+      else if (i >= DIRECT_BLOCKS + INDIRECT_BLOCKS)
+        {
+          if (dbl_idx == 0)
+            release_sector (&run, data->dbl_indirect);
+          if (dbl_idx % INDIRECT_BLOCKS == 0)
+            release_sector (&run, read_index (data->dbl_indirect,
+                                              dbl_idx / INDIRECT_BLOCKS));
+        }
+      release_sector (&run, lookup_block (data, i));
     }
-  while (count--)
+  release_run (&run);
+  refcount_end_batch ();
+  free_map_end_batch ();
+}
+
+/* Extends the inode whose on-disk form is DATA to LENGTH bytes,
+   allocating zeroed data blocks to cover the new bytes.  Blocks
+   that lie entirely within bytes WRITE_OFS through WRITE_END - 1,
+   which the caller is about to overwrite, are left unzeroed.
+   A compressed file gets holes instead of data blocks, since its
+   clusters are allocated when they are written back.
+   The new data and indirect blocks come from a single run of
+   free blocks if one is large enough, or one at a time
+   otherwise.  Returns true if successful.  On failure, returns
+   false and leaves the inode unchanged. */
+static bool
+extend_blocks (struct inode_disk *data, off_t length,
+               off_t write_ofs, off_t write_end)
+{
+  size_t old_cnt = bytes_to_blocks (data->length);
+  size_t new_cnt = bytes_to_blocks (length);
+  size_t need = index_cnt (new_cnt) - index_cnt (old_cnt);
+  bool success = true;
+  size_t i;
+
+  ASSERT (length >= data->length);
+  if (length > MAX_FILE_SIZE)
+    return false;
+
+  if (!data->compressed)
+    need += new_cnt - old_cnt;
+  free_map_begin_batch ();
+  if (need > 1 && free_map_allocate (need, &reserve.next))
+    reserve.left = need;
+  for (i = old_cnt; i < new_cnt; i++)
     {
-      struct inode_indirect *disk_indirect = NULL;
-      disk_indirect = calloc (1, sizeof (*disk_indirect));
-      if (!free_map_allocate (1, &ptr[i]))
-	{
-	  return 0;
-	}
-      if (!count && remaining)
-	{
-          alloc_indirect_sectors (disk_indirect->blocks, 0, remaining);	
-	}
-      else
-	{
-          alloc_indirect_sectors (disk_indirect->blocks, 0, INDIRECT_BLOCKS);	
-	}
-      block_cache_write (fs_device, ptr[i], disk_indirect);
-      free (disk_indirect);
-      i++;
-    }
-   return i;
-}
-
-bool eof_reached (struct inode *node, off_t pos)
-{
-   return (pos >= node->data.length);
-}
-
-int no_bytes (void)
-{
-   return 0;
-}
-
-/* Gets the block from the disk inode 
-   Caller should make sure the block is a direct block before calling */
-block_sector_t direct_block (struct inode *node, off_t block)
-{
-   ASSERT (node != NULL);
-   return node->data.blocks[block];	 		    /* node->data read at inode_open */
-}
-
-block_sector_t indirect_block (struct inode *node, off_t block)
-{
-   ASSERT (node != NULL);
-   block_cache_read (fs_device, node->data.indirect, &node->ind_data); 
-   return node->ind_data.blocks[block];
-}
-
-block_sector_t dbl_indirect_block (struct inode *node, off_t block)
-{
-   ASSERT (node != NULL);
-   
-   /* Read the double indirect struct of this inode */ 
-   block_cache_read (fs_device, node->data.dbl_indirect, &node->dbl_indirect);
-
-   /* Get the indirect block */
-   off_t dbl_indirect_index = block / DBL_INDIRECT_BLOCKS;
-   struct inode_indirect *disk_indirect = NULL;
-   disk_indirect = calloc (1, sizeof (*disk_indirect));
-   block_cache_read (fs_device, 
-		node->dbl_indirect.indirect[dbl_indirect_index], disk_indirect);
-
-   /* Get the actual block which contains data */
-   off_t indirect_index = block % INDIRECT_BLOCKS;
-   block_sector_t data =  disk_indirect->blocks[indirect_index];
-
-   free (disk_indirect);
-   return data;
-}
-
-/* Returns the block corresponding to the inode struct and offset 
-   If block is within a direct block, reads disk_inode and gets the block #
-   If block is within an indirect block, reads disk_inode, indirect_inode and returns block 
-   If block is within a double indirect block, reads disk_inode, dbl_indirect_inode
-   then the indirect_inode and returns block */
-block_sector_t get_inode_block (struct inode *node, off_t size, off_t pos, bool read)
-{ 
-   ASSERT (node != NULL);
-   ASSERT (pos < MAX_FILE_SIZE);		/* File too big */
-   size_t blk = pos / BLOCK_SECTOR_SIZE; 	/* Get the block offset */
-/*  
-   if (!pos && read)
-     {
-       	return direct_block (node, 0);
-     }
-   if (!pos && !read && !node->length)		
-     {
-	struct inode_disk *disk_inode = NULL;
-	disk_inode = calloc (1, sizeof *disk_inode);
-	block_cache_read (fs_device, node->sector, disk_inode);
-
- 	alloc_direct_sectors (disk_inode->blocks, 0, 1);		
-	block_cache_write (fs_device, node->sector, disk_inode); 
-
-        block_sector_t extended = disk_inode->blocks[0];
-        free (disk_inode);
-	return extended;
-     } 
-*/
-   if (pos < node->data.length)			/* Check for File Extension */
-     {
-       if (blk < DIRECT_BLOCKS)			/* blk range 1 to 10 */
-    	 {
-           return direct_block (node, blk);
-    	 }
-       if (blk < (DIRECT_BLOCKS + INDIRECT_BLOCKS)) 
-         {					/* blk range 11 to 135 */
-	   blk -= DIRECT_BLOCKS; 
-           return indirect_block (node, blk);
-	 }
-       if (blk < TOTAL_BLOCKS)				
-         {					/* blk range 136 to 15760*/
-	   blk -= (DIRECT_BLOCKS + INDIRECT_BLOCKS);
-           return dbl_indirect_block (node, blk);
-	 }
-     }
-   else						/* File extension  */
-     {
-       if (read)
-           return -1;				/* no bytes to read */
-       else					/* Write will extend file */
-           return extend_file (node, pos);
-     }	
-   return -1; 	
-}
-
-/* Extends file from current size to given offset by filling intermediate blocks
-   with zeroes. Returns the block corresponding to offset */
-block_sector_t extend_file (struct inode *node, off_t pos)	
-{
-  ASSERT (node != NULL);
-  size_t old_direct = 0, old_indirect = 0, old_dbl = 0, old_remaining = 0;
-  size_t new_direct = 0, new_indirect = 0, new_dbl = 0, new_remaining = 0;
-  size_t cur_sectors = bytes_to_sectors(node->length);
-  size_t new_sectors = bytes_to_sectors(pos);   
-
-  sector_allocation (cur_sectors, &old_direct, &old_indirect, &old_dbl, &old_remaining);
-  sector_allocation (new_sectors, &new_direct, &new_indirect, &new_dbl, &new_remaining);
-  block_sector_t extended_sector = 0; 
-
-  if (new_direct > old_direct)
-    {
-      alloc_direct_sectors (node->data.blocks, old_direct, new_direct-old_direct);
-      /* Update the new sector */
-      extended_sector = direct_block (node, (off_t)(new_direct - 1));
-    }
-
-  if (new_indirect > old_indirect)
-    {
-      struct inode_indirect *disk_indirect = NULL;
-      disk_indirect = calloc (1, sizeof *disk_indirect);
-      if (!old_indirect)				
+      enum block_fill fill = FILL_ZERO;
+
+      if (data->compressed)
+        fill = FILL_HOLE;
+      else if ((off_t) i * BLOCK_SIZE >= write_ofs
+               && (off_t) (i + 1) * BLOCK_SIZE <= write_end)
+        fill = FILL_NONE;
+      if (!allocate_block (data, i, fill))
         {
- 	   /* block for the indirect struct */
-	   if (!free_map_allocate(1, &node->data.indirect)) 
-             {
-	       return -1;
-             }
-           else
-	     {
-	       alloc_indirect_sectors (disk_indirect->blocks, 0, new_indirect);
-	       block_cache_write (fs_device, node->data.indirect, disk_indirect); 
-	     }
+          release_blocks (data, i, old_cnt);
+          success = false;
+          break;
         }
-      /* Indirect struct exists - read it from disk */ 
-      block_cache_read (fs_device, node->data.indirect, disk_indirect);
-      /* Allocate new indirect - old indirect # of sectors starting from position old_indirect */
-      alloc_indirect_sectors (disk_indirect->blocks, old_indirect, new_indirect - old_indirect);
-      /* Write back indirect struct to disk */
-      block_cache_write (fs_device, node->data.indirect, disk_indirect);    
-      /* Free indirect struct (in-memory struct) */
-      free (disk_indirect);
-      /* Update the new sector */
-      extended_sector = indirect_block (node, (off_t)(new_direct - 1));
-    }
-
-  if (new_dbl > old_dbl)		
-    {
-      struct inode_dbl_indirect * disk_dbindirect = NULL;
-      disk_dbindirect = calloc (1, sizeof *disk_dbindirect);
-      if (!old_dbl && !old_remaining)				
+    }
+  ASSERT (reserve.left == 0 || !success);
+  if (reserve.left > 0)
+    free_map_release (reserve.next, reserve.left);
+  reserve.left = 0;
+  free_map_end_batch ();
+
+  if (success)
+    data->length = length;
+  return success;
+}
+
+static off_t read_at (struct inode *, void *, off_t size, off_t offset,
+                      bool uncached);
+static off_t write_at (struct inode *, const void *, off_t size, off_t offset,
+                       bool uncached);
+static bool zero_range (struct inode *, off_t from, off_t to);
+static block_sector_t unshare_block (struct inode *, size_t idx, bool whole);
+static off_t read_compressed (struct inode *, void *, off_t size,
+                              off_t offset);
+static off_t write_compressed (struct inode *, const void *, off_t size,
+                               off_t offset);
+static bool resize_compressed (struct inode *, off_t length);
+static bool flush_cluster (struct inode *);
+
+/* Table of open inodes, keyed by sector, so that opening a single
+   inode twice returns the same `struct inode'. */
+static struct ohash open_inodes;
+
+/* Initializes the inode module. */
+void
+inode_init (void) 
+{
+  if (!ohash_init (&open_inodes, 0))
+    PANIC ("open inode table allocation failed");
+}
+
+/* Initializes an inode with LENGTH bytes of data and
+   writes the new inode to sector SECTOR on the file system
+   device.
+   Returns true if successful.
+   Returns false if memory or disk allocation fails. */
+bool
+inode_create (block_sector_t sector, off_t length)
+{
+  struct inode_disk *disk_inode = NULL;
+  bool success = false;
+
+  ASSERT (length >= 0);
+
+  /* If this assertion fails, the inode structure is not exactly
+     one sector in size, and you should fix that. */
+  ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+
+  disk_inode = calloc (1, sizeof *disk_inode);
+  if (disk_inode != NULL)
+    {
+      disk_inode->magic = INODE_MAGIC;
+      disk_inode->self = sector;	/* Not needed */
+      disk_inode->block_sectors = fs_block_sectors;
+      if (extend_blocks (disk_inode, length, 0, 0))
         {
-	   /* double indirect struct doesn't exist. Create it. */
-          if (!free_map_allocate(1, &node->data.dbl_indirect))  
-            {
-	      return -1;
-            }
-          else
-	    {
-	      alloc_double_indirect_sectors (disk_dbindirect->indirect, 0, new_dbl, new_remaining);
-	      block_cache_write (fs_device, node->data.dbl_indirect, disk_dbindirect); 
-	    }
+          block_cache_write (fs_device, sector, disk_inode);
+          success = true;
         }
-      /* Double Indirect struct exists - read it from disk */ 
-      block_cache_read (fs_device, node->data.dbl_indirect, disk_dbindirect);
-      /* Fill old_dbl's left over indirect blocks first */ 
-      struct inode_indirect * disk_indirect = NULL;
-      disk_indirect = calloc (1, sizeof *disk_indirect);
-      block_cache_read (fs_device, disk_dbindirect->indirect[old_dbl], disk_indirect);
-      /* old_remaining has the # of indirect blocks written in the last dbl_ind block */
-      alloc_indirect_sectors (disk_dbindirect->indirect, old_remaining, 
-					INDIRECT_BLOCKS - old_remaining);
-      free (disk_indirect); 
-      /* Allocate new_dbl - old_dbl # of indirect sectors start from position old_dbl */
-      alloc_double_indirect_sectors (disk_dbindirect->indirect, 
-				old_dbl, new_dbl - old_dbl, new_remaining);
-      /* Write back double indirect struct to disk */ 
-      block_cache_write (fs_device, node->data.dbl_indirect, disk_dbindirect);
-      /* Free in-memory double indirect struct */ 
-      free (disk_dbindirect);
-    }
-
-  node->data.length = pos;		/* To account for this write */
-  block_cache_write (fs_device, node->sector, &node->data); 
-  return extended_sector; 
+      free (disk_inode);
+    }
+  return success;
 }
 
 /* Reads an inode from SECTOR and returns a `struct inode' that contains it.
@@ -518,20 +597,12 @@ block_sector_t extend_file (struct inode *node, off_t pos)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  inode = ohash_find (&open_inodes, sector);
+  if (inode != NULL)
+    return inode_reopen (inode);
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
@@ -539,14 +610,18 @@ inode_open (block_sector_t sector)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  if (!ohash_insert (&open_inodes, sector, inode))
+    {
+      free (inode);
+      return NULL;
+    }
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->cluster = NULL;
   //block_read (fs_device, inode->sector, &inode->data);
   block_cache_read (fs_device, inode->sector, &inode->data);
-  inode->length = inode->data.length;
   return inode;
 }
 
@@ -579,17 +654,28 @@ inode_close (struct inode *inode)
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      /* Remove from inode table and release lock. */
+      ohash_delete (&open_inodes, inode->sector);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          free_map_begin_batch ();
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          release_blocks (&inode->data,
+                          bytes_to_blocks (inode->data.length), 0);
+          free_map_end_batch ();
+        }
+      else
+        {
+          /* If the disk is too full to write back the cluster
+             held in memory, its latest changes are lost, but
+             flush_cluster() leaves the file on disk with its
+             previous contents. */
+          flush_cluster (inode);
         }
 
+      free (inode->cluster);
       free (inode); 
     }
 }
@@ -607,36 +693,103 @@ inode_remove (struct inode *inode)
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
+{
+  return read_at (inode, buffer, size, offset, false);
+}
+
+/* Like inode_read_at(), but whole sectors go straight from disk
+   to BUFFER without entering the buffer cache, with whole blocks
+   that lie one after another on disk read in a single request.
+   Parts of sectors still go through the cache. */
+off_t
+inode_read_uncached (struct inode *inode, void *buffer, off_t size,
+                     off_t offset) 
+{
+  return read_at (inode, buffer, size, offset, true);
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+   Returns the number of bytes actually written, which may be
+   less than SIZE if an error occurs.
+   A write past end of file extends the inode, filling any gap
+   with zeros.  If the extension cannot be allocated, nothing is
+   written. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+                off_t offset) 
+{
+  return write_at (inode, buffer, size, offset, false);
+}
+
+/* Like inode_write_at(), but whole sectors go straight from
+   BUFFER to disk without entering the buffer cache, with whole
+   blocks that lie one after another on disk written in a single
+   request.  Parts of sectors still go through the cache. */
+off_t
+inode_write_uncached (struct inode *inode, const void *buffer, off_t size,
+                      off_t offset) 
+{
+  return write_at (inode, buffer, size, offset, true);
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position
+   OFFSET, bypassing the buffer cache for whole sectors if
+   UNCACHED is true.  Returns the number of bytes read. */
+static off_t
+read_at (struct inode *inode, void *buffer_, off_t size, off_t offset,
+         bool uncached) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
+  off_t valid = inode_length (inode) - inode->data.unwritten;
+
+  if (inode->data.compressed)
+    return read_compressed (inode, buffer, size, offset);
 
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = get_inode_block (inode, size, offset, true);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      /* Block to read, starting byte offset within block. */
+      size_t block_idx = offset / BLOCK_SIZE;
+      int block_ofs = offset % BLOCK_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
+      /* Bytes left in inode, bytes left in block, lesser of the two. */
       off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+      int block_left = BLOCK_SIZE - block_ofs;
+      int min_left = inode_left < block_left ? inode_left : block_left;
 
-      /* Number of bytes to actually copy out of this sector. */
+      /* Number of bytes to actually copy out of this block. */
       int chunk_size = size < min_left ? size : min_left;
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (offset >= valid)
+        {
+          /* Preallocated but never written. */
+          memset (buffer + bytes_read, 0, chunk_size);
+        }
+      else if (uncached && block_ofs == 0 && chunk_size == BLOCK_SIZE
+               && offset + chunk_size <= valid)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_cache_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Whole blocks that follow one another on disk come from
+             it in a single transfer. */
+          block_sector_t block = lookup_block (&inode->data, block_idx);
+          size_t cnt = contiguous_blocks (&inode->data, block_idx,
+                                          MIN (size, valid - offset)
+                                          / BLOCK_SIZE, block, false);
+
+          chunk_size = cnt * BLOCK_SIZE;
+          block_cache_read_uncached_multiple (fs_device, block,
+                                              cnt * fs_block_sectors,
+                                              buffer + bytes_read);
         }
-      else 
+      else
         {
-	  block_cache_read_partial (fs_device, sector_idx, 
-		buffer + bytes_read, sector_ofs, chunk_size);
+          /* Read the written part now, the rest next time around. */
+          if (offset + chunk_size > valid)
+            chunk_size = valid - offset;
+          read_block (lookup_block (&inode->data, block_idx), block_ofs,
+                      buffer + bytes_read, chunk_size, uncached);
         }
       
       /* Advance. */
@@ -648,47 +801,73 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
-   Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size, off_t offset) 
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+   bypassing the buffer cache for whole sectors if UNCACHED is
+   true.  Returns the number of bytes written. */
+static off_t
+write_at (struct inode *inode, const void *buffer_, off_t size, off_t offset,
+          bool uncached) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
+  off_t length = inode_length (inode);
+  off_t valid = length - inode->data.unwritten;
 
   if (inode->deny_write_cnt)
     return 0;
+  if (inode->data.compressed)
+    return write_compressed (inode, buffer, size, offset);
+
+  if (size > 0 && offset + size > valid)
+    {
+      /* Preallocated bytes skipped over by this write become part
+         of the written data, so they must now be zeroed. */
+      if (offset > valid && !zero_range (inode, valid, MIN (offset, length)))
+        return 0;
+      if (offset + size > length
+          && !extend_blocks (&inode->data, offset + size,
+                             offset, offset + size))
+        return 0;
+      inode->data.unwritten = MAX (inode_length (inode) - (offset + size), 0);
+      block_cache_write (fs_device, inode->sector, &inode->data);
+    }
 
   while (size > 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
-      // block_sector_t sector_idx = byte_to_sector (inode, offset);
-      block_sector_t sector_idx = get_inode_block (inode, size, offset, false);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      /* Block to write, starting byte offset within block. */
+      block_sector_t block;
+      int block_ofs = offset % BLOCK_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
+      /* Bytes left in inode, bytes left in block, lesser of the two. */
       off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+      int block_left = BLOCK_SIZE - block_ofs;
+      int min_left = inode_left < block_left ? inode_left : block_left;
 
-      /* Number of bytes to actually write into this sector. */
+      /* Number of bytes to actually write into this block. */
       int chunk_size = size < min_left ? size : min_left;
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_cache_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
+      /* A block shared with a clone gets a block of its own. */
+      block = unshare_block (inode, offset / BLOCK_SIZE,
+                             chunk_size == BLOCK_SIZE);
+      if (block == NO_SECTOR)
+        break;
+      if (uncached && block_ofs == 0 && chunk_size == BLOCK_SIZE)
         {
-          block_cache_write_partial (fs_device, sector_idx, 
-          buffer + bytes_written, sector_ofs, chunk_size);
+          /* Whole blocks that follow one another on disk go to it
+             in a single transfer. */
+          size_t cnt = contiguous_blocks (&inode->data, offset / BLOCK_SIZE,
+                                          size / BLOCK_SIZE, block, true);
+
+          chunk_size = cnt * BLOCK_SIZE;
+          block_cache_write_uncached_multiple (fs_device, block,
+                                               cnt * fs_block_sectors,
+                                               buffer + bytes_written);
         }
+      else
+        write_block (block, block_ofs, buffer + bytes_written, chunk_size,
+                     uncached);
 
       /* Advance. */
       size -= chunk_size;
@@ -725,3 +904,815 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Returns the number of sectors per block of the file system
+   that INODE was created in. */
+size_t
+inode_block_sectors (const struct inode *inode)
+{
+  return inode->data.block_sectors != 0 ? inode->data.block_sectors : 1;
+}
+
+/* Zeros bytes FROM through TO - 1 of INODE on disk.  Returns
+   true if successful, false if the disk filled up while copying
+   a shared block, which may leave some of the bytes zeroed. */
+static bool
+zero_range (struct inode *inode, off_t from, off_t to)
+{
+  while (from < to)
+    {
+      int block_ofs = from % BLOCK_SIZE;
+      int chunk_size = MIN (BLOCK_SIZE - block_ofs, to - from);
+      block_sector_t block = unshare_block (inode, from / BLOCK_SIZE,
+                                            chunk_size == BLOCK_SIZE);
+
+      if (block == NO_SECTOR)
+        return false;
+      clear_partial (block, block_ofs, chunk_size);
+      from += chunk_size;
+    }
+  return true;
+}
+
+/* Makes sure that INODE has blocks allocated for bytes OFFSET
+   through OFFSET + LEN - 1, extending it to OFFSET + LEN bytes
+   if it is shorter.  The new blocks are taken from a single run
+   of free blocks if possible and are not zeroed; reads of the
+   new bytes return zeros until they are written.  A compressed
+   file is only extended, since its space is allocated as its
+   clusters are written back.  Returns true
+   if successful, false if the arguments are out of range,
+   writes to INODE are denied, or the disk is full. */
+bool
+inode_allocate (struct inode *inode, off_t offset, off_t len) 
+{
+  struct inode_disk *data = &inode->data;
+  off_t length = data->length;
+  off_t end;
+
+  if (offset < 0 || len <= 0
+      || offset > MAX_FILE_SIZE || len > MAX_FILE_SIZE - offset
+      || inode->deny_write_cnt)
+    return false;
+  end = offset + len;
+  if (end <= length)
+    return true;
+  if (data->compressed)
+    return resize_compressed (inode, end);
+
+  /* Only the final block, if partial, gets zeroed, since bytes
+     past the end of file must read as zeros once the file is
+     extended by a write. */
+  if (!extend_blocks (data, end, length, end))
+    return false;
+  data->unwritten += end - length;
+  block_cache_write (fs_device, inode->sector, data);
+  return true;
+}
+
+/* Sets INODE's length to LENGTH bytes.  Shrinking INODE frees
+   the blocks past the new end; growing it allocates blocks as
+   inode_allocate() does.  Returns true if successful, false if
+   LENGTH is out of range, writes to INODE are denied, or the
+   disk is full. */
+bool
+inode_truncate (struct inode *inode, off_t length) 
+{
+  struct inode_disk *data = &inode->data;
+  off_t valid = data->length - data->unwritten;
+  block_sector_t tail = NO_SECTOR;
+
+  if (length < 0 || length > MAX_FILE_SIZE || inode->deny_write_cnt)
+    return false;
+  if (data->compressed)
+    return resize_compressed (inode, length);
+  if (length > data->length)
+    return inode_allocate (inode, data->length, length - data->length);
+  if (length == data->length)
+    return true;
+
+  /* The part of the new last block past the end gets zeroed, so
+     it must not be shared. */
+  if (length % BLOCK_SIZE != 0)
+    {
+      tail = unshare_block (inode, length / BLOCK_SIZE, false);
+      if (tail == NO_SECTOR)
+        return false;
+    }
+  release_blocks (data, bytes_to_blocks (data->length),
+                  bytes_to_blocks (length));
+  if (tail != NO_SECTOR)
+    clear_partial (tail, length % BLOCK_SIZE,
+                   BLOCK_SIZE - length % BLOCK_SIZE);
+  data->length = length;
+  data->unwritten = MAX (length - valid, 0);
+  block_cache_write (fs_device, inode->sector, data);
+  return true;
+}
+
+/* Shared blocks.
+
+   inode_clone() gives a new inode a copy of another's block map,
+   with indirect blocks of its own but the same data blocks, each
+   of which gains a reference (see refcount.c).  inode_dedup()
+   shares blocks the same way between files that happen to hold
+   identical blocks.  Before a shared
+   data block is written, unshare_block() moves the writer's copy
+   of it to a block of its own, and releasing a shared block only
+   drops a reference.  Compressed files need nothing more, since
+   they write each cluster back to new blocks anyway. */
+
+/* Sector of a data block on its way to a block of its own.  One
+   is enough, since the file system is used under a single
+   lock. */
+static uint8_t copy_buf[BLOCK_SECTOR_SIZE];
+
+/* Copies the contents of the block whose first sector is FROM
+   to the one whose first sector is TO. */
+static void
+copy_block (block_sector_t from, block_sector_t to)
+{
+  size_t i;
+
+  for (i = 0; i < fs_block_sectors; i++)
+    {
+      block_cache_read (fs_device, from + i, copy_buf);
+      block_cache_write (fs_device, to + i, copy_buf);
+    }
+}
+
+/* Returns the first sector of data block IDX of INODE, first
+   moving the block to a new block if other files share it.  The
+   block's contents are copied along unless WHOLE is true, meaning
+   that the caller is about to overwrite all of it.  Returns
+   NO_SECTOR if the disk is full. */
+static block_sector_t
+unshare_block (struct inode *inode, size_t idx, bool whole)
+{
+  block_sector_t old = lookup_block (&inode->data, idx);
+  block_sector_t new;
+
+  if (!refcount_shared (old))
+    return old;
+  if (!free_map_allocate (1, &new))
+    return NO_SECTOR;
+  if (!whole)
+    copy_block (old, new);
+  refcount_unref (old);
+  set_block (&inode->data, idx, new);
+  if (idx < DIRECT_BLOCKS)
+    block_cache_write (fs_device, inode->sector, &inode->data);
+  return new;
+}
+
+/* Adds a reference to the data block in *SECTORP on behalf of a
+   clone.  If the block already has as many references as can be
+   counted, gives the clone a copy in a new block instead and
+   stores its first sector in *SECTORP.  Returns true if successful,
+   false if the disk is full. */
+static bool
+share_block (block_sector_t *sectorp)
+{
+  block_sector_t copy;
+
+  if (*sectorp == NO_SECTOR || refcount_ref (*sectorp))
+    return true;
+  if (!free_map_allocate (1, &copy))
+    return false;
+  copy_block (*sectorp, copy);
+  *sectorp = copy;
+  return true;
+}
+
+/* Writes to SECTOR a new inode with the same length and contents
+   as INODE, which shares INODE's data blocks until one of the
+   two writes to them.  Only INODE's block map is copied, with
+   the new indirect blocks taken from a single run of free
+   blocks if one is large enough.  Returns true if successful.
+   On failure, returns false without allocating anything. */
+bool
+inode_clone (struct inode *inode, block_sector_t sector) 
+{
+  const struct inode_disk *data = &inode->data;
+  size_t cnt = bytes_to_blocks (data->length);
+  size_t need = index_cnt (cnt);
+  struct inode_disk *copy;
+  bool success = true;
+  size_t i;
+
+  if (!flush_cluster (inode))
+    return false;
+  copy = malloc (sizeof *copy);
+  if (copy == NULL)
+    return false;
+  *copy = *data;
+  copy->self = sector;
+
+  free_map_begin_batch ();
+  refcount_begin_batch ();
+  if (need > 1 && free_map_allocate (need, &reserve.next))
+    reserve.left = need;
+  for (i = 0; i < cnt; i++)
+    {
+      block_sector_t block = lookup_block (data, i);
+
+      if (!allocate_block (copy, i, FILL_HOLE))
+        {
+          release_blocks (copy, i, 0);
+          success = false;
+          break;
+        }
+      if (!share_block (&block))
+        {
+          release_blocks (copy, i + 1, 0);
+          success = false;
+          break;
+        }
+      set_block (copy, i, block);
+    }
+  ASSERT (reserve.left == 0 || !success);
+  if (reserve.left > 0)
+    free_map_release (reserve.next, reserve.left);
+  reserve.left = 0;
+  refcount_end_batch ();
+  free_map_end_batch ();
+
+  if (success)
+    block_cache_write (fs_device, sector, copy);
+  free (copy);
+  return success;
+}
+
+/* Makes each full data block of INODE that has the same
+   contents as a block recorded in INDEX share that block
+   instead of its own, which is released, and records the other
+   blocks in INDEX.  INDEX maps a hash of a block's contents to
+   the first sector of the first block found with those
+   contents, so passing the same INDEX for many files
+   deduplicates them all against each other.  Blocks are read
+   without entering the buffer cache.  Returns the number of
+   blocks that now share another's block. */
+size_t
+inode_dedup (struct inode *inode, struct ohash *index) 
+{
+  struct inode_disk *data = &inode->data;
+  struct run run = {0, 0};
+  size_t cnt, i;
+  size_t merged = 0;
+  uint8_t *buf;
+
+  if (!flush_cluster (inode))
+    return 0;
+  buf = malloc (2 * BLOCK_SIZE);
+  if (buf == NULL)
+    return 0;
+
+  /* A compressed file writes whole blocks, but an ordinary
+     file's last block may be partly garbage past its written
+     data. */
+  if (data->compressed)
+    cnt = bytes_to_blocks (data->length);
+  else
+    cnt = (data->length - data->unwritten) / BLOCK_SIZE;
+
+  free_map_begin_batch ();
+  refcount_begin_batch ();
+  for (i = 0; i < cnt; i++)
+    {
+      block_sector_t sector = lookup_block (data, i);
+      block_sector_t match;
+      unsigned hash;
+
+      if (sector == NO_SECTOR)
+        continue;
+      read_block (sector, 0, buf, BLOCK_SIZE, true);
+      hash = hash_bytes (buf, BLOCK_SIZE);
+      match = (uintptr_t) ohash_find (index, hash);
+      if (match == NO_SECTOR)
+        {
+          /* If INDEX is full and cannot grow, this fails and the
+             block is left out of INDEX.  That is harmless: later
+             copies of it just keep their own blocks. */
+          ohash_insert (index, hash, (void *) (uintptr_t) sector);
+          continue;
+        }
+      if (match == sector)
+        continue;
+
+      read_block (match, 0, buf + BLOCK_SIZE, BLOCK_SIZE, true);
+      if (memcmp (buf, buf + BLOCK_SIZE, BLOCK_SIZE)
+          || !refcount_ref (match))
+        continue;
+      set_block (data, i, match);
+      release_sector (&run, sector);
+      merged++;
+    }
+  release_run (&run);
+  refcount_end_batch ();
+  free_map_end_batch ();
+
+  if (merged > 0)
+    block_cache_write (fs_device, inode->sector, data);
+  free (buf);
+  return merged;
+}
+
+/* Compressed files.
+
+   A compressed file's data is divided into clusters of
+   CLUSTER_BLOCKS blocks, cluster C covering block map entries
+   C * CLUSTER_BLOCKS onward.  A cluster whose bytes are all
+   zero has no blocks, only holes.  A cluster that compresses
+   into fewer blocks than it spans is stored as a 16-bit length
+   followed by that many bytes of LZF data, in its first few
+   entries, with holes in the rest.  Any other cluster has its
+   bit set in the inode's `raw' bitmap and is stored block by
+   block, as in an ordinary file.
+
+   Each open compressed inode keeps the decompressed contents of
+   one cluster in memory.  Reads and writes go through it, and
+   it is compressed and written back to the buffer cache only
+   when another cluster is needed, when the inode is closed or
+   defragmented, or when inode_flush() is called.  Bytes of the
+   last cluster past end of file are always zero. */
+
+/* Decompressed contents of a cluster of a compressed file. */
+struct cluster
+  {
+    size_t idx;                 /* Cluster number. */
+    bool dirty;                 /* Modified since it was loaded? */
+    uint8_t data[];             /* Contents, CLUSTER_SIZE bytes. */
+  };
+
+/* Compressed form of a cluster, and scratch space for
+   compressing it.  Only one cluster is compressed or
+   decompressed at a time, since the file system is used under
+   a single lock. */
+static uint8_t packed[MAX_CLUSTER_SIZE];
+static uint16_t lzf_table[LZF_TABLE_SIZE];
+
+/* Returns true if cluster C of DATA is stored uncompressed. */
+static bool
+is_raw (const struct inode_disk *data, size_t c)
+{
+  return (data->raw[c / 32] >> (c % 32)) & 1;
+}
+
+/* Marks cluster C of DATA as stored uncompressed if RAW is true,
+   compressed otherwise. */
+static void
+set_raw (struct inode_disk *data, size_t c, bool raw)
+{
+  if (raw)
+    data->raw[c / 32] |= 1u << (c % 32);
+  else
+    data->raw[c / 32] &= ~(1u << (c % 32));
+}
+
+/* Returns the number of bytes of cluster C that lie within the
+   file whose on-disk form is DATA, which is 0 if the cluster is
+   past end of file. */
+static off_t
+cluster_bytes (const struct inode_disk *data, size_t c)
+{
+  off_t start = (off_t) c * CLUSTER_SIZE;
+
+  if (start >= data->length)
+    return 0;
+  return MIN (data->length - start, CLUSTER_SIZE);
+}
+
+/* Makes cluster C of INODE the one held in memory, writing back
+   the one held before if it was modified.  Returns true if
+   successful, false if memory or disk space runs out. */
+static bool
+load_cluster (struct inode *inode, size_t c)
+{
+  const struct inode_disk *data = &inode->data;
+  struct cluster *cl = inode->cluster;
+  size_t first = c * CLUSTER_BLOCKS;
+  size_t slots = bytes_to_blocks (cluster_bytes (data, c));
+  size_t i;
+
+  if (cl != NULL && cl->idx == c)
+    return true;
+  if (cl == NULL)
+    {
+      cl = inode->cluster = malloc (sizeof *cl + CLUSTER_SIZE);
+      if (cl == NULL)
+        return false;
+    }
+  else if (!flush_cluster (inode))
+    return false;
+
+  cl->idx = c;
+  cl->dirty = false;
+  memset (cl->data, 0, CLUSTER_SIZE);
+  if (slots == 0 || lookup_block (data, first) == NO_SECTOR)
+    return true;
+  if (is_raw (data, c))
+    {
+      for (i = 0; i < slots; i++)
+        if (lookup_block (data, first + i) != NO_SECTOR)
+          read_block (lookup_block (data, first + i), 0,
+                      cl->data + i * BLOCK_SIZE, BLOCK_SIZE, false);
+    }
+  else
+    {
+      uint16_t len;
+
+      read_block (lookup_block (data, first), 0, packed, BLOCK_SIZE, false);
+      memcpy (&len, packed, sizeof len);
+      for (i = 1; i < bytes_to_blocks (sizeof len + len) && i < slots; i++)
+        read_block (lookup_block (data, first + i), 0,
+                    packed + i * BLOCK_SIZE, BLOCK_SIZE, false);
+      lzf_decompress (packed + sizeof len, len, cl->data, CLUSTER_SIZE);
+    }
+  return true;
+}
+
+/* Compresses INODE's cluster in memory, if it was modified, and
+   writes it back, replacing the blocks it had before.  Returns
+   true if successful, false if the disk is full, in which case
+   the cluster stays in memory to be retried later and the file
+   on disk keeps the cluster's previous contents. */
+static bool
+flush_cluster (struct inode *inode)
+{
+  struct inode_disk *data = &inode->data;
+  struct cluster *cl = inode->cluster;
+  block_sector_t sectors[CLUSTER_BLOCKS];
+  size_t first, slots, used, i;
+  const uint8_t *src;
+  struct run run = {0, 0};
+  off_t bytes;
+  bool raw = false;
+
+  if (cl == NULL || !cl->dirty)
+    return true;
+  first = cl->idx * CLUSTER_BLOCKS;
+  bytes = cluster_bytes (data, cl->idx);
+  slots = bytes_to_blocks (bytes);
+
+  /* Decide how to store the cluster. */
+  for (i = 0; i < (size_t) bytes && cl->data[i] == 0; i++)
+    continue;
+  if (i == (size_t) bytes)
+    used = 0;
+  else
+    {
+      uint16_t len = 0;
+
+      if (slots > 1)
+        len = lzf_compress (cl->data, bytes, packed + sizeof len,
+                            (slots - 1) * BLOCK_SIZE - sizeof len,
+                            lzf_table);
+      raw = len == 0;
+      used = raw ? slots : bytes_to_blocks (sizeof len + len);
+      memcpy (packed, &len, sizeof len);
+    }
+  src = raw ? cl->data : packed;
+
+  /* Allocate new blocks, taken from a single run of free blocks
+     if possible, before releasing the old ones, so that if the
+     disk fills up the old blocks and their mapping are left as
+     they were. */
+  free_map_begin_batch ();
+  if (used > 1 && free_map_allocate (used, &reserve.next))
+    reserve.left = used;
+  for (i = 0; i < used; i++)
+    if (!allocate_sector (&sectors[i], FILL_NONE))
+      {
+        while (i-- > 0)
+          free_map_release (sectors[i], 1);
+        free_map_end_batch ();
+        return false;
+      }
+
+  /* Write the new blocks, then switch the map to them. */
+  for (i = 0; i < used; i++)
+    write_block (sectors[i], 0, src + i * BLOCK_SIZE, BLOCK_SIZE, false);
+  for (i = 0; i < slots; i++)
+    {
+      release_sector (&run, lookup_block (data, first + i));
+      set_block (data, first + i, i < used ? sectors[i] : NO_SECTOR);
+    }
+  release_run (&run);
+  free_map_end_batch ();
+
+  cl->dirty = false;
+  set_raw (data, cl->idx, raw);
+  block_cache_write (fs_device, inode->sector, data);
+  return true;
+}
+
+/* Reads SIZE bytes from compressed INODE into BUFFER, starting
+   at position OFFSET.  Returns the number of bytes read. */
+static off_t
+read_compressed (struct inode *inode, void *buffer_, off_t size,
+                 off_t offset) 
+{
+  uint8_t *buffer = buffer_;
+  off_t bytes_read = 0;
+
+  while (size > 0 && offset < inode_length (inode))
+    {
+      size_t c = offset / CLUSTER_SIZE;
+      int cluster_ofs = offset % CLUSTER_SIZE;
+      off_t chunk_size = MIN (MIN (size, CLUSTER_SIZE - cluster_ofs),
+                              inode_length (inode) - offset);
+
+      if (!load_cluster (inode, c))
+        break;
+      memcpy (buffer + bytes_read, inode->cluster->data + cluster_ofs,
+              chunk_size);
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_read += chunk_size;
+    }
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into compressed INODE, starting
+   at OFFSET, extending it if necessary.  Returns the number of
+   bytes written. */
+static off_t
+write_compressed (struct inode *inode, const void *buffer_, off_t size,
+                  off_t offset) 
+{
+  const uint8_t *buffer = buffer_;
+  off_t bytes_written = 0;
+
+  if (size > 0 && offset + size > inode_length (inode)
+      && !resize_compressed (inode, offset + size))
+    return 0;
+
+  while (size > 0)
+    {
+      size_t c = offset / CLUSTER_SIZE;
+      int cluster_ofs = offset % CLUSTER_SIZE;
+      off_t chunk_size = MIN (size, CLUSTER_SIZE - cluster_ofs);
+
+      if (!load_cluster (inode, c))
+        break;
+      memcpy (inode->cluster->data + cluster_ofs, buffer + bytes_written,
+              chunk_size);
+      inode->cluster->dirty = true;
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_written += chunk_size;
+    }
+  return bytes_written;
+}
+
+/* Sets the length of compressed INODE to LENGTH bytes.  Returns
+   true if successful, false if memory or disk space runs
+   out. */
+static bool
+resize_compressed (struct inode *inode, off_t length)
+{
+  struct inode_disk *data = &inode->data;
+  size_t old_cnt = bytes_to_blocks (data->length);
+  size_t new_cnt = bytes_to_blocks (length);
+
+  if (length > data->length)
+    {
+      if (!extend_blocks (data, length, 0, 0))
+        return false;
+    }
+  else if (length < data->length)
+    {
+      struct cluster *cl;
+
+      /* Hold the new last cluster in memory while the blocks past
+         the new end are freed, since some of them may hold part
+         of its compressed form. */
+      if (length % CLUSTER_SIZE != 0)
+        {
+          if (!load_cluster (inode, length / CLUSTER_SIZE))
+            return false;
+          memset (inode->cluster->data + length % CLUSTER_SIZE, 0,
+                  CLUSTER_SIZE - length % CLUSTER_SIZE);
+          inode->cluster->dirty = true;
+        }
+
+      /* Forget a cluster held in memory that is now past the
+         end. */
+      cl = inode->cluster;
+      if (cl != NULL && (off_t) cl->idx * CLUSTER_SIZE >= length)
+        {
+          free (cl);
+          inode->cluster = NULL;
+        }
+
+      release_blocks (data, old_cnt, new_cnt);
+      data->length = length;
+    }
+  block_cache_write (fs_device, inode->sector, data);
+  return true;
+}
+
+/* Makes INODE store its data compressed if COMPRESSED is true,
+   uncompressed otherwise.  Returns true if successful, false if
+   that would change how INODE is stored and INODE is not
+   empty. */
+bool
+inode_set_compressed (struct inode *inode, bool compressed) 
+{
+  struct inode_disk *data = &inode->data;
+
+  if ((data->compressed != 0) == compressed)
+    return true;
+  if (data->length != 0)
+    return false;
+  data->compressed = compressed;
+  memset (data->raw, 0, sizeof data->raw);
+  block_cache_write (fs_device, inode->sector, data);
+  return true;
+}
+
+/* Returns true if INODE stores its data compressed. */
+bool
+inode_is_compressed (const struct inode *inode) 
+{
+  return inode->data.compressed != 0;
+}
+
+/* Writes back the cluster held in memory for INODE, an
+   ohash_action_func. */
+static void
+flush_one (uint32_t sector UNUSED, void *inode, void *aux UNUSED) 
+{
+  flush_cluster (inode);
+}
+
+/* Writes back the modified clusters that open compressed files
+   hold in memory. */
+void
+inode_flush (void) 
+{
+  ohash_apply (&open_inodes, flush_one, NULL);
+}
+
+/* Calls FUNC for each block that INODE occupies on disk, passing
+   its first sector and AUX along: first the inode's own sector,
+   then its data blocks in file order, each indirect block just
+   before the first data block it maps.  Holes in a compressed
+   file are skipped. */
+void
+inode_for_each_sector (struct inode *inode, inode_sector_func *func,
+                       void *aux)
+{
+  const struct inode_disk *data = &inode->data;
+  size_t cnt = bytes_to_blocks (data->length);
+  size_t i;
+
+  func (inode->sector, false, aux);
+  for (i = 0; i < cnt; i++)
+    {
+      size_t dbl_idx = i - DIRECT_BLOCKS - INDIRECT_BLOCKS;
+
+      if (i == DIRECT_BLOCKS)
+        func (data->indirect, false, aux);
+      else if (i >= DIRECT_BLOCKS + INDIRECT_BLOCKS)
+        {
+          if (dbl_idx == 0)
+            func (data->dbl_indirect, false, aux);
+          if (dbl_idx % INDIRECT_BLOCKS == 0)
+            func (read_index (data->dbl_indirect, dbl_idx / INDIRECT_BLOCKS),
+                  false, aux);
+        }
+      if (lookup_block (data, i) != NO_SECTOR)
+        func (lookup_block (data, i), true, aux);
+    }
+}
+
+/* Extent of the blocks of an inode other than the inode itself,
+   as gathered by extend_span(). */
+struct span 
+  {
+    size_t cnt;                 /* Number of blocks seen. */
+    block_sector_t lo, hi;      /* First sectors of lowest and
+                                   highest block. */
+  };
+
+/* Adds SECTOR to the span in SPAN_, skipping the inode's own
+   sector, which inode_for_each_sector() passes first.  An
+   inode_sector_func. */
+static void
+extend_span (block_sector_t sector, bool data UNUSED, void *span_) 
+{
+  struct span *span = span_;
+
+  if (span->cnt++ == 0)
+    return;
+  if (span->cnt == 2 || sector < span->lo)
+    span->lo = sector;
+  if (span->cnt == 2 || sector > span->hi)
+    span->hi = sector;
+}
+
+/* Moves the data and indirect blocks of INODE into a single run
+   of free blocks, chosen first-fit from the start of the disk
+   and laid out in the order that extend_blocks() would allocate
+   them on an empty disk.  Does nothing if INODE's blocks already
+   form a single run that is no further from the start of the
+   disk than the new one would be, if no large enough run of
+   free blocks exists, or if INODE shares data blocks with a
+   clone, since moving them would end the sharing.  Returns true
+   if INODE was moved.
+
+   Each block is copied through the buffer cache before INODE's
+   block map is switched to the new blocks, and the old blocks
+   are freed only afterward, so a reader finds the file's
+   contents wherever the map points at any moment.  The caller
+   must keep INODE from being written or extended meanwhile. */
+bool
+inode_defrag (struct inode *inode) 
+{
+  struct inode_disk *data = &inode->data;
+  size_t cnt = bytes_to_blocks (data->length);
+  size_t total;
+  struct span span = {0, 0, 0};
+  struct inode_disk *maps;
+  block_sector_t start, next;
+  size_t i;
+
+  if (!flush_cluster (inode))
+    return false;
+  for (i = 0; i < cnt; i++)
+    if (refcount_shared (lookup_block (data, i)))
+      return false;
+  inode_for_each_sector (inode, extend_span, &span);
+  total = span.cnt - 1;
+  if (total == 0 || !free_map_allocate (total, &start))
+    return false;
+  if ((span.hi - span.lo) / fs_block_sectors + 1 == total
+      && span.lo <= start)
+    {
+      free_map_release (start, total);
+      return false;
+    }
+  maps = malloc (2 * sizeof *maps);
+  if (maps == NULL)
+    {
+      free_map_release (start, total);
+      return false;
+    }
+
+  /* Copy the data blocks into maps[1], a new block map for
+     INODE, allocating each indirect block just before the first
+     data block it maps. */
+  maps[1] = *data;
+  next = start;
+  for (i = 0; i < cnt; i++)
+    {
+      size_t dbl_idx = i - DIRECT_BLOCKS - INDIRECT_BLOCKS;
+      block_sector_t sector;
+
+      if (i == DIRECT_BLOCKS)
+        {
+          clear_sector (maps[1].indirect = next);
+          next += fs_block_sectors;
+        }
+      else if (i >= DIRECT_BLOCKS + INDIRECT_BLOCKS)
+        {
+          if (dbl_idx == 0)
+            {
+              clear_sector (maps[1].dbl_indirect = next);
+              next += fs_block_sectors;
+            }
+          if (dbl_idx % INDIRECT_BLOCKS == 0)
+            {
+              clear_sector (next);
+              write_index (maps[1].dbl_indirect, dbl_idx / INDIRECT_BLOCKS,
+                           next);
+              next += fs_block_sectors;
+            }
+        }
+      if (lookup_block (data, i) == NO_SECTOR)
+        continue;
+
+      sector = next;
+      next += fs_block_sectors;
+      copy_block (lookup_block (data, i), sector);
+      if (i < DIRECT_BLOCKS)
+        maps[1].blocks[i] = sector;
+      else if (i < DIRECT_BLOCKS + INDIRECT_BLOCKS)
+        write_index (maps[1].indirect, i - DIRECT_BLOCKS, sector);
+      else
+        write_index (read_index (maps[1].dbl_indirect,
+                                 dbl_idx / INDIRECT_BLOCKS),
+                     dbl_idx % INDIRECT_BLOCKS, sector);
+    }
+  ASSERT (next == start + total * fs_block_sectors);
+
+  /* Switch to the new map, then free the old blocks. */
+  maps[0] = *data;
+  *data = maps[1];
+  block_cache_write (fs_device, inode->sector, data);
+  release_blocks (&maps[0], cnt, 0);
+
+  free (maps);
+  return true;
+}
@@ -2,10 +2,12 @@
 #define FILESYS_INODE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 #include "devices/block.h"
 
 struct bitmap;
+struct ohash;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
@@ -16,26 +18,27 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_uncached (struct inode *, void *, off_t size, off_t offset);
+off_t inode_write_uncached (struct inode *, const void *, off_t size,
+                            off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
-
-void free_resources (void * p1, void * p2, void * p3);
-bool sector_allocation (size_t sectors, size_t *direct_p,
- 	size_t *indirect_p, size_t *dbl_p, size_t *remain_p);
-size_t alloc_direct_sectors (block_sector_t *ptr, int index, size_t sectors);
-size_t alloc_indirect_sectors (block_sector_t *ptr, int index, size_t sectors);
-size_t alloc_double_indirect_sectors (block_sector_t *ptr, int index,
-					 size_t sectors, size_t remaining);
-
-bool eof_reached (struct inode *node, off_t pos);
-int no_bytes (void);
-block_sector_t get_inode_block (struct inode *node, off_t size, off_t pos, bool read);
-block_sector_t extend_file (struct inode *node, off_t pos);
-block_sector_t direct_block (struct inode *node, off_t block);
-block_sector_t indirect_block (struct inode *node, off_t block);
-block_sector_t dbl_indirect_block (struct inode *node, off_t block);
-
-
+size_t inode_block_sectors (const struct inode *);
+bool inode_allocate (struct inode *, off_t offset, off_t len);
+bool inode_truncate (struct inode *, off_t length);
+bool inode_clone (struct inode *, block_sector_t);
+size_t inode_dedup (struct inode *, struct ohash *index);
+bool inode_set_compressed (struct inode *, bool);
+bool inode_is_compressed (const struct inode *);
+void inode_flush (void);
+
+/* Called by inode_for_each_sector() for each block an inode
+   occupies, with the block's first sector, or the inode's own
+   sector for the inode.  DATA is true for a data block, false
+   for the inode itself or one of its indirect blocks. */
+typedef void inode_sector_func (block_sector_t sector, bool data, void *aux);
+void inode_for_each_sector (struct inode *, inode_sector_func *, void *aux);
+bool inode_defrag (struct inode *);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,289 @@
+#include "filesys/layout.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "filesys/refcount.h"
+#include "threads/malloc.h"
+
+/* Reports how the file system is laid out on disk: where each
+   file's blocks are, how fragmented its data and the free space
+   are, and how much of the disk goes to metadata.  Walks the
+   free map and the block map of every inode reachable from the
+   root directory, so it also notices blocks that are in use but
+   not referenced, referenced by more or fewer files than their
+   reference counts say, or referenced but free.  Blocks are
+   named by their first sector, except that the system files'
+   inodes may share the first block. */
+
+/* Number of buckets in the free run histogram.  Bucket I counts
+   runs of 2**I to 2**(I+1) - 1 free blocks; the last bucket
+   also counts all longer runs. */
+#define RUN_BUCKETS 16
+
+/* Blocks of a single inode. */
+struct file_layout
+  {
+    size_t data;                /* Data blocks. */
+    size_t meta;                /* Inode and indirect blocks. */
+    size_t runs;                /* Runs of consecutive data blocks. */
+    block_sector_t next;        /* Block that continues the last run. */
+  };
+
+/* The whole file system. */
+struct fs_layout
+  {
+    struct bitmap *owned;       /* Sectors referenced by some inode. */
+    uint16_t *refs;             /* Number of references per sector. */
+    struct file_layout *file;   /* Inode being walked. */
+    size_t files;               /* Inodes walked. */
+    size_t data;                /* Total data blocks. */
+    size_t meta;                /* Total inode and indirect blocks. */
+    size_t runs;                /* Total runs of data blocks. */
+    size_t shared;              /* Blocks referenced more than once. */
+    size_t miscounted;          /* Blocks whose reference count is off. */
+    size_t unallocated;         /* Referenced blocks marked free. */
+    size_t bad;                 /* References past the end of the disk. */
+  };
+
+static void count_sector (block_sector_t, bool data, void *fs_);
+static void walk_inode (struct fs_layout *, struct inode *, const char *name);
+static void walk_sector (struct fs_layout *, block_sector_t,
+                         const char *name);
+static size_t print_free_space (const struct fs_layout *);
+static void check_refcounts (struct fs_layout *);
+static void print_ratio (size_t num, size_t den);
+
+/* Prints the layout of the file system.  Returns true if its
+   metadata is consistent, false otherwise. */
+bool
+layout_print (void) 
+{
+  struct fs_layout fs;
+  struct dir *dir;
+  char name[NAME_MAX + 1];
+  size_t entries = 0;
+  size_t leaked;
+
+  memset (&fs, 0, sizeof fs);
+  fs.owned = bitmap_create (block_size (fs_device));
+  fs.refs = calloc (block_size (fs_device), sizeof *fs.refs);
+  if (fs.owned == NULL || fs.refs == NULL)
+    {
+      printf ("layout: out of memory\n");
+      bitmap_destroy (fs.owned);
+      free (fs.refs);
+      return false;
+    }
+
+  printf ("Layout of %s (%"PRDSNu" sectors, %zu per block):\n",
+          block_name (fs_device), block_size (fs_device), fs_block_sectors);
+  printf ("%8s %9s %6s %5s %5s  %s\n",
+          "inode", "bytes", "data", "meta", "runs", "name");
+  walk_sector (&fs, FREE_MAP_SECTOR, "[free map]");
+  walk_sector (&fs, ROOT_DIR_SECTOR, "[root]");
+  walk_sector (&fs, REFCOUNT_SECTOR, "[refcounts]");
+
+  dir = dir_open_root ();
+  if (dir == NULL)
+    PANIC ("root dir open failed");
+  while (dir_readdir (dir, name)) 
+    {
+      struct inode *inode;
+
+      entries++;
+      if (dir_lookup (dir, name, &inode))
+        {
+          walk_inode (&fs, inode, name);
+          inode_close (inode);
+        }
+      else
+        printf ("%s: lookup failed\n", name);
+    }
+  printf ("Root directory: %zu entries in %"PROTd" bytes\n",
+          entries, inode_length (dir_get_inode (dir)));
+  dir_close (dir);
+
+  printf ("Data: %zu blocks in %zu runs, ", fs.data, fs.runs);
+  print_ratio (fs.data, fs.runs);
+  printf (" blocks per run\n");
+  printf ("Metadata: %zu blocks, ", fs.meta);
+  print_ratio (100 * fs.meta, fs.data + fs.meta);
+  printf ("%% of allocated blocks\n");
+  leaked = print_free_space (&fs);
+  check_refcounts (&fs);
+  printf ("Shared: %zu blocks referenced by more than one file\n",
+          fs.shared);
+
+  printf ("Consistency: %zu leaked, %zu miscounted, %zu unallocated, "
+          "%zu out of range\n", leaked, fs.miscounted, fs.unallocated,
+          fs.bad);
+  bitmap_destroy (fs.owned);
+  free (fs.refs);
+  return (leaked == 0 && fs.miscounted == 0 && fs.unallocated == 0
+          && fs.bad == 0);
+}
+
+/* Accounts for the block that starts at SECTOR, which belongs to
+   the inode being walked in FS_ and holds data if DATA is true
+   or metadata otherwise.  An inode_sector_func. */
+static void
+count_sector (block_sector_t sector, bool data, void *fs_) 
+{
+  struct fs_layout *fs = fs_;
+  struct file_layout *file = fs->file;
+
+  if (sector >= block_size (fs_device) / fs_block_sectors * fs_block_sectors)
+    {
+      fs->bad++;
+      return;
+    }
+  bitmap_mark (fs->owned, sector);
+  if (fs->refs[sector] < UINT16_MAX)
+    fs->refs[sector]++;
+  if (!free_map_in_use (sector))
+    fs->unallocated++;
+
+  if (data)
+    {
+      if (file->data == 0 || sector != file->next)
+        file->runs++;
+      file->next = sector + fs_block_sectors;
+      file->data++;
+    }
+  else 
+    {
+      /* An indirect block between two data blocks does not
+         break their run. */
+      if (file->data > 0 && sector == file->next)
+        file->next = sector + fs_block_sectors;
+      file->meta++;
+    }
+}
+
+/* Walks INODE, named NAME, and prints a line about it. */
+static void
+walk_inode (struct fs_layout *fs, struct inode *inode, const char *name) 
+{
+  struct file_layout file;
+
+  memset (&file, 0, sizeof file);
+  fs->file = &file;
+  inode_for_each_sector (inode, count_sector, fs);
+  fs->file = NULL;
+
+  printf ("%8"PRDSNu" %9"PROTd" %6zu %5zu %5zu  %s\n",
+          inode_get_inumber (inode), inode_length (inode),
+          file.data, file.meta, file.runs, name);
+  fs->files++;
+  fs->data += file.data;
+  fs->meta += file.meta;
+  fs->runs += file.runs;
+}
+
+/* Walks the inode in SECTOR, named NAME. */
+static void
+walk_sector (struct fs_layout *fs, block_sector_t sector, const char *name)
+{
+  struct inode *inode = inode_open (sector);
+
+  if (inode == NULL)
+    PANIC ("%s: inode open failed", name);
+  walk_inode (fs, inode, name);
+  inode_close (inode);
+}
+
+/* Prints statistics about free space and a histogram of the
+   lengths of runs of free blocks.  Returns the number of blocks
+   that are in use but were not referenced by any inode in FS. */
+static size_t
+print_free_space (const struct fs_layout *fs) 
+{
+  size_t buckets[RUN_BUCKETS];
+  size_t blocks = block_size (fs_device) / fs_block_sectors;
+  size_t free_cnt = 0, run_cnt = 0, largest = 0, leaked = 0;
+  size_t run = 0;
+  size_t i;
+
+  memset (buckets, 0, sizeof buckets);
+  for (i = 0; i <= blocks; i++) 
+    {
+      block_sector_t sector = i * fs_block_sectors;
+
+      if (i < blocks && !free_map_in_use (sector))
+        {
+          run++;
+          continue;
+        }
+      if (i < blocks
+          && !bitmap_contains (fs->owned, sector, fs_block_sectors, true))
+        leaked++;
+      if (run > 0)
+        {
+          size_t bucket = 0;
+
+          while (bucket + 1 < RUN_BUCKETS && run >> (bucket + 1) != 0)
+            bucket++;
+          buckets[bucket]++;
+          free_cnt += run;
+          run_cnt++;
+          if (run > largest)
+            largest = run;
+          run = 0;
+        }
+    }
+
+  printf ("Free: %zu blocks in %zu runs, largest %zu\n",
+          free_cnt, run_cnt, largest);
+  printf ("Free runs by length:");
+  for (i = 0; i < RUN_BUCKETS; i++)
+    if (buckets[i] != 0)
+      {
+        if (i == 0)
+          printf (" 1:%zu", buckets[i]);
+        else if (i + 1 == RUN_BUCKETS)
+          printf (" %zu+:%zu", (size_t) 1 << i, buckets[i]);
+        else
+          printf (" %zu-%zu:%zu", (size_t) 1 << i,
+                  ((size_t) 2 << i) - 1, buckets[i]);
+      }
+  printf ("\n");
+  return leaked;
+}
+
+/* Prints NUM / DEN to one decimal place. */
+static void
+print_ratio (size_t num, size_t den) 
+{
+  size_t tenths = den != 0 ? (10 * num + den / 2) / den : 0;
+  printf ("%zu.%zu", tenths / 10, tenths % 10);
+}
+
+/* Compares the number of references to each block seen while
+   walking FS with the block's reference count, counting the
+   blocks that are shared and those whose count is off. */
+static void
+check_refcounts (struct fs_layout *fs) 
+{
+  block_sector_t end = block_size (fs_device) / fs_block_sectors
+                       * fs_block_sectors;
+  block_sector_t sector;
+
+  for (sector = 0; sector < end; sector++)
+    if (fs->refs[sector] == 0)
+      {
+        if (sector % fs_block_sectors == 0 && refcount_shared (sector))
+          fs->miscounted++;
+      }
+    else 
+      {
+        if (fs->refs[sector] > 1)
+          fs->shared++;
+        if (fs->refs[sector] != refcount_get (sector))
+          fs->miscounted++;
+      }
+}
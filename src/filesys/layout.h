@@ -0,0 +1,8 @@
+#ifndef FILESYS_LAYOUT_H
+#define FILESYS_LAYOUT_H
+
+#include <stdbool.h>
+
+bool layout_print (void);
+
+#endif /* filesys/layout.h */
@@ -0,0 +1,175 @@
+#include "filesys/refcount.h"
+#include <debug.h>
+#include <stdint.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+
+/* Reference counts of data blocks shared between files by
+   cloning.  The count file holds one byte per block of the disk,
+   the number of files that refer to the block beyond the first,
+   so that a block in use by a single file, like every block of a
+   disk without clones, has a count of 0.  Blocks are named by
+   any of their sectors, normally the first.  The whole
+   table is kept in memory, and each change is written through
+   to the count file at once, or at the end of a batch. */
+
+/* Most references beyond the first that a block can have. */
+#define MAX_EXTRA UINT8_MAX
+
+static struct file *refcount_file;   /* Count file. */
+static uint8_t *counts;              /* Extra references per block. */
+static int batch_depth;              /* Nesting of refcount_begin_batch(). */
+static size_t dirty_lo;              /* Counts changed during the batch */
+static size_t dirty_hi;              /*   lie in [dirty_lo, dirty_hi). */
+
+/* Writes the counts of blocks LO through HI - 1 to the count
+   file. */
+static void
+write_counts (size_t lo, size_t hi)
+{
+  if (refcount_file != NULL
+      && file_write_at (refcount_file, counts + lo, hi - lo, lo)
+         != (off_t) (hi - lo))
+    PANIC ("can't write reference counts");
+}
+
+/* Writes the count of BLOCK to the count file, or if a batch is
+   in progress, notes that it must be written when the batch
+   ends. */
+static void
+write_count (size_t block)
+{
+  if (batch_depth == 0)
+    write_counts (block, block + 1);
+  else if (dirty_lo == dirty_hi)
+    {
+      dirty_lo = block;
+      dirty_hi = block + 1;
+    }
+  else 
+    {
+      if (block < dirty_lo)
+        dirty_lo = block;
+      if (block >= dirty_hi)
+        dirty_hi = block + 1;
+    }
+}
+
+/* Returns the number of blocks on the file system device. */
+static size_t
+block_cnt (void)
+{
+  return block_size (fs_device) / fs_block_sectors;
+}
+
+/* Initializes the reference counts, with no block shared. */
+void
+refcount_init (void)
+{
+  counts = calloc (block_cnt (), 1);
+  if (counts == NULL)
+    PANIC ("reference count creation failed--file system device is "
+           "too large");
+}
+
+/* Creates a new count file on disk, with no block shared. */
+void
+refcount_create (void)
+{
+  if (!inode_create (REFCOUNT_SECTOR, block_cnt ()))
+    PANIC ("reference count file creation failed");
+}
+
+/* Opens the count file and reads it from disk. */
+void
+refcount_open (void)
+{
+  off_t size = block_cnt ();
+
+  refcount_file = file_open (inode_open (REFCOUNT_SECTOR));
+  if (refcount_file == NULL)
+    PANIC ("can't open reference count file");
+  if (file_read_at (refcount_file, counts, size, 0) != size)
+    PANIC ("can't read reference counts");
+}
+
+/* Starts a batch of reference count updates.  Until the
+   matching call to refcount_end_batch(), changes are made only
+   in memory, and then the range of the count file that they
+   span is written at once.  Batches may nest. */
+void
+refcount_begin_batch (void)
+{
+  batch_depth++;
+}
+
+/* Ends a batch of reference count updates started by
+   refcount_begin_batch(), writing the changed counts to disk
+   if this is the outermost batch. */
+void
+refcount_end_batch (void)
+{
+  ASSERT (batch_depth > 0);
+  if (--batch_depth == 0 && dirty_lo != dirty_hi)
+    {
+      write_counts (dirty_lo, dirty_hi);
+      dirty_lo = dirty_hi = 0;
+    }
+}
+
+/* Closes the count file, which is always up to date on disk. */
+void
+refcount_close (void)
+{
+  file_close (refcount_file);
+  refcount_file = NULL;
+}
+
+/* Returns true if the block that contains SECTOR is referred to
+   by more than one file. */
+bool
+refcount_shared (block_sector_t sector)
+{
+  return counts[sector / fs_block_sectors] != 0;
+}
+
+/* Returns the number of files that refer to the block that
+   contains SECTOR, which must be in use. */
+unsigned
+refcount_get (block_sector_t sector)
+{
+  return counts[sector / fs_block_sectors] + 1;
+}
+
+/* Adds a reference to the block that contains SECTOR, which must
+   be in use.  Returns true if successful, false if the block
+   already has as many references as can be counted. */
+bool
+refcount_ref (block_sector_t sector)
+{
+  size_t block = sector / fs_block_sectors;
+
+  if (counts[block] == MAX_EXTRA)
+    return false;
+  counts[block]++;
+  write_count (block);
+  return true;
+}
+
+/* Drops a reference to the block that contains SECTOR if other
+   files still refer to it, and returns true.  Returns false,
+   changing nothing, if the block has a single reference, which
+   the caller should release to the free map instead. */
+bool
+refcount_unref (block_sector_t sector)
+{
+  size_t block = sector / fs_block_sectors;
+
+  if (counts[block] == 0)
+    return false;
+  counts[block]--;
+  write_count (block);
+  return true;
+}
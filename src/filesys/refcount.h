@@ -0,0 +1,19 @@
+#ifndef FILESYS_REFCOUNT_H
+#define FILESYS_REFCOUNT_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+void refcount_init (void);
+void refcount_create (void);
+void refcount_open (void);
+void refcount_close (void);
+
+bool refcount_shared (block_sector_t);
+unsigned refcount_get (block_sector_t);
+bool refcount_ref (block_sector_t);
+bool refcount_unref (block_sector_t);
+void refcount_begin_batch (void);
+void refcount_end_batch (void);
+
+#endif /* filesys/refcount.h */
@@ -162,8 +162,14 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
 
   /* This is equivalent to `b->bits[idx] |= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the OR instruction in [IA32-v2b]. */
+     the description of the OR instruction in [IA32-v2b].  Other
+     architectures only see this code in host builds of the file
+     system (see utils/fshost), where it need not be atomic. */
+#ifdef __i386__
   asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+#else
+  b->bits[idx] |= mask;
+#endif
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -176,7 +182,11 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
+#ifdef __i386__
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+#else
+  b->bits[idx] &= ~mask;
+#endif
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -191,7 +201,11 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
+#ifdef __i386__
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+#else
+  b->bits[idx] ^= mask;
+#endif
 }
 
 /* Returns the value of the bit numbered IDX in B. */
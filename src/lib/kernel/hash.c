@@ -298,7 +298,18 @@ hash_string (const char *s_)
 unsigned
 hash_int (int i) 
 {
-  return hash_bytes (&i, sizeof i);
+  /* MurmurHash3 32-bit finalizer: mixes a whole word at a time,
+     avalanching every input bit into the low-order bits that
+     select a bucket. */
+  unsigned hash = i;
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+
+  return hash;
 }
 
 /* Returns the bucket in H that E belongs in. */
@@ -0,0 +1,150 @@
+/* LZF compression.
+
+   See lzf.h for a description of the format. */
+
+#include "lzf.h"
+#include <string.h>
+#include "../debug.h"
+
+#define MAX_LITERAL 32                  /* Longest literal run. */
+#define MAX_DISTANCE 8192               /* Farthest back reference. */
+#define MAX_MATCH (7 + 255 + 2)         /* Longest back reference. */
+
+/* Returns the hash table slot for the 3 bytes at P. */
+static inline size_t
+hash3 (const uint8_t *p)
+{
+  uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+  return ((v * 2654435761u) >> 22) & (LZF_TABLE_SIZE - 1);
+}
+
+/* Compresses the IN_LEN bytes at IN_ into the OUT_LEN bytes at
+   OUT_, using TABLE as scratch space.  IN_LEN may not exceed
+   65535.  Returns the number of bytes of compressed data, or 0
+   if they would not fit in OUT_LEN bytes. */
+size_t
+lzf_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+              uint16_t table[LZF_TABLE_SIZE])
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+  size_t lit = 0;               /* Pending literals, ending at IP. */
+
+  ASSERT (in_len < 65536);
+  memset (table, 0, LZF_TABLE_SIZE * sizeof *table);
+
+  while (ip < in_len)
+    {
+      size_t len = 0;
+      size_t ref = 0;
+
+      if (ip + 2 < in_len)
+        {
+          size_t h = hash3 (in + ip);
+
+          /* Table entries are positions plus 1, so that 0 is
+             empty. */
+          ref = table[h];
+          table[h] = ip + 1;
+          if (ref-- != 0 && ip - ref <= MAX_DISTANCE
+              && in[ref] == in[ip] && in[ref + 1] == in[ip + 1]
+              && in[ref + 2] == in[ip + 2])
+            {
+              size_t max = in_len - ip < MAX_MATCH ? in_len - ip : MAX_MATCH;
+              for (len = 3; len < max && in[ref + len] == in[ip + len]; len++)
+                continue;
+            }
+        }
+
+      if (len == 0)
+        {
+          ip++;
+          if (++lit < MAX_LITERAL && ip < in_len)
+            continue;
+        }
+
+      /* Flush the pending literals. */
+      if (lit > 0)
+        {
+          if (op + 1 + lit > out_len)
+            return 0;
+          out[op++] = lit - 1;
+          memcpy (out + op, in + ip - lit, lit);
+          op += lit;
+          lit = 0;
+        }
+
+      /* Emit the back reference. */
+      if (len > 0)
+        {
+          size_t dist = ip - ref - 1;
+          size_t field = len - 2;
+
+          if (op + 3 > out_len)
+            return 0;
+          if (field < 7)
+            out[op++] = (field << 5) | (dist >> 8);
+          else
+            {
+              out[op++] = (7 << 5) | (dist >> 8);
+              out[op++] = field - 7;
+            }
+          out[op++] = dist & 0xff;
+          ip += len;
+        }
+    }
+  return op;
+}
+
+/* Decompresses the IN_LEN bytes of compressed data at IN_ into
+   the OUT_LEN bytes at OUT_.  Returns the number of bytes of
+   decompressed data, or 0 if the data is corrupt or would not
+   fit in OUT_LEN bytes. */
+size_t
+lzf_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+
+  while (ip < in_len)
+    {
+      unsigned ctrl = in[ip++];
+
+      if (ctrl < MAX_LITERAL)
+        {
+          size_t lit = ctrl + 1;
+
+          if (ip + lit > in_len || op + lit > out_len)
+            return 0;
+          memcpy (out + op, in + ip, lit);
+          ip += lit;
+          op += lit;
+        }
+      else
+        {
+          size_t len = ctrl >> 5;
+          size_t dist;
+
+          if (len == 7)
+            {
+              if (ip >= in_len)
+                return 0;
+              len += in[ip++];
+            }
+          len += 2;
+          if (ip >= in_len)
+            return 0;
+          dist = ((ctrl & 0x1f) << 8) + in[ip++] + 1;
+          if (dist > op || op + len > out_len)
+            return 0;
+
+          /* The source may overlap the destination, so copy a
+             byte at a time. */
+          for (; len > 0; len--, op++)
+            out[op] = out[op - dist];
+        }
+    }
+  return op;
+}
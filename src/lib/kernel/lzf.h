@@ -0,0 +1,33 @@
+#ifndef __LIB_KERNEL_LZF_H
+#define __LIB_KERNEL_LZF_H
+
+/* Fast LZ77-family compression in the LZF format.
+
+   Compressed data is a sequence of items, each introduced by a
+   control byte C:
+
+     - C < 32: a run of C + 1 literal bytes follows.
+
+     - C >= 32: a back reference.  Its length field is C >> 5,
+       plus the next byte if the field is 7; the reference
+       copies that many bytes plus 2 from earlier in the output.
+       The distance back is ((C & 0x1f) << 8) plus the following
+       byte, plus 1, so references reach up to 8 kB.
+
+   The compressor finds matches through a small hash table of
+   recent 3-byte sequences, trading ratio for speed.  It never
+   needs more than about 1/32 more space than its input, but
+   the caller supplies the output limit and gets back 0 if the
+   data does not fit, so incompressible data costs little. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of entries in the table passed to lzf_compress(). */
+#define LZF_TABLE_SIZE 1024
+
+size_t lzf_compress (const void *, size_t, void *, size_t,
+                     uint16_t table[LZF_TABLE_SIZE]);
+size_t lzf_decompress (const void *, size_t, void *, size_t);
+
+#endif /* lib/kernel/lzf.h */
@@ -0,0 +1,212 @@
+/* Open-addressing hash table with Robin Hood insertion.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "hash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Smallest table we will allocate. */
+#define MIN_SLOTS 16
+
+static bool resize (struct ohash *, size_t slot_cnt);
+static void place (struct ohash *, uint32_t key, void *value);
+static struct ohash_slot *find_slot (const struct ohash *, uint32_t key);
+
+/* Initializes hash table H with room for at least CNT elements
+   before it has to grow.  Returns true if successful, false if
+   memory allocation fails. */
+bool
+ohash_init (struct ohash *h, size_t cnt) 
+{
+  size_t slot_cnt = MIN_SLOTS;
+
+  while (slot_cnt / 4 * 3 < cnt)
+    slot_cnt *= 2;
+
+  h->elem_cnt = 0;
+  h->slot_cnt = 0;
+  h->slots = NULL;
+  return resize (h, slot_cnt);
+}
+
+/* Destroys hash table H, freeing its slot array.  The values
+   stored in H are not freed. */
+void
+ohash_destroy (struct ohash *h) 
+{
+  free (h->slots);
+  h->slots = NULL;
+  h->slot_cnt = h->elem_cnt = 0;
+}
+
+/* Returns the value stored with KEY in H, or a null pointer if
+   KEY is not in H. */
+void *
+ohash_find (const struct ohash *h, uint32_t key) 
+{
+  struct ohash_slot *slot = find_slot (h, key);
+  return slot != NULL ? slot->value : NULL;
+}
+
+/* Stores VALUE, which must not be null, with KEY in H.
+   Returns true if successful.  Returns false if KEY is already
+   in H, which is left unchanged, or if H was full and memory
+   allocation failed. */
+bool
+ohash_insert (struct ohash *h, uint32_t key, void *value) 
+{
+  ASSERT (value != NULL);
+
+  if (find_slot (h, key) != NULL)
+    return false;
+
+  /* Grow at 3/4 load.  If that fails we can keep going until
+     the table is completely full, at the cost of longer probe
+     sequences. */
+  if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3
+      && !resize (h, h->slot_cnt * 2)
+      && h->elem_cnt + 1 >= h->slot_cnt)
+    return false;
+
+  place (h, key, value);
+  h->elem_cnt++;
+  return true;
+}
+
+/* Removes KEY from H and returns the value stored with it, or a
+   null pointer if KEY is not in H. */
+void *
+ohash_delete (struct ohash *h, uint32_t key) 
+{
+  size_t mask = h->slot_cnt - 1;
+  struct ohash_slot *slot = find_slot (h, key);
+  void *value;
+  size_t i;
+
+  if (slot == NULL)
+    return NULL;
+  value = slot->value;
+
+  /* Shift each following entry that is not in its home slot
+     back by one, until reaching an empty slot or one whose entry
+     is already home. */
+  i = slot - h->slots;
+  for (;;) 
+    {
+      struct ohash_slot *next = &h->slots[(i + 1) & mask];
+      if (next->dist <= 1)
+        break;
+      h->slots[i] = *next;
+      h->slots[i].dist--;
+      i = (i + 1) & mask;
+    }
+  h->slots[i].dist = 0;
+  h->elem_cnt--;
+
+  return value;
+}
+
+/* Calls ACTION for each element in H in arbitrary order, passing
+   AUX along.  ACTION must not insert into or delete from H. */
+void
+ohash_apply (struct ohash *h, ohash_action_func *action, void *aux) 
+{
+  size_t i;
+
+  ASSERT (action != NULL);
+
+  for (i = 0; i < h->slot_cnt; i++)
+    if (h->slots[i].dist != 0)
+      action (h->slots[i].key, h->slots[i].value, aux);
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (const struct ohash *h) 
+{
+  return h->elem_cnt;
+}
+
+/* Returns the slot holding KEY in H, or a null pointer if KEY is
+   not in H. */
+static struct ohash_slot *
+find_slot (const struct ohash *h, uint32_t key) 
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t i = hash_int (key) & mask;
+  uint32_t dist;
+
+  /* Once we reach a slot whose entry is closer to home than we
+     would be, KEY cannot be further along: insertion would have
+     displaced that entry. */
+  for (dist = 1; h->slots[i].dist >= dist; dist++, i = (i + 1) & mask)
+    if (h->slots[i].key == key)
+      return &h->slots[i];
+  return NULL;
+}
+
+/* Puts KEY and VALUE into H, which must not already contain KEY
+   and must have an empty slot.  Does not update H's element
+   count. */
+static void
+place (struct ohash *h, uint32_t key, void *value) 
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t i = hash_int (key) & mask;
+  struct ohash_slot new;
+
+  new.key = key;
+  new.dist = 1;
+  new.value = value;
+  for (;;) 
+    {
+      struct ohash_slot *slot = &h->slots[i];
+      if (slot->dist == 0) 
+        {
+          *slot = new;
+          return;
+        }
+      else if (slot->dist < new.dist) 
+        {
+          /* Robin Hood: take from the rich (entries near home)
+             and give to the poor (the entry being placed). */
+          struct ohash_slot tmp = *slot;
+          *slot = new;
+          new = tmp;
+        }
+      new.dist++;
+      i = (i + 1) & mask;
+    }
+}
+
+/* Changes the number of slots in H to SLOT_CNT, a power of 2,
+   and moves every element into the new array.  Returns true if
+   successful, false if memory allocation fails, in which case H
+   is unchanged. */
+static bool
+resize (struct ohash *h, size_t slot_cnt) 
+{
+  struct ohash_slot *old_slots = h->slots;
+  size_t old_slot_cnt = h->slot_cnt;
+  size_t i;
+
+  ASSERT (slot_cnt > h->elem_cnt);
+  ASSERT ((slot_cnt & (slot_cnt - 1)) == 0);
+
+  h->slots = calloc (slot_cnt, sizeof *h->slots);
+  if (h->slots == NULL) 
+    {
+      h->slots = old_slots;
+      return false;
+    }
+  h->slot_cnt = slot_cnt;
+
+  for (i = 0; i < old_slot_cnt; i++)
+    if (old_slots[i].dist != 0)
+      place (h, old_slots[i].key, old_slots[i].value);
+  free (old_slots);
+
+  return true;
+}
@@ -0,0 +1,62 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table with integer keys.
+
+   This is an alternative to the chained hash table in hash.h for
+   hot lookups keyed by a 32-bit integer, such as a sector number
+   or a thread identifier.  Instead of chasing pointers through a
+   bucket list, a lookup scans a short run of adjacent slots in a
+   single array.  Each slot holds the key inline along with a
+   pointer to the caller's object, so a probe that misses never
+   touches the object itself.
+
+   Collisions are resolved by linear probing with Robin Hood
+   insertion: an entry being inserted displaces any entry that is
+   closer to its home slot than the newcomer is to its own.  This
+   keeps probe sequences short and lets an unsuccessful search
+   stop early.  Deletion shifts the following entries back, so no
+   tombstones are needed.
+
+   The table grows by doubling when it becomes 3/4 full.  It
+   never shrinks.  Values must not be null pointers.  The table
+   does no locking of its own. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A slot in the table. */
+struct ohash_slot
+  {
+    uint32_t key;               /* Key. */
+    uint32_t dist;              /* Probe distance plus 1, or 0 if empty. */
+    void *value;                /* Value. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+  };
+
+/* Performs some operation on the element with the given KEY and
+   VALUE, given auxiliary data AUX. */
+typedef void ohash_action_func (uint32_t key, void *value, void *aux);
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, size_t cnt);
+void ohash_destroy (struct ohash *);
+
+/* Search, insertion, deletion. */
+void *ohash_find (const struct ohash *, uint32_t key);
+bool ohash_insert (struct ohash *, uint32_t key, void *value);
+void *ohash_delete (struct ohash *, uint32_t key);
+
+/* Iteration and information. */
+void ohash_apply (struct ohash *, ohash_action_func *, void *aux);
+size_t ohash_size (const struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
@@ -0,0 +1,399 @@
+/* Red-black tree.
+
+   The algorithms follow [CLRS] chapter 13, "Red-Black Trees",
+   with null pointers standing in for the black leaf sentinel.
+   See rbtree.h for basic information. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void replace_child (struct rbtree *, struct rb_elem *old,
+                           struct rb_elem *new);
+static struct rb_elem *leftmost (struct rb_elem *);
+static struct rb_elem *rightmost (struct rb_elem *);
+
+/* Returns true if E is a red element, false if it is black or
+   a null leaf. */
+static inline bool
+is_red (const struct rb_elem *e) 
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rbtree *tree, rb_less_func *less, void *aux) 
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts ELEM into TREE, after any elements equal to it. */
+void
+rb_insert (struct rbtree *tree, struct rb_elem *elem) 
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &tree->root;
+
+  ASSERT (elem != NULL);
+
+  /* Ordinary binary search tree insertion. */
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (tree->less (elem, parent, tree->aux))
+        link = &parent->left;
+      else
+        link = &parent->right;
+    }
+  elem->parent = parent;
+  elem->left = elem->right = NULL;
+  elem->red = true;
+  *link = elem;
+  tree->elem_cnt++;
+
+  /* Restore the red-black properties.  Only "a red element has
+     no red child" can be violated, by ELEM and its parent. */
+  while (is_red (elem->parent)) 
+    {
+      struct rb_elem *p = elem->parent;
+      struct rb_elem *g = p->parent;    /* Exists: the root is black. */
+      struct rb_elem *uncle = p == g->left ? g->right : g->left;
+
+      if (is_red (uncle)) 
+        {
+          /* Push the grandparent's blackness down a level and
+             continue from the grandparent. */
+          p->red = uncle->red = false;
+          g->red = true;
+          elem = g;
+        }
+      else if (p == g->left) 
+        {
+          if (elem == p->right) 
+            {
+              rotate_left (tree, p);
+              p = elem;
+            }
+          rotate_right (tree, g);
+          p->red = false;
+          g->red = true;
+          break;
+        }
+      else 
+        {
+          if (elem == p->left) 
+            {
+              rotate_right (tree, p);
+              p = elem;
+            }
+          rotate_left (tree, g);
+          p->red = false;
+          g->red = true;
+          break;
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_delete (struct rbtree *tree, struct rb_elem *elem) 
+{
+  struct rb_elem *child, *parent;
+  bool removed_red;
+
+  ASSERT (elem != NULL);
+  ASSERT (tree->elem_cnt > 0);
+
+  /* Splice out ELEM if it has at most one child.  Otherwise,
+     splice out its successor, which has no left child, and put
+     the successor in ELEM's place.  Either way, CHILD moves up
+     into the spliced-out position, under PARENT. */
+  if (elem->left == NULL || elem->right == NULL) 
+    {
+      child = elem->left != NULL ? elem->left : elem->right;
+      parent = elem->parent;
+      removed_red = elem->red;
+      replace_child (tree, elem, child);
+      if (child != NULL)
+        child->parent = parent;
+    }
+  else 
+    {
+      struct rb_elem *succ = leftmost (elem->right);
+
+      child = succ->right;
+      removed_red = succ->red;
+      if (succ->parent == elem)
+        parent = succ;
+      else 
+        {
+          parent = succ->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          succ->right = elem->right;
+          succ->right->parent = succ;
+        }
+      replace_child (tree, elem, succ);
+      succ->parent = elem->parent;
+      succ->left = elem->left;
+      succ->left->parent = succ;
+      succ->red = elem->red;
+    }
+  tree->elem_cnt--;
+
+  if (removed_red)
+    return;
+
+  /* A black element was removed, so every path through CHILD is
+     one black element short.  Fix that by moving the extra
+     blackness up the tree until it can be absorbed. */
+  while (child != tree->root && !is_red (child)) 
+    {
+      if (child == parent->left) 
+        {
+          struct rb_elem *sib = parent->right;
+          if (is_red (sib)) 
+            {
+              sib->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sib = parent->right;
+            }
+          if (!is_red (sib->left) && !is_red (sib->right)) 
+            {
+              sib->red = true;
+              child = parent;
+              parent = child->parent;
+            }
+          else 
+            {
+              if (!is_red (sib->right)) 
+                {
+                  sib->left->red = false;
+                  sib->red = true;
+                  rotate_right (tree, sib);
+                  sib = parent->right;
+                }
+              sib->red = parent->red;
+              parent->red = false;
+              sib->right->red = false;
+              rotate_left (tree, parent);
+              child = tree->root;
+            }
+        }
+      else 
+        {
+          struct rb_elem *sib = parent->left;
+          if (is_red (sib)) 
+            {
+              sib->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sib = parent->left;
+            }
+          if (!is_red (sib->left) && !is_red (sib->right)) 
+            {
+              sib->red = true;
+              child = parent;
+              parent = child->parent;
+            }
+          else 
+            {
+              if (!is_red (sib->left)) 
+                {
+                  sib->right->red = false;
+                  sib->red = true;
+                  rotate_left (tree, sib);
+                  sib = parent->left;
+                }
+              sib->red = parent->red;
+              parent->red = false;
+              sib->left->red = false;
+              rotate_right (tree, parent);
+              child = tree->root;
+            }
+        }
+    }
+  if (child != NULL)
+    child->red = false;
+}
+
+/* Returns an element of TREE equal to KEY, or a null pointer if
+   there is none.  If several elements equal KEY, returns the
+   first of them. */
+struct rb_elem *
+rb_find (const struct rbtree *tree, const struct rb_elem *key) 
+{
+  struct rb_elem *e = rb_lower_bound (tree, key);
+  return e != NULL && !tree->less (key, e, tree->aux) ? e : NULL;
+}
+
+/* Returns the first element of TREE that is not less than KEY,
+   or a null pointer if every element is less than KEY. */
+struct rb_elem *
+rb_lower_bound (const struct rbtree *tree, const struct rb_elem *key) 
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (e, key, tree->aux))
+      e = e->right;
+    else 
+      {
+        bound = e;
+        e = e->left;
+      }
+  return bound;
+}
+
+/* Returns the first element of TREE that is greater than KEY, or
+   a null pointer if no element is greater than KEY. */
+struct rb_elem *
+rb_upper_bound (const struct rbtree *tree, const struct rb_elem *key) 
+{
+  struct rb_elem *e = tree->root;
+  struct rb_elem *bound = NULL;
+
+  while (e != NULL)
+    if (tree->less (key, e, tree->aux)) 
+      {
+        bound = e;
+        e = e->left;
+      }
+    else
+      e = e->right;
+  return bound;
+}
+
+/* Returns the least element of TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_min (const struct rbtree *tree) 
+{
+  return tree->root != NULL ? leftmost (tree->root) : NULL;
+}
+
+/* Returns the greatest element of TREE, or a null pointer if
+   TREE is empty. */
+struct rb_elem *
+rb_max (const struct rbtree *tree) 
+{
+  return tree->root != NULL ? rightmost (tree->root) : NULL;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest element. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    return leftmost (e->right);
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the element that precedes E in its tree, or a null
+   pointer if E is the least element. */
+struct rb_elem *
+rb_prev (const struct rb_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  if (e->left != NULL)
+    return rightmost (e->left);
+  while (e->parent != NULL && e == e->parent->left)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rbtree *tree) 
+{
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *tree) 
+{
+  return tree->root == NULL;
+}
+
+/* Rotates the subtree rooted at E to the left, making E's right
+   child the root of the subtree. */
+static void
+rotate_left (struct rbtree *tree, struct rb_elem *e) 
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  replace_child (tree, e, r);
+  r->parent = e->parent;
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, making E's left
+   child the root of the subtree. */
+static void
+rotate_right (struct rbtree *tree, struct rb_elem *e) 
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  replace_child (tree, e, l);
+  l->parent = e->parent;
+  l->right = e;
+  e->parent = l;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   TREE's root.  Does not update NEW's own parent pointer. */
+static void
+replace_child (struct rbtree *tree, struct rb_elem *old, struct rb_elem *new) 
+{
+  if (old->parent == NULL)
+    tree->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+}
+
+/* Returns the least element in the subtree rooted at E. */
+static struct rb_elem *
+leftmost (struct rb_elem *e) 
+{
+  while (e->left != NULL)
+    e = e->left;
+  return e;
+}
+
+/* Returns the greatest element in the subtree rooted at E. */
+static struct rb_elem *
+rightmost (struct rb_elem *e) 
+{
+  while (e->right != NULL)
+    e = e->right;
+  return e;
+}
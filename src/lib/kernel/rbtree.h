@@ -0,0 +1,114 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   An ordered container with O(lg n) insertion, deletion and
+   search, for uses that would otherwise keep a sorted list with
+   list_insert_ordered(): timer deadlines, free extents, blocks
+   queued for write-back, address ranges, and so on.
+
+   Like lists and hash tables, red-black trees do not allocate
+   memory.  Each structure that can be in a tree embeds a struct
+   rb_elem member, and the rb_entry macro converts a pointer to
+   that member back into a pointer to the structure:
+
+      struct timer
+        {
+          struct rb_elem elem;
+          int64_t deadline;
+        };
+
+      static bool
+      timer_less (const struct rb_elem *a, const struct rb_elem *b,
+                  void *aux UNUSED)
+      {
+        return (rb_entry (a, struct timer, elem)->deadline
+                < rb_entry (b, struct timer, elem)->deadline);
+      }
+
+      struct rbtree timers;
+      rb_init (&timers, timer_less, NULL);
+
+   The tree may hold elements that compare equal.  A new element
+   is placed after any equal elements already in the tree, so
+   elements with equal keys come out in insertion order.
+
+   Iteration runs from rb_min() (or rb_max()) with rb_next() (or
+   rb_prev()) until a null pointer is returned:
+
+      struct rb_elem *e;
+
+      for (e = rb_min (&timers); e != NULL; e = rb_next (e))
+        {
+          struct timer *t = rb_entry (e, struct timer, elem);
+          ...do something with t...
+        }
+
+   Searching takes a "key" element, typically a local variable
+   whose key members are filled in, and compares it against the
+   tree with the tree's less function. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem 
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child, or null. */
+    struct rb_elem *right;      /* Right child, or null. */
+    bool red;                   /* True if red, false if black. */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element.  See the big comment at the top of the file for
+   an example. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rbtree 
+  {
+    struct rb_elem *root;       /* Root element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Initialization. */
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+
+/* Insertion and deletion. */
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_delete (struct rbtree *, struct rb_elem *);
+
+/* Search. */
+struct rb_elem *rb_find (const struct rbtree *, const struct rb_elem *key);
+struct rb_elem *rb_lower_bound (const struct rbtree *,
+                                const struct rb_elem *key);
+struct rb_elem *rb_upper_bound (const struct rbtree *,
+                                const struct rb_elem *key);
+
+/* Traversal. */
+struct rb_elem *rb_min (const struct rbtree *);
+struct rb_elem *rb_max (const struct rbtree *);
+struct rb_elem *rb_next (const struct rb_elem *);
+struct rb_elem *rb_prev (const struct rb_elem *);
+
+/* Properties. */
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -3,6 +3,7 @@
 #include <random.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Converts a string representation of a signed decimal integer
    in S into an `int', which is returned. */
@@ -52,7 +53,7 @@ compare_thunk (const void *a, const void *b, void *aux)
    using COMPARE.  When COMPARE is passed a pair of elements A
    and B, respectively, it must return a strcmp()-type result,
    i.e. less than zero if A < B, zero if A == B, greater than
-   zero if A > B.  Runs in O(n lg n) time and O(1) space in
+   zero if A > B.  Runs in O(n lg n) time and O(lg n) space in
    CNT. */
 void
 qsort (void *array, size_t cnt, size_t size,
@@ -61,43 +62,68 @@ qsort (void *array, size_t cnt, size_t size,
   sort (array, cnt, size, compare_thunk, &compare);
 }
 
-/* Swaps elements with 1-based indexes A_IDX and B_IDX in ARRAY
-   with elements of SIZE bytes each. */
-static void
-do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
+/* Partitions this small or smaller are finished with insertion
+   sort. */
+#define INSERTION_SORT_MAX 16
+
+/* Parameters of a sort in progress. */
+struct sort_params 
+  {
+    size_t size;                /* Element size in bytes. */
+    int (*compare) (const void *, const void *, void *aux);
+    void *aux;                  /* Auxiliary data for COMPARE. */
+    bool word_swap;             /* Swap a word at a time? */
+  };
+
+/* Swaps the elements at A and B. */
+static inline void
+do_swap (unsigned char *a, unsigned char *b, const struct sort_params *p)
 {
-  unsigned char *a = array + (a_idx - 1) * size;
-  unsigned char *b = array + (b_idx - 1) * size;
-  size_t i;
+  if (p->word_swap) 
+    {
+      unsigned long *x = (unsigned long *) a;
+      unsigned long *y = (unsigned long *) b;
+      size_t n = p->size / sizeof (unsigned long);
 
-  for (i = 0; i < size; i++)
+      do 
+        {
+          unsigned long t = *x;
+          *x++ = *y;
+          *y++ = t;
+        }
+      while (--n > 0);
+    }
+  else 
     {
-      unsigned char t = a[i];
-      a[i] = b[i];
-      b[i] = t;
+      size_t n = p->size;
+
+      do 
+        {
+          unsigned char t = *a;
+          *a++ = *b;
+          *b++ = t;
+        }
+      while (--n > 0);
     }
 }
 
-/* Compares elements with 1-based indexes A_IDX and B_IDX in
-   ARRAY with elements of SIZE bytes each, using COMPARE to
-   compare elements, passing AUX as auxiliary data, and returns a
-   strcmp()-type result. */
-static int
-do_compare (unsigned char *array, size_t a_idx, size_t b_idx, size_t size,
-            int (*compare) (const void *, const void *, void *aux),
-            void *aux) 
+/* Compares the elements at A and B and returns a strcmp()-type
+   result. */
+static inline int
+do_compare (const unsigned char *a, const unsigned char *b,
+            const struct sort_params *p) 
 {
-  return compare (array + (a_idx - 1) * size, array + (b_idx - 1) * size, aux);
+  return p->compare (a, b, p->aux);
 }
 
-/* "Float down" the element with 1-based index I in ARRAY of CNT
-   elements of SIZE bytes each, using COMPARE to compare
-   elements, passing AUX as auxiliary data. */
+/* "Float down" the element with 1-based index I in the heap of
+   CNT elements that starts at ARRAY. */
 static void
-heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
-         int (*compare) (const void *, const void *, void *aux),
-         void *aux) 
+heapify (unsigned char *array, size_t i, size_t cnt,
+         const struct sort_params *p) 
 {
+  unsigned char *base = array - p->size;  /* For 1-based indexing. */
+
   for (;;) 
     {
       /* Set `max' to the index of the largest element among I
@@ -105,10 +131,11 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
       size_t left = 2 * i;
       size_t right = 2 * i + 1;
       size_t max = i;
-      if (left <= cnt && do_compare (array, left, max, size, compare, aux) > 0)
+      if (left <= cnt
+          && do_compare (base + left * p->size, base + max * p->size, p) > 0)
         max = left;
       if (right <= cnt
-          && do_compare (array, right, max, size, compare, aux) > 0) 
+          && do_compare (base + right * p->size, base + max * p->size, p) > 0)
         max = right;
 
       /* If the maximum value is already in element I, we're
@@ -117,38 +144,165 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
         break;
 
       /* Swap and continue down the heap. */
-      do_swap (array, i, max, size);
+      do_swap (base + i * p->size, base + max * p->size, p);
       i = max;
     }
 }
 
+/* Sorts the CNT elements at ARRAY with heapsort, which takes
+   O(n lg n) time in the worst case. */
+static void
+heap_sort (unsigned char *array, size_t cnt, const struct sort_params *p) 
+{
+  size_t i;
+
+  /* Build a heap. */
+  for (i = cnt / 2; i > 0; i--)
+    heapify (array, i, cnt, p);
+
+  /* Sort the heap. */
+  for (i = cnt; i > 1; i--) 
+    {
+      do_swap (array, array + (i - 1) * p->size, p);
+      heapify (array, 1, i - 1, p); 
+    }
+}
+
+/* Sorts the CNT elements at ARRAY with insertion sort, which is
+   fastest for small CNT. */
+static void
+insertion_sort (unsigned char *array, size_t cnt,
+                const struct sort_params *p) 
+{
+  unsigned char *end = array + cnt * p->size;
+  unsigned char *i, *j;
+
+  for (i = array + p->size; i < end; i += p->size)
+    for (j = i; j > array && do_compare (j - p->size, j, p) > 0;
+         j -= p->size)
+      do_swap (j - p->size, j, p);
+}
+
+/* Swaps the median of the elements at A, B, and C into
+   RESULT. */
+static void
+move_median_to_first (unsigned char *result, unsigned char *a,
+                      unsigned char *b, unsigned char *c,
+                      const struct sort_params *p) 
+{
+  if (do_compare (a, b, p) < 0) 
+    {
+      if (do_compare (b, c, p) < 0)
+        do_swap (result, b, p);
+      else if (do_compare (a, c, p) < 0)
+        do_swap (result, c, p);
+      else
+        do_swap (result, a, p);
+    }
+  else if (do_compare (a, c, p) < 0)
+    do_swap (result, a, p);
+  else if (do_compare (b, c, p) < 0)
+    do_swap (result, c, p);
+  else
+    do_swap (result, b, p);
+}
+
+/* Partitions the elements from FIRST up to but not including
+   LAST around the pivot at PIVOT, which is not among them, and
+   returns the start of the upper part.  The range must contain
+   an element not less than the pivot and one not greater than
+   it, which stop the scans without bounds checks. */
+static unsigned char *
+partition (unsigned char *first, unsigned char *last,
+           const unsigned char *pivot, const struct sort_params *p) 
+{
+  for (;;) 
+    {
+      while (do_compare (first, pivot, p) < 0)
+        first += p->size;
+      last -= p->size;
+      while (do_compare (pivot, last, p) < 0)
+        last -= p->size;
+      if (first >= last)
+        return first;
+      do_swap (first, last, p);
+      first += p->size;
+    }
+}
+
+/* Sorts the CNT elements at ARRAY with introsort: quicksort
+   with median-of-three pivots, switching to heapsort once
+   DEPTH_LIMIT levels of partitioning have failed to finish the
+   job, and leaving small partitions to insertion sort. */
+static void
+intro_sort (unsigned char *array, size_t cnt, int depth_limit,
+            const struct sort_params *p) 
+{
+  while (cnt > INSERTION_SORT_MAX) 
+    {
+      unsigned char *last = array + cnt * p->size;
+      unsigned char *cut;
+      size_t lower_cnt;
+
+      if (depth_limit-- == 0) 
+        {
+          heap_sort (array, cnt, p);
+          return;
+        }
+
+      move_median_to_first (array, array + p->size,
+                            array + cnt / 2 * p->size, last - p->size, p);
+      cut = partition (array + p->size, last, array, p);
+
+      /* Recurse into the smaller part and loop on the larger,
+         so that the stack depth is O(lg n). */
+      lower_cnt = (cut - array) / p->size;
+      if (lower_cnt < cnt - lower_cnt) 
+        {
+          intro_sort (array, lower_cnt, depth_limit, p);
+          array = cut;
+          cnt -= lower_cnt;
+        }
+      else 
+        {
+          intro_sort (cut, cnt - lower_cnt, depth_limit, p);
+          cnt = lower_cnt;
+        }
+    }
+  insertion_sort (array, cnt, p);
+}
+
 /* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
    using COMPARE to compare elements, passing AUX as auxiliary
    data.  When COMPARE is passed a pair of elements A and B,
    respectively, it must return a strcmp()-type result, i.e. less
    than zero if A < B, zero if A == B, greater than zero if A >
-   B.  Runs in O(n lg n) time and O(1) space in CNT. */
+   B.  Runs in O(n lg n) time and O(lg n) space in CNT. */
 void
 sort (void *array, size_t cnt, size_t size,
       int (*compare) (const void *, const void *, void *aux),
       void *aux) 
 {
+  struct sort_params p;
+  int depth_limit;
   size_t i;
 
   ASSERT (array != NULL || cnt == 0);
   ASSERT (compare != NULL);
   ASSERT (size > 0);
 
-  /* Build a heap. */
-  for (i = cnt / 2; i > 0; i--)
-    heapify (array, i, cnt, size, compare, aux);
+  p.size = size;
+  p.compare = compare;
+  p.aux = aux;
+  p.word_swap = (size % sizeof (unsigned long) == 0
+                 && (uintptr_t) array % sizeof (unsigned long) == 0);
 
-  /* Sort the heap. */
-  for (i = cnt; i > 1; i--) 
-    {
-      do_swap (array, 1, i, size);
-      heapify (array, 1, i - 1, size, compare, aux); 
-    }
+  /* Allow 2 * floor(lg CNT) levels of partitioning. */
+  depth_limit = 0;
+  for (i = cnt; i > 1; i /= 2)
+    depth_limit += 2;
+
+  intro_sort (array, cnt, depth_limit, &p);
 }
 
 /* Searches ARRAY, which contains CNT elements of SIZE bytes
@@ -1,5 +1,72 @@
 #include <string.h>
 #include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Blocks smaller than this are copied or set a byte at a time,
+   because aligning for word-sized transfers doesn't pay off. */
+#define WORD_XFER_MIN 16
+
+/* Blocks smaller than this are never handled with non-temporal
+   stores. */
+#define NT_XFER_MIN 256
+
+/* Copies SIZE bytes from SRC to DST in ascending address order,
+   using "rep movsl" for the bulk of the block.  DST is
+   word-aligned first, since misaligned stores cost more than
+   misaligned loads.  Safe for overlapping blocks only if DST is
+   below SRC. */
+static inline void
+copy_forward (void *dst, const void *src, size_t size) 
+{
+  if (size >= WORD_XFER_MIN) 
+    {
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words = (size - head) / 4;
+
+      size = (size - head) & 3;
+      asm volatile ("rep movsb; movl %3, %%ecx; rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (head)
+                    : "g" (words)
+                    : "memory");
+    }
+
+  /* See [IA32-v2b] "REP" and "MOVS". */
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (size)
+                : : "memory");
+}
+
+/* Copies SIZE bytes from SRC to DST in descending address order,
+   as copy_forward() does in ascending order.  Safe for
+   overlapping blocks only if DST is above SRC. */
+static inline void
+copy_backward (void *dst_, const void *src_, size_t size) 
+{
+  /* Point to the last byte of each block. */
+  uint8_t *dst = (uint8_t *) dst_ + size - 1;
+  const uint8_t *src = (const uint8_t *) src_ + size - 1;
+
+  /* The direction flag must be clear again by the end of each
+     asm statement, since the compiler assumes it is. */
+  if (size >= WORD_XFER_MIN) 
+    {
+      size_t tail = (uintptr_t) (dst + 1) & 3;
+      size_t words = (size - tail) / 4;
+
+      size = (size - tail) & 3;
+      asm volatile ("std; rep movsb; "
+                    "subl $3, %%edi; subl $3, %%esi; "
+                    "movl %3, %%ecx; rep movsl; "
+                    "addl $3, %%edi; addl $3, %%esi; cld"
+                    : "+D" (dst), "+S" (src), "+c" (tail)
+                    : "g" (words)
+                    : "memory");
+    }
+  asm volatile ("std; rep movsb; cld"
+                : "+D" (dst), "+S" (src), "+c" (size)
+                : : "memory");
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +79,7 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  copy_forward (dst, src, size);
 
   return dst_;
 }
@@ -29,20 +95,12 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
+  if (dst <= src || dst >= src + size) 
+    copy_forward (dst, src, size);
   else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
-    }
+    copy_backward (dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -274,17 +332,118 @@ strtok_r (char *s, const char *delimiters, char **save_ptr)
   return token;
 }
 
-/* Sets the SIZE bytes in DST to VALUE. */
+/* Sets the SIZE bytes in DST to VALUE, using "rep stosl" for
+   the word-aligned bulk of the block. */
 void *
 memset (void *dst_, int value, size_t size) 
 {
-  unsigned char *dst = dst_;
+  void *dst = dst_;
+  uint32_t word = (uint8_t) value * 0x01010101u;
 
   ASSERT (dst != NULL || size == 0);
-  
-  while (size-- > 0)
-    *dst++ = value;
 
+  if (size >= WORD_XFER_MIN) 
+    {
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words = (size - head) / 4;
+
+      size = (size - head) & 3;
+      asm volatile ("rep stosb; movl %3, %%ecx; rep stosl"
+                    : "+D" (dst), "+c" (head)
+                    : "a" (word), "g" (words)
+                    : "memory");
+    }
+
+  /* See [IA32-v2b] "REP" and "STOS". */
+  asm volatile ("rep stosb"
+                : "+D" (dst), "+c" (size)
+                : "a" (word)
+                : "memory");
+
+  return dst_;
+}
+
+/* Returns true if the CPU supports SSE2, and with it the MOVNTI
+   non-temporal store instruction. */
+static bool
+have_movnti (void) 
+{
+  static int sse2 = -1;
+
+  if (sse2 < 0) 
+    {
+      /* See [IA32-v2a] "CPUID": leaf 1 reports SSE2 in EDX bit
+         26. */
+      uint32_t eax = 1, ebx, ecx, edx;
+      asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+      sse2 = (edx >> 26) & 1;
+    }
+  return sse2;
+}
+
+/* Like memcpy(), but stores to DST bypass the processor caches.
+   Use this for large blocks, such as whole pages, that will not
+   be read again soon, so that the copy does not evict more
+   useful data.  Falls back to memcpy() for small blocks or if
+   the CPU lacks SSE2.  Returns DST. */
+void *
+memcpy_nt (void *dst_, const void *src_, size_t size) 
+{
+  uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+  size_t head;
+
+  ASSERT (dst != NULL || size == 0);
+  ASSERT (src != NULL || size == 0);
+
+  if (size < NT_XFER_MIN || !have_movnti ())
+    return memcpy (dst_, src_, size);
+
+  head = -(uintptr_t) dst & 3;
+  copy_forward (dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+
+  /* See [IA32-v2a] "MOVNTI" and [IA32-v2b] "SFENCE". */
+  for (; size >= 16; dst += 16, src += 16, size -= 16) 
+    asm volatile ("movl (%1), %%eax; movnti %%eax, (%0); "
+                  "movl 4(%1), %%eax; movnti %%eax, 4(%0); "
+                  "movl 8(%1), %%eax; movnti %%eax, 8(%0); "
+                  "movl 12(%1), %%eax; movnti %%eax, 12(%0)"
+                  : : "r" (dst), "r" (src) : "eax", "memory");
+  asm volatile ("sfence" : : : "memory");
+
+  copy_forward (dst, src, size);
+  return dst_;
+}
+
+/* Like memset(), but stores to DST bypass the processor caches,
+   as in memcpy_nt().  Returns DST. */
+void *
+memset_nt (void *dst_, int value, size_t size) 
+{
+  uint8_t *dst = dst_;
+  uint32_t word = (uint8_t) value * 0x01010101u;
+  size_t head;
+
+  ASSERT (dst != NULL || size == 0);
+
+  if (size < NT_XFER_MIN || !have_movnti ())
+    return memset (dst_, value, size);
+
+  head = -(uintptr_t) dst & 3;
+  memset (dst, value, head);
+  dst += head;
+  size -= head;
+
+  for (; size >= 16; dst += 16, size -= 16) 
+    asm volatile ("movnti %1, (%0); movnti %1, 4(%0); "
+                  "movnti %1, 8(%0); movnti %1, 12(%0)"
+                  : : "r" (dst), "r" (word) : "memory");
+  asm volatile ("sfence" : : : "memory");
+
+  memset (dst, value, size);
   return dst_;
 }
 
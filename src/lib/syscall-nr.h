@@ -28,7 +28,28 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_FSSTATS,                /* Obtain file system statistics. */
+    SYS_DEFRAG,                 /* Defragment files. */
+    SYS_FCNTL,                  /* Get or set file descriptor flags. */
+    SYS_TRUNCATE,               /* Set the size of a file by name. */
+    SYS_FTRUNCATE,              /* Set the size of an open file. */
+    SYS_FALLOCATE,              /* Reserve disk space for a file. */
+    SYS_REFLINK,                /* Copy a file, sharing its blocks. */
+    SYS_DEDUP,                  /* Share identical sectors. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_DUP2,                   /* Duplicate a pipe descriptor. */
+    SYS_SHM_MAP,                /* Map a shared memory segment. */
+    SYS_SHM_UNMAP,              /* Unmap a shared memory segment. */
+    SYS_FUTEX_WAIT,             /* Sleep if an int has a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on an int. */
+    SYS_UTHREAD_CREATE,         /* Start a thread in this process. */
+    SYS_UTHREAD_JOIN,           /* Wait for a thread to exit. */
+    SYS_UTHREAD_EXIT,           /* Exit the current thread. */
+    SYS_POLL                    /* Wait for descriptors to be ready. */
   };
 
 #endif /* lib/syscall-nr.h */
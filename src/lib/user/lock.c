@@ -0,0 +1,63 @@
+#include <lock.h>
+#include <syscall.h>
+
+/* A mutual exclusion lock for the threads of a process, built on
+   futex_wait() and futex_wake().
+
+   The lock word is 0 if the lock is free, 1 if it is held and no
+   thread is waiting for it, and 2 if it is held and threads may
+   be waiting.  Acquiring a free lock and releasing a lock nobody
+   waits for take one atomic instruction each and never enter
+   the kernel, so a process with a single thread pays almost
+   nothing for locking.
+
+   A lock whose word is 0 is free, so a lock in static or
+   zero-filled memory needs no initialization.  Locks are not
+   recursive. */
+
+/* Atomically sets *P to NEW if it equals OLD, and returns the
+   old value of *P. */
+static inline int
+cmpxchg (int *p, int old, int new) 
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p) : "r" (new), "0" (old) : "memory");
+  return prev;
+}
+
+/* Atomically sets *P to V and returns its old value. */
+static inline int
+xchg (int *p, int v) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+  return v;
+}
+
+/* Acquires LOCK, sleeping until it is available if necessary. */
+void
+lock_acquire (struct lock *lock) 
+{
+  int c = cmpxchg (&lock->word, 0, 1);
+  if (c != 0) 
+    {
+      /* Announce that we are waiting, then sleep until the lock
+         is released with the word still 2. */
+      if (c != 2)
+        c = xchg (&lock->word, 2);
+      while (c != 0) 
+        {
+          futex_wait (&lock->word, 2);
+          c = xchg (&lock->word, 2);
+        }
+    }
+}
+
+/* Releases LOCK, which the current thread must hold, and wakes
+   one thread waiting for it, if any. */
+void
+lock_release (struct lock *lock) 
+{
+  if (xchg (&lock->word, 0) == 2)
+    futex_wake (&lock->word, 1);
+}
@@ -0,0 +1,15 @@
+#ifndef __LIB_USER_LOCK_H
+#define __LIB_USER_LOCK_H
+
+/* Lock for the threads of a user process.  See lock.c for
+   details. */
+struct lock
+  {
+    int word;                   /* 0 if free, 1 if held, 2 if held
+                                   and there may be waiters. */
+  };
+
+void lock_acquire (struct lock *);
+void lock_release (struct lock *);
+
+#endif /* lib/user/lock.h */
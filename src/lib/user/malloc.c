@@ -0,0 +1,542 @@
+#include <malloc.h>
+#include <debug.h>
+#include <lock.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A size-class allocator for user programs, built on sbrk().
+
+   The heap is carved into page-aligned "runs" of one or more
+   pages, each beginning with a struct run header.  Every block
+   handed out by malloc() lies in the first page of its run, so
+   free() finds the header by rounding the block's address down
+   to a page boundary.
+
+   Requests of up to MAX_SMALL bytes are rounded up to one of a
+   fixed set of size classes.  Each class carves single-page runs
+   into equal blocks; the class sizes are chosen so that little
+   of each page goes to waste.  Larger requests get a run of
+   their own, sized in whole pages.
+
+   Free small blocks are kept at two levels, in the style of a
+   thread-caching allocator:
+
+     - A cache per size class holds a LIFO list of free blocks.
+       malloc() and free() normally just pop from or push onto
+       this list, which takes a handful of instructions.
+
+     - Each run keeps a list of its own free blocks that are not
+       in the cache.  The cache refills from these in batches
+       when it runs dry and spills a batch back to them when it
+       grows too long.  A run whose blocks have all come back is
+       returned to the page heap.
+
+   The page heap keeps free runs in address order and merges
+   neighbors, and gives memory at the top of the heap back to the
+   kernel with sbrk() once enough of it is free.  Because the
+   kernel maps heap pages only when they are first touched, large
+   blocks cost physical memory only for the pages actually used.
+
+   All of this state is shared by the threads of a process and
+   protected by a single lock, taken by malloc() and free().
+   calloc() and realloc() work through those two.  There is one
+   cache for the whole process; it is the piece that would become
+   per thread if contention on the lock came to matter. */
+
+/* Size of a page. */
+#define PAGE_SIZE 4096
+
+/* Run header size, a multiple of the block alignment. */
+#define RUN_HDR_SIZE 32
+
+/* Block alignment and size-class granularity. */
+#define ALIGN 16
+
+/* Largest small request. */
+#define MAX_SMALL 2032
+
+/* Number of size classes. */
+#define CLASS_CNT (sizeof class_size / sizeof *class_size)
+
+/* Class of large runs. */
+#define LARGE_CLASS 0xff
+
+/* Free pages at the top of the heap beyond this many are
+   returned to the kernel. */
+#define TRIM_PAGES 16
+
+/* Bytes moved between a class's cache and its runs at a time. */
+#define BATCH_BYTES 4096
+
+/* Detects corruption and bad pointers passed to free(). */
+#define RUN_MAGIC 0x9a548eed
+
+/* Block sizes of the size classes.  Up to 256 bytes the classes
+   are spaced closely.  Beyond that, each is the largest multiple
+   of ALIGN that fits a given number of blocks into a page. */
+static const uint16_t class_size[] = 
+  {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+    288, 336, 400, 448, 496, 576, 672, 800, 1008, 1344, 2032,
+  };
+
+/* A run of contiguous pages. */
+struct run 
+  {
+    unsigned magic;             /* RUN_MAGIC. */
+    unsigned class;             /* Size class, or LARGE_CLASS. */
+    size_t page_cnt;            /* Number of pages in the run. */
+    struct run *prev, *next;    /* Free run list or class's partial list. */
+    struct block *free;         /* Small runs: free blocks not in cache. */
+    size_t used;                /* Small runs: blocks not on `free'. */
+  };
+
+/* A free small block. */
+struct block 
+  {
+    struct block *next;         /* Next free block. */
+  };
+
+/* Cache of free blocks for one size class. */
+struct cache 
+  {
+    struct block *head;         /* Free blocks, most recently freed first. */
+    size_t cnt;                 /* Number of blocks in list. */
+  };
+
+static struct cache caches[CLASS_CNT];
+
+/* Per size class, small runs that have free blocks not in the
+   cache. */
+static struct run *partial_runs[CLASS_CNT];
+
+/* Free runs, in increasing order of address. */
+static struct run *free_runs;
+
+/* Maps (size + ALIGN - 1) / ALIGN to a size class. */
+static uint8_t size_to_class[MAX_SMALL / ALIGN + 1];
+static bool inited;
+
+/* Protects all of the above. */
+static struct lock heap_lock;
+
+static void *allocate (size_t size);
+static void release (void *);
+static void init (void);
+static void refill (unsigned class);
+static void flush (unsigned class, size_t cnt);
+static struct run *get_run (size_t page_cnt);
+static void put_run (struct run *);
+static void list_unlink (struct run **list, struct run *);
+static void list_push (struct run **list, struct run *);
+static size_t batch_size (unsigned class);
+
+/* Returns the run containing block B. */
+static inline struct run *
+block_to_run (void *b) 
+{
+  struct run *r = (struct run *) ((uintptr_t) b & ~(PAGE_SIZE - 1));
+  ASSERT (r->magic == RUN_MAGIC);
+  return r;
+}
+
+/* Returns the first block in run R. */
+static inline void *
+run_blocks (struct run *r) 
+{
+  return (uint8_t *) r + RUN_HDR_SIZE;
+}
+
+/* Returns the number of bytes usable in the block at B. */
+static size_t
+block_size (void *b) 
+{
+  struct run *r = block_to_run (b);
+  if (r->class == LARGE_CLASS)
+    return r->page_cnt * PAGE_SIZE - RUN_HDR_SIZE;
+  else
+    return class_size[r->class];
+}
+
+/* Obtains and returns a new block at least SIZE bytes long.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) 
+{
+  void *p;
+
+  lock_acquire (&heap_lock);
+  p = allocate (size);
+  lock_release (&heap_lock);
+  return p;
+}
+
+/* Does the work of malloc() with the heap lock held. */
+static void *
+allocate (size_t size) 
+{
+  if (size == 0)
+    return NULL;
+  if (!inited)
+    init ();
+
+  if (size <= MAX_SMALL) 
+    {
+      unsigned class = size_to_class[DIV_ROUND_UP (size, ALIGN)];
+      struct cache *c = &caches[class];
+      struct block *b;
+
+      if (c->head == NULL) 
+        {
+          refill (class);
+          if (c->head == NULL)
+            return NULL;
+        }
+      b = c->head;
+      c->head = b->next;
+      c->cnt--;
+      return b;
+    }
+  else 
+    {
+      size_t page_cnt = DIV_ROUND_UP (size + RUN_HDR_SIZE, PAGE_SIZE);
+      struct run *r;
+
+      if (size > SIZE_MAX - RUN_HDR_SIZE - PAGE_SIZE)
+        return NULL;
+      r = get_run (page_cnt);
+      if (r == NULL)
+        return NULL;
+      r->class = LARGE_CLASS;
+      return run_blocks (r);
+    }
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) 
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (size < a || size < b)
+    return NULL;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) 
+{
+  if (new_size == 0) 
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block == NULL)
+    return malloc (new_size);
+  else 
+    {
+      size_t old_size = block_size (old_block);
+      void *new_block;
+
+      /* Keep the block if it is big enough and not much too
+         big. */
+      if (new_size <= old_size && new_size > old_size / 2)
+        return old_block;
+
+      new_block = malloc (new_size);
+      if (new_block != NULL) 
+        {
+          memcpy (new_block, old_block,
+                  old_size < new_size ? old_size : new_size);
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) 
+{
+  if (p == NULL)
+    return;
+
+  lock_acquire (&heap_lock);
+  release (p);
+  lock_release (&heap_lock);
+}
+
+/* Does the work of free() on non-null P with the heap lock
+   held. */
+static void
+release (void *p) 
+{
+  struct run *r;
+
+  r = block_to_run (p);
+  if (r->class != LARGE_CLASS) 
+    {
+      struct cache *c = &caches[r->class];
+      struct block *b = p;
+
+      b->next = c->head;
+      c->head = b;
+      if (++c->cnt > 2 * batch_size (r->class))
+        flush (r->class, batch_size (r->class));
+    }
+  else
+    put_run (r);
+}
+
+/* Initializes the size class lookup table. */
+static void
+init (void) 
+{
+  unsigned class = 0;
+  size_t i;
+
+  for (i = 0; i <= MAX_SMALL / ALIGN; i++) 
+    {
+      while (class_size[class] < i * ALIGN)
+        class++;
+      size_to_class[i] = class;
+    }
+  inited = true;
+}
+
+/* Returns the number of blocks moved between CLASS's cache and
+   its runs at a time. */
+static size_t
+batch_size (unsigned class) 
+{
+  size_t cnt = BATCH_BYTES / class_size[class];
+  return cnt < 2 ? 2 : cnt > 32 ? 32 : cnt;
+}
+
+/* Moves a batch of free blocks from CLASS's runs into its
+   cache, carving up a new run if necessary. */
+static void
+refill (unsigned class) 
+{
+  struct cache *c = &caches[class];
+  size_t cnt = batch_size (class);
+
+  while (cnt-- > 0) 
+    {
+      struct run *r = partial_runs[class];
+      struct block *b;
+
+      if (r == NULL) 
+        {
+          size_t size = class_size[class];
+          size_t blk_cnt = (PAGE_SIZE - RUN_HDR_SIZE) / size;
+          size_t i;
+
+          r = get_run (1);
+          if (r == NULL)
+            return;
+          r->class = class;
+          r->used = 0;
+          r->free = NULL;
+          for (i = blk_cnt; i-- > 0; ) 
+            {
+              b = (struct block *) ((uint8_t *) run_blocks (r) + i * size);
+              b->next = r->free;
+              r->free = b;
+            }
+          list_push (&partial_runs[class], r);
+        }
+
+      b = r->free;
+      r->free = b->next;
+      r->used++;
+      if (r->free == NULL)
+        list_unlink (&partial_runs[class], r);
+
+      b->next = c->head;
+      c->head = b;
+      c->cnt++;
+    }
+}
+
+/* Moves CNT free blocks from CLASS's cache back to their runs,
+   releasing runs that become entirely free. */
+static void
+flush (unsigned class, size_t cnt) 
+{
+  struct cache *c = &caches[class];
+
+  while (cnt-- > 0 && c->head != NULL) 
+    {
+      struct block *b = c->head;
+      struct run *r = block_to_run (b);
+
+      c->head = b->next;
+      c->cnt--;
+
+      if (r->free == NULL)
+        list_push (&partial_runs[class], r);
+      b->next = r->free;
+      r->free = b;
+      if (--r->used == 0) 
+        {
+          list_unlink (&partial_runs[class], r);
+          put_run (r);
+        }
+    }
+}
+
+/* Returns a run of PAGE_CNT pages, taken from the free runs if
+   possible and otherwise from the kernel with sbrk().  Returns a
+   null pointer if memory is not available. */
+static struct run *
+get_run (size_t page_cnt) 
+{
+  struct run *r, *last = NULL;
+  uint8_t *brk;
+  size_t pad;
+
+  /* First fit. */
+  for (r = free_runs; r != NULL; last = r, r = r->next)
+    if (r->page_cnt >= page_cnt) 
+      {
+        if (r->page_cnt > page_cnt) 
+          {
+            /* Split, keeping the tail free. */
+            struct run *tail = (struct run *) ((uint8_t *) r
+                                               + page_cnt * PAGE_SIZE);
+            tail->magic = RUN_MAGIC;
+            tail->page_cnt = r->page_cnt - page_cnt;
+            tail->prev = r->prev;
+            tail->next = r->next;
+            if (tail->prev != NULL)
+              tail->prev->next = tail;
+            else
+              free_runs = tail;
+            if (tail->next != NULL)
+              tail->next->prev = tail;
+            r->page_cnt = page_cnt;
+          }
+        else
+          list_unlink (&free_runs, r);
+        return r;
+      }
+
+  /* Grow the heap, extending the last free run if it ends at the
+     current break. */
+  if (page_cnt > (SIZE_MAX - PAGE_SIZE) / PAGE_SIZE)
+    return NULL;
+  brk = sbrk (0);
+  pad = -(uintptr_t) brk & (PAGE_SIZE - 1);
+  if (last != NULL && pad == 0
+      && (uint8_t *) last + last->page_cnt * PAGE_SIZE == brk) 
+    {
+      if (sbrk ((page_cnt - last->page_cnt) * PAGE_SIZE) == SBRK_FAILED)
+        return NULL;
+      list_unlink (&free_runs, last);
+      r = last;
+    }
+  else 
+    {
+      if (sbrk (pad + page_cnt * PAGE_SIZE) == SBRK_FAILED)
+        return NULL;
+      r = (struct run *) (brk + pad);
+      r->magic = RUN_MAGIC;
+    }
+  r->page_cnt = page_cnt;
+  return r;
+}
+
+/* Returns run R to the free runs, merging it with its neighbors,
+   and trims the top of the heap if enough of it is free. */
+static void
+put_run (struct run *r) 
+{
+  struct run *prev = NULL, *next = free_runs;
+
+  while (next != NULL && next < r) 
+    {
+      prev = next;
+      next = next->next;
+    }
+
+  r->prev = prev;
+  r->next = next;
+  if (prev != NULL)
+    prev->next = r;
+  else
+    free_runs = r;
+  if (next != NULL)
+    next->prev = r;
+
+  /* Merge with following run. */
+  if (next != NULL && (uint8_t *) r + r->page_cnt * PAGE_SIZE
+                      == (uint8_t *) next) 
+    {
+      r->page_cnt += next->page_cnt;
+      list_unlink (&free_runs, next);
+      next->magic = 0;
+    }
+
+  /* Merge with preceding run. */
+  if (prev != NULL && (uint8_t *) prev + prev->page_cnt * PAGE_SIZE
+                      == (uint8_t *) r) 
+    {
+      prev->page_cnt += r->page_cnt;
+      list_unlink (&free_runs, r);
+      r->magic = 0;
+      r = prev;
+    }
+
+  /* Give the top of the heap back to the kernel. */
+  if (r->next == NULL && r->page_cnt > TRIM_PAGES
+      && (uint8_t *) r + r->page_cnt * PAGE_SIZE == sbrk (0)) 
+    {
+      size_t trim = r->page_cnt - TRIM_PAGES;
+      if (sbrk (-(intptr_t) (trim * PAGE_SIZE)) != SBRK_FAILED)
+        r->page_cnt = TRIM_PAGES;
+    }
+}
+
+/* Removes R from doubly linked LIST. */
+static void
+list_unlink (struct run **list, struct run *r) 
+{
+  if (r->prev != NULL)
+    r->prev->next = r->next;
+  else
+    *list = r->next;
+  if (r->next != NULL)
+    r->next->prev = r->prev;
+}
+
+/* Adds R to the front of doubly linked LIST. */
+static void
+list_push (struct run **list, struct run *r) 
+{
+  r->prev = NULL;
+  r->next = *list;
+  if (*list != NULL)
+    (*list)->prev = r;
+  *list = r;
+}
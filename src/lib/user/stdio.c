@@ -0,0 +1,817 @@
+#include <stdio.h>
+#include <lock.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams over file descriptors.
+
+   Each stream has a buffer that holds either data read ahead
+   from its file descriptor or data waiting to be written to it,
+   never both at once.  Switching a stream between reading and
+   writing flushes pending output or discards read-ahead data.
+
+   A stream is fully buffered, line buffered, or unbuffered, as
+   set by setvbuf():
+
+     - A fully buffered stream makes a system call only when its
+       buffer fills or empties, or when it is flushed.
+
+     - A line buffered stream also flushes at the end of any
+       output call that wrote a new-line character.  A printf()
+       that writes several lines thus still takes one system
+       call.
+
+     - An unbuffered stream flushes at the end of every output
+       call, and reads only one byte at a time.
+
+   Buffers are allocated with malloc() on first use, BUFSIZ bytes
+   by default, so setvbuf() may change the size or supply a
+   buffer at any point before a stream's first I/O.
+
+   stdout is line buffered.  stdin is unbuffered, because a read
+   from the console does not return until it has read every byte
+   asked for.  Reading from stdin flushes stdout first, so that
+   prompts appear.  All streams are flushed by exit().
+
+   Each stream has a lock, held for the whole of each call that
+   uses the stream, so that the threads of a process may share
+   streams and output from one call is never split by another's.
+   A separate lock protects the list of open streams.  When both
+   are needed, the list lock is taken first. */
+
+/* Stream flags. */
+#define F_READ 0x01             /* Opened for reading. */
+#define F_WRITE 0x02            /* Opened for writing. */
+#define F_APPEND 0x04           /* All writes go to end of file. */
+#define F_READING 0x08          /* Buffer holds read-ahead data. */
+#define F_WRITING 0x10          /* Buffer holds pending output. */
+#define F_EOF 0x20              /* End of file reached. */
+#define F_ERR 0x40              /* Error occurred. */
+#define F_OWNBUF 0x80           /* Buffer was allocated by us. */
+
+/* Size of the built-in buffer used by unbuffered streams, so
+   that one printf() still makes few system calls. */
+#define SMALL_BUF_SIZE 64
+
+struct FILE
+  {
+    int fd;                     /* File descriptor. */
+    unsigned flags;             /* F_* flags. */
+    int buf_mode;               /* _IOFBF, _IOLBF, or _IONBF. */
+    char *buf;                  /* Buffer, or null if not yet set up. */
+    size_t buf_size;            /* Buffer size, once set up. */
+    char *pos;                  /* Next byte to read or write in buffer. */
+    char *end;                  /* End of read-ahead data in buffer. */
+    struct FILE *next;          /* Next in list of open streams,
+                                   protected by `streams_lock'. */
+    struct lock lock;           /* Protects the other members. */
+    char small_buf[SMALL_BUF_SIZE]; /* Buffer for unbuffered streams. */
+  };
+
+static FILE stdin_file =
+  {
+    .fd = STDIN_FILENO,
+    .flags = F_READ,
+    .buf_mode = _IONBF,
+  };
+
+static FILE stdout_file =
+  {
+    .fd = STDOUT_FILENO,
+    .flags = F_WRITE,
+    .buf_mode = _IOLBF,
+    .next = &stdin_file,
+  };
+
+FILE *stdin = &stdin_file;
+FILE *stdout = &stdout_file;
+
+/* List of open streams, for fflush (NULL). */
+static FILE *streams = &stdout_file;
+static struct lock streams_lock;
+
+static unsigned parse_mode (const char *mode);
+static int flush_stream (FILE *);
+static long tell_stream (FILE *);
+static size_t fread_unlocked (void *, size_t, size_t, FILE *);
+static size_t fwrite_unlocked (const void *, size_t, size_t, FILE *);
+static char *fgets_unlocked (char *, int, FILE *);
+static int vfprintf_unlocked (FILE *, const char *, va_list);
+static bool check_size (FILE *, size_t size, size_t cnt);
+static bool setup_buffer (FILE *);
+static bool start_read (FILE *);
+static bool start_write (FILE *);
+static bool refill (FILE *);
+static int flush_output (FILE *);
+static void drop_input (FILE *);
+static bool write_all (FILE *, const char *, size_t);
+
+/* Opens the file named NAME and returns a new stream for it, or
+   a null pointer on failure.  MODE is one of "r", "w", or "a",
+   optionally followed by "+", with the usual meanings. */
+FILE *
+fopen (const char *name, const char *mode)
+{
+  unsigned flags = parse_mode (mode);
+  FILE *f;
+  int fd;
+
+  if (flags == 0)
+    return NULL;
+  if (mode[0] != 'r')
+    create (name, 0);
+  fd = open (name);
+  if (fd < 0)
+    return NULL;
+  if (mode[0] == 'w' && !ftruncate (fd, 0))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  f = fdopen (fd, mode);
+  if (f == NULL)
+    close (fd);
+  return f;
+}
+
+/* Returns a new fully buffered stream for file descriptor FD,
+   or a null pointer on failure.  MODE is interpreted as for
+   fopen(). */
+FILE *
+fdopen (int fd, const char *mode)
+{
+  unsigned flags = parse_mode (mode);
+  FILE *f;
+
+  if (flags == 0)
+    return NULL;
+  f = calloc (1, sizeof *f);
+  if (f == NULL)
+    return NULL;
+  f->fd = fd;
+  f->flags = flags;
+  f->buf_mode = _IOFBF;
+  lock_acquire (&streams_lock);
+  f->next = streams;
+  streams = f;
+  lock_release (&streams_lock);
+  return f;
+}
+
+/* Flushes and closes stream F and its file descriptor.  Returns
+   0 if successful, EOF if flushing failed.  stdin and stdout are
+   not freed, but are left closed, so that any later use of them
+   fails. */
+int
+fclose (FILE *f)
+{
+  int retval;
+  FILE **fp;
+
+  lock_acquire (&streams_lock);
+  lock_acquire (&f->lock);
+  retval = flush_stream (f);
+  for (fp = &streams; *fp != NULL; fp = &(*fp)->next)
+    if (*fp == f)
+      {
+        *fp = f->next;
+        break;
+      }
+  lock_release (&streams_lock);
+
+  close (f->fd);
+  if (f->flags & F_OWNBUF)
+    free (f->buf);
+  if (f != stdin && f != stdout)
+    free (f);
+  else
+    {
+      f->flags = 0;
+      f->buf = f->pos = f->end = NULL;
+      f->buf_size = 0;
+      f->next = NULL;
+      lock_release (&f->lock);
+    }
+  return retval;
+}
+
+/* Sets the buffering MODE of stream F, which must not have been
+   used for input or output yet.  If BUF is non-null, the stream
+   uses the SIZE bytes at BUF as its buffer; otherwise it
+   allocates a buffer of SIZE bytes, or BUFSIZ if SIZE is 0.
+   Returns 0 if successful, nonzero on failure. */
+int
+setvbuf (FILE *f, char *buf, int mode, size_t size)
+{
+  if ((mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+      || (buf != NULL && size == 0))
+    return EOF;
+
+  lock_acquire (&f->lock);
+  if (f->buf != NULL)
+    {
+      lock_release (&f->lock);
+      return EOF;
+    }
+  f->buf_mode = mode;
+  if (mode != _IONBF)
+    {
+      f->buf = buf;
+      f->buf_size = size != 0 ? size : BUFSIZ;
+      f->pos = f->end = buf;
+    }
+  lock_release (&f->lock);
+  return 0;
+}
+
+/* Writes any output pending in stream F to its file descriptor.
+   If F is a null pointer, does so for every open stream.
+   Discards data read ahead by input streams.
+   Returns 0 if successful, EOF on failure. */
+int
+fflush (FILE *f)
+{
+  int retval = 0;
+
+  if (f == NULL)
+    {
+      lock_acquire (&streams_lock);
+      for (f = streams; f != NULL; f = f->next)
+        /* F_WRITE does not change while a stream is open.  Checking
+           it first skips read-only streams without waiting for
+           their locks, which a thread blocked reading may hold. */
+        if (f->flags & F_WRITE)
+          {
+            lock_acquire (&f->lock);
+            if (f->flags & F_WRITING && flush_output (f) == EOF)
+              retval = EOF;
+            lock_release (&f->lock);
+          }
+      lock_release (&streams_lock);
+      return retval;
+    }
+
+  lock_acquire (&f->lock);
+  retval = flush_stream (f);
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Does the work of fflush() for non-null F, whose lock must be
+   held. */
+static int
+flush_stream (FILE *f)
+{
+  if (f->flags & F_WRITING)
+    return flush_output (f);
+  if (f->flags & F_READING)
+    drop_input (f);
+  return 0;
+}
+
+/* Reads up to CNT elements of SIZE bytes each from stream F
+   into BUFFER.  Returns the number of elements fully read,
+   which is less than CNT only at end of file or on error. */
+size_t
+fread (void *buffer, size_t size, size_t cnt, FILE *f)
+{
+  size_t retval;
+
+  lock_acquire (&f->lock);
+  retval = fread_unlocked (buffer, size, cnt, f);
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Does the work of fread() with F's lock held. */
+static size_t
+fread_unlocked (void *buffer, size_t size, size_t cnt, FILE *f)
+{
+  char *dst = buffer;
+  size_t total, left;
+
+  if (!check_size (f, size, cnt))
+    return 0;
+  total = left = size * cnt;
+  if (total == 0 || !start_read (f))
+    return 0;
+
+  while (left > 0)
+    {
+      size_t avail = f->end - f->pos;
+
+      if (avail > 0)
+        {
+          size_t n = avail < left ? avail : left;
+          memcpy (dst, f->pos, n);
+          f->pos += n;
+          dst += n;
+          left -= n;
+        }
+      else if (left >= f->buf_size)
+        {
+          /* Too big to be worth buffering: read directly. */
+          int n = read (f->fd, dst, left);
+          if (n <= 0)
+            {
+              f->flags |= n == 0 ? F_EOF : F_ERR;
+              break;
+            }
+          dst += n;
+          left -= n;
+        }
+      else if (!refill (f))
+        break;
+    }
+  return (total - left) / size;
+}
+
+/* Writes CNT elements of SIZE bytes each from BUFFER to stream
+   F.  Returns the number of elements written, which is less than
+   CNT only on error. */
+size_t
+fwrite (const void *buffer, size_t size, size_t cnt, FILE *f)
+{
+  size_t retval;
+
+  lock_acquire (&f->lock);
+  retval = fwrite_unlocked (buffer, size, cnt, f);
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Does the work of fwrite() with F's lock held. */
+static size_t
+fwrite_unlocked (const void *buffer, size_t size, size_t cnt, FILE *f)
+{
+  const char *src = buffer;
+  size_t total, left;
+
+  if (!check_size (f, size, cnt))
+    return 0;
+  total = left = size * cnt;
+  if (total == 0 || !start_write (f))
+    return 0;
+
+  if (left >= f->buf_size)
+    {
+      /* Too big to be worth buffering: write directly. */
+      if (flush_output (f) == EOF || !write_all (f, src, left))
+        return 0;
+      return cnt;
+    }
+
+  while (left > 0)
+    {
+      size_t room = f->buf + f->buf_size - f->pos;
+      size_t n = room < left ? room : left;
+
+      memcpy (f->pos, src, n);
+      f->pos += n;
+      src += n;
+      left -= n;
+      if (f->pos == f->buf + f->buf_size && flush_output (f) == EOF)
+        return (total - left) / size;
+    }
+
+  if (f->buf_mode == _IONBF
+      || (f->buf_mode == _IOLBF && memchr (buffer, '\n', total) != NULL))
+    if (flush_output (f) == EOF)
+      return 0;
+  return cnt;
+}
+
+/* Reads and returns one byte from stream F, or EOF at end of
+   file or on error. */
+int
+fgetc (FILE *f)
+{
+  int c = EOF;
+
+  lock_acquire (&f->lock);
+  if (start_read (f) && (f->pos < f->end || refill (f)))
+    c = (unsigned char) *f->pos++;
+  lock_release (&f->lock);
+  return c;
+}
+
+/* Writes C, converted to unsigned char, to stream F.  Returns C
+   if successful, EOF on error. */
+int
+fputc (int c, FILE *f)
+{
+  int retval = EOF;
+
+  lock_acquire (&f->lock);
+  if (start_write (f))
+    {
+      bool flush;
+
+      *f->pos++ = c;
+      flush = (f->pos == f->buf + f->buf_size
+               || f->buf_mode == _IONBF
+               || (f->buf_mode == _IOLBF && c == '\n'));
+      if (!flush || flush_output (f) != EOF)
+        retval = (unsigned char) c;
+    }
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Reads a line from stream F into S, which has room for SIZE
+   bytes, stopping after a new-line character, at end of file, or
+   when SIZE - 1 bytes have been read, and null-terminates it.
+   Returns S, or a null pointer if end of file or an error
+   occurred before any bytes were read. */
+char *
+fgets (char *s, int size, FILE *f)
+{
+  char *retval;
+
+  lock_acquire (&f->lock);
+  retval = fgets_unlocked (s, size, f);
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Does the work of fgets() with F's lock held. */
+static char *
+fgets_unlocked (char *s, int size, FILE *f)
+{
+  char *dst = s;
+
+  if (size <= 0 || !start_read (f))
+    return NULL;
+
+  while (dst < s + size - 1)
+    {
+      size_t avail, n;
+      char *nl;
+
+      if (f->pos == f->end && !refill (f))
+        break;
+
+      avail = f->end - f->pos;
+      n = (size_t) (s + size - 1 - dst);
+      if (n > avail)
+        n = avail;
+      nl = memchr (f->pos, '\n', n);
+      if (nl != NULL)
+        n = nl - f->pos + 1;
+
+      memcpy (dst, f->pos, n);
+      f->pos += n;
+      dst += n;
+      if (nl != NULL)
+        break;
+    }
+
+  if (dst == s)
+    return NULL;
+  *dst = '\0';
+  return s;
+}
+
+/* Writes string S to stream F.  Returns 0 if successful, EOF on
+   error. */
+int
+fputs (const char *s, FILE *f)
+{
+  size_t len = strlen (s);
+  return len == 0 || fwrite (s, len, 1, f) == 1 ? 0 : EOF;
+}
+
+/* Like printf(), but writes output to stream F. */
+int
+fprintf (FILE *f, const char *format, ...)
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (f, format, args);
+  va_end (args);
+
+  return retval;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux
+  {
+    FILE *f;                    /* Output stream. */
+    int char_cnt;               /* Total characters written so far. */
+    bool newline;               /* Whether a new-line was written. */
+  };
+
+/* Adds C to the buffer of the stream in AUX, flushing it if the
+   buffer fills up. */
+static void
+vfprintf_helper (char c, void *aux_)
+{
+  struct vfprintf_aux *aux = aux_;
+  FILE *f = aux->f;
+
+  *f->pos++ = c;
+  if (f->pos == f->buf + f->buf_size)
+    flush_output (f);
+  if (c == '\n')
+    aux->newline = true;
+  aux->char_cnt++;
+}
+
+/* Like vprintf(), but writes output to stream F. */
+int
+vfprintf (FILE *f, const char *format, va_list args)
+{
+  int retval;
+
+  lock_acquire (&f->lock);
+  retval = vfprintf_unlocked (f, format, args);
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Does the work of vfprintf() with F's lock held. */
+static int
+vfprintf_unlocked (FILE *f, const char *format, va_list args)
+{
+  struct vfprintf_aux aux;
+
+  if (!start_write (f))
+    return EOF;
+
+  aux.f = f;
+  aux.char_cnt = 0;
+  aux.newline = false;
+  __vprintf (format, args, vfprintf_helper, &aux);
+
+  if (f->buf_mode == _IONBF || (f->buf_mode == _IOLBF && aux.newline))
+    flush_output (f);
+  return f->flags & F_ERR ? EOF : aux.char_cnt;
+}
+
+/* Sets the position of stream F to OFFSET bytes from the
+   beginning of the file, the current position, or the end of the
+   file, according to WHENCE.  Returns 0 if successful, -1 on
+   failure. */
+int
+fseek (FILE *f, long offset, int whence)
+{
+  int retval = -1;
+
+  if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END)
+    return -1;
+
+  lock_acquire (&f->lock);
+  if (whence == SEEK_CUR)
+    offset += tell_stream (f);
+  else if (whence == SEEK_END)
+    offset += filesize (f->fd);
+  if (offset >= 0 && flush_stream (f) != EOF)
+    {
+      seek (f->fd, offset);
+      f->flags &= ~F_EOF;
+      retval = 0;
+    }
+  lock_release (&f->lock);
+  return retval;
+}
+
+/* Returns the current position of stream F. */
+long
+ftell (FILE *f)
+{
+  long pos;
+
+  lock_acquire (&f->lock);
+  pos = tell_stream (f);
+  lock_release (&f->lock);
+  return pos;
+}
+
+/* Does the work of ftell() with F's lock held. */
+static long
+tell_stream (FILE *f)
+{
+  long pos = tell (f->fd);
+  if (f->flags & F_WRITING)
+    pos += f->pos - f->buf;
+  else if (f->flags & F_READING)
+    pos -= f->end - f->pos;
+  return pos;
+}
+
+/* Returns nonzero if end of file has been reached on stream F. */
+int
+feof (FILE *f)
+{
+  return (f->flags & F_EOF) != 0;
+}
+
+/* Returns nonzero if an error has occurred on stream F. */
+int
+ferror (FILE *f)
+{
+  return (f->flags & F_ERR) != 0;
+}
+
+/* Clears the end-of-file and error indicators of stream F. */
+void
+clearerr (FILE *f)
+{
+  lock_acquire (&f->lock);
+  f->flags &= ~(F_EOF | F_ERR);
+  lock_release (&f->lock);
+}
+
+/* Returns the file descriptor of stream F. */
+int
+fileno (FILE *f)
+{
+  return f->fd;
+}
+
+/* Returns the F_* access flags for fopen() mode string MODE, or
+   0 if MODE is invalid. */
+static unsigned
+parse_mode (const char *mode)
+{
+  unsigned flags;
+
+  switch (mode[0])
+    {
+    case 'r':
+      flags = F_READ;
+      break;
+    case 'w':
+      flags = F_WRITE;
+      break;
+    case 'a':
+      flags = F_WRITE | F_APPEND;
+      break;
+    default:
+      return 0;
+    }
+  if (strchr (mode + 1, '+') != NULL)
+    flags |= F_READ | F_WRITE;
+  return flags;
+}
+
+/* Checks that CNT elements of SIZE bytes each, as passed to
+   fread() or fwrite() on stream F, add up to no more than
+   SIZE_MAX bytes.  If not, sets F's error indicator and returns
+   false. */
+static bool
+check_size (FILE *f, size_t size, size_t cnt)
+{
+  if (cnt != 0 && size > SIZE_MAX / cnt)
+    {
+      f->flags |= F_ERR;
+      return false;
+    }
+  return true;
+}
+
+/* Makes sure that stream F has a buffer.  Returns true if
+   successful, false on failure. */
+static bool
+setup_buffer (FILE *f)
+{
+  if (f->buf != NULL)
+    return true;
+
+  if (f->buf_mode != _IONBF)
+    {
+      f->buf = malloc (f->buf_size != 0 ? f->buf_size : BUFSIZ);
+      if (f->buf != NULL)
+        {
+          f->flags |= F_OWNBUF;
+          if (f->buf_size == 0)
+            f->buf_size = BUFSIZ;
+        }
+      else
+        f->buf_mode = _IONBF;
+    }
+  if (f->buf_mode == _IONBF)
+    {
+      f->buf = f->small_buf;
+      f->buf_size = sizeof f->small_buf;
+    }
+  f->pos = f->end = f->buf;
+  return true;
+}
+
+/* Prepares stream F for reading.  Returns true if successful,
+   false if F is not open for reading. */
+static bool
+start_read (FILE *f)
+{
+  if (!(f->flags & F_READ))
+    {
+      f->flags |= F_ERR;
+      return false;
+    }
+  if (f->flags & F_READING)
+    return true;
+
+  if (f->flags & F_WRITING && flush_output (f) == EOF)
+    return false;
+  if (f->fd == STDIN_FILENO)
+    fflush (stdout);
+  if (!setup_buffer (f))
+    return false;
+  f->flags = (f->flags & ~F_WRITING) | F_READING;
+  f->pos = f->end = f->buf;
+  return true;
+}
+
+/* Prepares stream F for writing.  Returns true if successful,
+   false if F is not open for writing. */
+static bool
+start_write (FILE *f)
+{
+  if (!(f->flags & F_WRITE))
+    {
+      f->flags |= F_ERR;
+      return false;
+    }
+  if (f->flags & F_WRITING)
+    return true;
+
+  if (f->flags & F_READING)
+    drop_input (f);
+  if (!setup_buffer (f))
+    return false;
+  f->flags = (f->flags & ~F_READING) | F_WRITING;
+  f->pos = f->end = f->buf;
+  return true;
+}
+
+/* Reads more data into the empty buffer of stream F, which must
+   be reading.  Returns true if any data was read, false at end
+   of file or on error. */
+static bool
+refill (FILE *f)
+{
+  int n = read (f->fd, f->buf, f->buf_mode == _IONBF ? 1 : f->buf_size);
+  if (n <= 0)
+    {
+      f->flags |= n == 0 ? F_EOF : F_ERR;
+      f->pos = f->end = f->buf;
+      return false;
+    }
+  f->pos = f->buf;
+  f->end = f->buf + n;
+  return true;
+}
+
+/* Writes the pending output of stream F, which must be writing,
+   to its file descriptor.  Returns 0 if successful, EOF on
+   error. */
+static int
+flush_output (FILE *f)
+{
+  size_t n = f->pos - f->buf;
+
+  f->pos = f->buf;
+  return n == 0 || write_all (f, f->buf, n) ? 0 : EOF;
+}
+
+/* Discards the read-ahead data of stream F, which must be
+   reading, moving its file descriptor's position back to match
+   the stream's. */
+static void
+drop_input (FILE *f)
+{
+  if (f->end > f->pos)
+    seek (f->fd, tell (f->fd) - (f->end - f->pos));
+  f->pos = f->end = f->buf;
+  f->flags &= ~F_READING;
+}
+
+/* Writes the SIZE bytes at BUF to the file descriptor of stream
+   F, seeking to the end of the file first for append streams.
+   Returns true if successful, false on error. */
+static bool
+write_all (FILE *f, const char *buf, size_t size)
+{
+  if (f->flags & F_APPEND)
+    seek (f->fd, filesize (f->fd));
+
+  while (size > 0)
+    {
+      int n = write (f->fd, buf, size);
+      if (n <= 0)
+        {
+          f->flags |= F_ERR;
+          return false;
+        }
+      buf += n;
+      size -= n;
+    }
+  return true;
+}
@@ -4,4 +4,52 @@
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffered streams.  See stdio.c for details. */
+typedef struct FILE FILE;
+
+/* Default stream buffer size. */
+#define BUFSIZ 4096
+
+/* Returned by character input functions at end of file. */
+#define EOF (-1)
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0                /* Fully buffered. */
+#define _IOLBF 1                /* Line buffered. */
+#define _IONBF 2                /* Unbuffered. */
+
+/* Origins for fseek(). */
+#define SEEK_SET 0              /* Beginning of file. */
+#define SEEK_CUR 1              /* Current position. */
+#define SEEK_END 2              /* End of file. */
+
+extern FILE *stdin;
+extern FILE *stdout;
+
+FILE *fopen (const char *name, const char *mode);
+FILE *fdopen (int fd, const char *mode);
+int fclose (FILE *);
+int setvbuf (FILE *, char *buf, int mode, size_t size);
+int fflush (FILE *);
+
+size_t fread (void *, size_t size, size_t cnt, FILE *);
+size_t fwrite (const void *, size_t size, size_t cnt, FILE *);
+int fgetc (FILE *);
+int fputc (int, FILE *);
+char *fgets (char *, int size, FILE *);
+int fputs (const char *, FILE *);
+int fprintf (FILE *, const char *, ...) PRINTF_FORMAT (2, 3);
+int vfprintf (FILE *, const char *, va_list) PRINTF_FORMAT (2, 0);
+
+int fseek (FILE *, long offset, int whence);
+long ftell (FILE *);
+int feof (FILE *);
+int ferror (FILE *);
+void clearerr (FILE *);
+int fileno (FILE *);
+
+#define getc(F) fgetc (F)
+#define putc(C, F) fputc (C, F)
+#define getchar() fgetc (stdin)
+
 #endif /* lib/user/stdio.h */
@@ -1,4 +1,5 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
@@ -64,6 +65,7 @@
 void
 halt (void) 
 {
+  fflush (NULL);
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +73,7 @@ halt (void)
 void
 exit (int status)
 {
+  fflush (NULL);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -182,3 +185,133 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+void *
+sbrk (intptr_t increment) 
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+brk (void *addr) 
+{
+  char *cur = sbrk (0);
+  return sbrk ((char *) addr - cur) != SBRK_FAILED ? 0 : -1;
+}
+
+bool
+fsstats (struct fs_stats *stats) 
+{
+  return syscall1 (SYS_FSSTATS, stats);
+}
+
+int
+defrag (const char *file) 
+{
+  return syscall1 (SYS_DEFRAG, file);
+}
+
+int
+fcntl (int fd, int cmd, int arg) 
+{
+  return syscall3 (SYS_FCNTL, fd, cmd, arg);
+}
+
+bool
+truncate (const char *file, unsigned length) 
+{
+  return syscall2 (SYS_TRUNCATE, file, length);
+}
+
+bool
+ftruncate (int fd, unsigned length) 
+{
+  return syscall2 (SYS_FTRUNCATE, fd, length);
+}
+
+bool
+fallocate (int fd, unsigned offset, unsigned length) 
+{
+  return syscall3 (SYS_FALLOCATE, fd, offset, length);
+}
+
+bool
+reflink (const char *file, const char *new_file) 
+{
+  return syscall2 (SYS_REFLINK, file, new_file);
+}
+
+int
+dedup (void) 
+{
+  return syscall0 (SYS_DEDUP);
+}
+
+bool
+pipe (int fds[2]) 
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+dup2 (int old_fd, int new_fd) 
+{
+  return syscall2 (SYS_DUP2, old_fd, new_fd);
+}
+
+void *
+shm_map (int key, size_t size) 
+{
+  return (void *) syscall2 (SYS_SHM_MAP, key, size);
+}
+
+bool
+shm_unmap (void *addr) 
+{
+  return syscall1 (SYS_SHM_UNMAP, addr);
+}
+
+bool
+futex_wait (int *addr, int expected) 
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int cnt) 
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Runs FUNC (AUX) in a thread created by uthread_create(), then
+   exits the thread with its return value. */
+static void
+uthread_start (uthread_func *func, void *aux) 
+{
+  uthread_exit (func (aux));
+}
+
+uthread_t
+uthread_create (uthread_func *func, void *aux) 
+{
+  return syscall3 (SYS_UTHREAD_CREATE, uthread_start, func, aux);
+}
+
+int
+uthread_join (uthread_t tid) 
+{
+  return syscall1 (SYS_UTHREAD_JOIN, tid);
+}
+
+void
+uthread_exit (int status) 
+{
+  syscall1 (SYS_UTHREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+int
+poll (struct pollfd *fds, unsigned nfds, int timeout) 
+{
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
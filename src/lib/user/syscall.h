@@ -2,16 +2,68 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int uthread_t;
+#define UTHREAD_ERROR ((uthread_t) -1)
+
+/* A function run by a thread created with uthread_create(). */
+typedef int uthread_func (void *aux);
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Return value of sbrk() on failure. */
+#define SBRK_FAILED ((void *) -1)
+
+/* File system statistics, as reported by fsstats(). */
+struct fs_stats 
+  {
+    long long ticks;            /* Timer ticks since boot. */
+    int ticks_per_sec;          /* Timer ticks per second. */
+    long long cache_hits;       /* Buffer cache hits. */
+    long long cache_misses;     /* Buffer cache misses. */
+    long long sectors_read;     /* Sectors read from file system device. */
+    long long sectors_written;  /* Sectors written to file system device. */
+  };
+
+/* Commands for fcntl(). */
+#define F_GETFL 1               /* Return the file status flags. */
+#define F_SETFL 2               /* Set the file status flags. */
+
+/* File status flags. */
+#define O_DIRECT 0x1            /* Bypass the buffer cache. */
+#define O_COMPRESS 0x2          /* Store the file compressed.  This
+                                   belongs to the file, not the
+                                   descriptor, and can only be
+                                   changed while the file is empty. */
+#define O_NONBLOCK 0x4          /* Reads and writes return what they
+                                   can at once, or -1 if that is
+                                   nothing, instead of waiting. */
+
+/* A descriptor to check with poll(). */
+struct pollfd 
+  {
+    int fd;                     /* Descriptor, or negative to skip. */
+    short events;               /* Events of interest. */
+    short revents;              /* Events that occurred. */
+  };
+
+/* poll() events. */
+#define POLLIN 0x1              /* Reading would not wait. */
+#define POLLOUT 0x4             /* Writing would not wait. */
+#define POLLERR 0x8             /* Pipe has no readers left. */
+#define POLLHUP 0x10            /* Pipe has no writers left. */
+#define POLLNVAL 0x20           /* Descriptor is not open. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -45,4 +97,26 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void *sbrk (intptr_t increment);
+int brk (void *addr);
+bool fsstats (struct fs_stats *);
+int defrag (const char *file);
+int fcntl (int fd, int cmd, int arg);
+bool truncate (const char *file, unsigned length);
+bool ftruncate (int fd, unsigned length);
+bool fallocate (int fd, unsigned offset, unsigned length);
+bool reflink (const char *file, const char *new_file);
+int dedup (void);
+bool pipe (int fds[2]);
+int dup2 (int old_fd, int new_fd);
+void *shm_map (int key, size_t size);
+bool shm_unmap (void *addr);
+bool futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+uthread_t uthread_create (uthread_func *, void *aux);
+int uthread_join (uthread_t);
+void uthread_exit (int status) NO_RETURN;
+int poll (struct pollfd *, unsigned nfds, int timeout);
+
 #endif /* lib/user/syscall.h */
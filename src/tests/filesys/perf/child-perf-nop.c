@@ -0,0 +1,9 @@
+/* Child process for perf-exec.  Does nothing. */
+
+int main (void);
+
+int
+main (void) 
+{
+  return 0;
+}
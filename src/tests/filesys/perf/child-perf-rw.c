@@ -0,0 +1,59 @@
+/* Child process for perf-concurrent.
+   With argument "r", reads random blocks of the shared file.
+   With argument "w", writes its own file sequentially, then
+   again from the start. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/perf/child-perf-rw.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-perf-rw";
+
+int
+main (int argc, char *argv[]) 
+{
+  char *buf = xmalloc (CHILD_REQUEST_SIZE);
+  int child_idx, fd, op;
+
+  quiet = true;
+  CHECK (argc == 3, "argc must be 3, actually %d", argc);
+  child_idx = atoi (argv[2]);
+  random_init (child_idx);
+
+  if (!strcmp (argv[1], "r")) 
+    {
+      CHECK ((fd = open (CHILD_SHARED_FILE)) > 1,
+             "open \"%s\"", CHILD_SHARED_FILE);
+      for (op = 0; op < CHILD_OP_CNT; op++) 
+        {
+          seek (fd, (random_ulong () % (CHILD_FILE_SIZE / CHILD_REQUEST_SIZE))
+                    * CHILD_REQUEST_SIZE);
+          if (read (fd, buf, CHILD_REQUEST_SIZE) != CHILD_REQUEST_SIZE)
+            fail ("read failed");
+        }
+    }
+  else 
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "w%d", child_idx);
+      remove (name);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      random_bytes (buf, CHILD_REQUEST_SIZE);
+      for (op = 0; op < CHILD_OP_CNT; op++) 
+        {
+          if (op % (CHILD_FILE_SIZE / CHILD_REQUEST_SIZE) == 0)
+            seek (fd, 0);
+          if (write (fd, buf, CHILD_REQUEST_SIZE) != CHILD_REQUEST_SIZE)
+            fail ("write failed");
+        }
+    }
+  close (fd);
+  return child_idx;
+}
@@ -0,0 +1,16 @@
+#ifndef TESTS_FILESYS_PERF_CHILD_PERF_RW_H
+#define TESTS_FILESYS_PERF_CHILD_PERF_RW_H
+
+/* File read by all readers. */
+#define CHILD_SHARED_FILE "shared"
+
+/* Size of the shared file and of each writer's file. */
+#define CHILD_FILE_SIZE (128 * 1024)
+
+/* Bytes per read or write. */
+#define CHILD_REQUEST_SIZE 4096
+
+/* Reads or writes done by each child. */
+#define CHILD_OP_CNT 64
+
+#endif /* tests/filesys/perf/child-perf-rw.h */
@@ -0,0 +1,51 @@
+/* Measures aggregate throughput with several processes reading
+   a shared file and writing files of their own at the same
+   time. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/child-perf-rw.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MAX_CHILDREN 4
+
+/* Numbers of readers and writers to run together. */
+static const struct 
+  {
+    int readers;
+    int writers;
+  }
+mixes[] = {{4, 0}, {2, 2}, {0, 4}};
+
+void
+test_main (void) 
+{
+  char *buf = xmalloc (CHILD_REQUEST_SIZE);
+  size_t i;
+
+  random_bytes (buf, CHILD_REQUEST_SIZE);
+  msg ("create shared file");
+  make_file (CHILD_SHARED_FILE, CHILD_FILE_SIZE, buf, CHILD_REQUEST_SIZE);
+
+  for (i = 0; i < sizeof mixes / sizeof *mixes; i++) 
+    {
+      pid_t readers[MAX_CHILDREN], writers[MAX_CHILDREN];
+      int child_cnt = mixes[i].readers + mixes[i].writers;
+      char params[64];
+      struct perf p;
+
+      snprintf (params, sizeof params, "readers=%d writers=%d size=%d",
+                mixes[i].readers, mixes[i].writers, CHILD_REQUEST_SIZE);
+
+      perf_begin (&p, "concurrent");
+      exec_perf_children ("child-perf-rw", "r", readers, mixes[i].readers);
+      exec_perf_children ("child-perf-rw", "w", writers, mixes[i].writers);
+      wait_children (readers, mixes[i].readers);
+      wait_children (writers, mixes[i].writers);
+      perf_end (&p, params, (long) child_cnt * CHILD_OP_CNT,
+                (long long) child_cnt * CHILD_OP_CNT * CHILD_REQUEST_SIZE);
+    }
+}
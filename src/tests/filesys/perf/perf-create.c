@@ -0,0 +1,56 @@
+/* Measures the rate of creating and deleting many small files,
+   in repeated storms. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 100
+#define ROUND_CNT 4
+#define FILE_SIZE 100
+
+void
+test_main (void) 
+{
+  char data[FILE_SIZE];
+  int round;
+
+  msg ("%d rounds of %d files", ROUND_CNT, FILE_CNT);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      char params[64];
+      struct perf p;
+      int i;
+
+      snprintf (params, sizeof params, "round=%d files=%d file_size=%d",
+                round, FILE_CNT, FILE_SIZE);
+
+      perf_begin (&p, "create");
+      for (i = 0; i < FILE_CNT; i++) 
+        {
+          char name[16];
+          int fd;
+
+          snprintf (name, sizeof name, "s%d", i);
+          if (!create (name, 0) || (fd = open (name)) < 2)
+            fail ("create \"%s\" failed", name);
+          if (write (fd, data, FILE_SIZE) != FILE_SIZE)
+            fail ("write \"%s\" failed", name);
+          close (fd);
+        }
+      perf_end (&p, params, FILE_CNT, (long long) FILE_CNT * FILE_SIZE);
+
+      perf_begin (&p, "delete");
+      for (i = 0; i < FILE_CNT; i++) 
+        {
+          char name[16];
+
+          snprintf (name, sizeof name, "s%d", i);
+          if (!remove (name))
+            fail ("remove \"%s\" failed", name);
+        }
+      perf_end (&p, params, FILE_CNT, 0);
+    }
+}
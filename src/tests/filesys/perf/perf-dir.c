@@ -0,0 +1,67 @@
+/* Measures creating many files in one directory, then looking
+   them up in random order, then looking up names that are not
+   there. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 400
+
+void
+test_main (void) 
+{
+  static int order[FILE_CNT];
+  char name[32], params[64];
+  struct perf p;
+  int i;
+
+  CHECK (mkdir ("big"), "mkdir \"big\"");
+  snprintf (params, sizeof params, "files=%d", FILE_CNT);
+
+  perf_begin (&p, "dir-create");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "big/file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  perf_end (&p, params, FILE_CNT, 0);
+
+  for (i = 0; i < FILE_CNT; i++)
+    order[i] = i;
+  shuffle (order, FILE_CNT, sizeof *order);
+
+  perf_begin (&p, "dir-lookup");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "big/file%d", order[i]);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  perf_end (&p, params, FILE_CNT, 0);
+
+  perf_begin (&p, "dir-lookup-miss");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "big/none%d", i);
+      if (open (name) != -1)
+        fail ("open \"%s\" succeeded", name);
+    }
+  perf_end (&p, params, FILE_CNT, 0);
+
+  perf_begin (&p, "dir-remove");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "big/file%d", order[i]);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  perf_end (&p, params, FILE_CNT, 0);
+}
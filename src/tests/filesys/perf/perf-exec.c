@@ -0,0 +1,30 @@
+/* Measures the rate at which a process can launch a trivial
+   child and wait for it to exit. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LAUNCH_CNT 20
+
+void
+test_main (void) 
+{
+  char params[32];
+  struct perf p;
+  int i;
+
+  snprintf (params, sizeof params, "launches=%d", LAUNCH_CNT);
+  perf_begin (&p, "exec");
+  for (i = 0; i < LAUNCH_CNT; i++) 
+    {
+      pid_t pid = exec ("child-perf-nop");
+      if (pid == PID_ERROR)
+        fail ("exec \"child-perf-nop\" failed");
+      if (wait (pid) != 0)
+        fail ("child-perf-nop did not exit cleanly");
+    }
+  perf_end (&p, params, LAUNCH_CNT, 0);
+}
@@ -0,0 +1,63 @@
+/* Measures random-access read and write throughput within a
+   file much larger than the buffer cache, for several request
+   sizes. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (512 * 1024)
+#define OP_CNT 256
+
+static const size_t request_sizes[] = {512, 4096, 16384};
+
+void
+test_main (void) 
+{
+  static const char file_name[] = "random";
+  char *buf = xmalloc (16384);
+  size_t i;
+  int fd;
+
+  random_bytes (buf, 16384);
+  msg ("create %d-byte file", FILE_SIZE);
+  make_file (file_name, FILE_SIZE, buf, 16384);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  for (i = 0; i < sizeof request_sizes / sizeof *request_sizes; i++) 
+    {
+      size_t size = request_sizes[i];
+      char params[64];
+      struct perf p;
+      int op;
+
+      snprintf (params, sizeof params, "size=%zu file_size=%d",
+                size, FILE_SIZE);
+
+      perf_begin (&p, "random-read");
+      for (op = 0; op < OP_CNT; op++) 
+        {
+          size_t ofs = random_ulong () % (FILE_SIZE / size) * size;
+          seek (fd, ofs);
+          if (read (fd, buf, size) != (int) size)
+            fail ("read %zu bytes at offset %zu failed", size, ofs);
+        }
+      perf_end (&p, params, OP_CNT, (long long) OP_CNT * size);
+
+      perf_begin (&p, "random-write");
+      for (op = 0; op < OP_CNT; op++) 
+        {
+          size_t ofs = random_ulong () % (FILE_SIZE / size) * size;
+          seek (fd, ofs);
+          if (write (fd, buf, size) != (int) size)
+            fail ("write %zu bytes at offset %zu failed", size, ofs);
+        }
+      perf_end (&p, params, OP_CNT, (long long) OP_CNT * size);
+    }
+
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
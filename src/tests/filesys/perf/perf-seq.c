@@ -0,0 +1,61 @@
+/* Measures sequential write and read throughput on a file much
+   larger than the buffer cache, for several request sizes, both
+   through the buffer cache and with direct I/O. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (512 * 1024)
+
+static const size_t request_sizes[] = {512, 4096, 16384, 65536};
+
+void
+test_main (void) 
+{
+  char *buf = xmalloc (65536);
+  size_t i;
+  int direct;
+
+  random_bytes (buf, 65536);
+  for (direct = 0; direct <= 1; direct++)
+    for (i = 0; i < sizeof request_sizes / sizeof *request_sizes; i++) 
+      {
+        size_t size = request_sizes[i];
+        const char *suffix = direct ? "-direct" : "";
+        char name[16], bench[32], params[64];
+        struct perf p;
+        size_t ofs;
+        int fd;
+
+        snprintf (name, sizeof name, "seq-%zu%s", size, direct ? "d" : "");
+        snprintf (params, sizeof params, "size=%zu file_size=%d",
+                  size, FILE_SIZE);
+        CHECK (create (name, 0), "create \"%s\"", name);
+        CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+        if (direct)
+          CHECK (fcntl (fd, F_SETFL, O_DIRECT) == 0,
+                 "set O_DIRECT on \"%s\"", name);
+
+        snprintf (bench, sizeof bench, "seq-write%s", suffix);
+        perf_begin (&p, bench);
+        for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+          if (write (fd, buf, size) != (int) size)
+            fail ("write %zu bytes at offset %zu failed", size, ofs);
+        perf_end (&p, params, FILE_SIZE / size, FILE_SIZE);
+
+        seek (fd, 0);
+        snprintf (bench, sizeof bench, "seq-read%s", suffix);
+        perf_begin (&p, bench);
+        for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+          if (read (fd, buf, size) != (int) size)
+            fail ("read %zu bytes at offset %zu failed", size, ofs);
+        perf_end (&p, params, FILE_SIZE / size, FILE_SIZE);
+
+        close (fd);
+        CHECK (remove (name), "remove \"%s\"", name);
+      }
+}
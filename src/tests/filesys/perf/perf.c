@@ -0,0 +1,118 @@
+/* Measurement and reporting for the file system benchmarks.
+
+   Each measurement prints one summary line that starts with
+   "perf:" and consists of space-separated KEY=VALUE pairs, for
+   example:
+
+     perf: bench=seq-read size=4096 ops=256 bytes=1048576 ticks=12
+       ops_per_sec=2133 kb_per_sec=8533 us_per_op=468
+       cache_hits=1900 cache_misses=148 sectors_read=148
+       sectors_written=0
+
+   (all on one line).  `make perf' collects these lines from
+   every benchmark into perf.summary, which can be compared
+   across kernels.
+
+   Times are measured in timer ticks, so measurements shorter
+   than a few ticks are imprecise.  Rates are computed as if every
+   measurement took at least one tick.  The cache and sector
+   counts are the differences over the measurement, system-wide,
+   so they include work done by other processes running at the
+   same time. */
+
+#include "tests/filesys/perf/perf.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/lib.h"
+
+/* Starts measurement P of benchmark BENCH. */
+void
+perf_begin (struct perf *p, const char *bench) 
+{
+  p->bench = bench;
+  if (!fsstats (&p->start))
+    fail ("fsstats failed");
+}
+
+/* Ends measurement P, which performed OPS operations that
+   transferred BYTES bytes in total, and prints its summary line.
+   PARAMS, if nonnull, is a string of additional KEY=VALUE pairs
+   that identify the workload. */
+void
+perf_end (struct perf *p, const char *params, long ops, long long bytes) 
+{
+  struct fs_stats end;
+  long long ticks, t;
+
+  if (!fsstats (&end))
+    fail ("fsstats failed");
+  ticks = end.ticks - p->start.ticks;
+  t = ticks > 0 ? ticks : 1;
+
+  printf ("perf: bench=%s%s%s ops=%ld bytes=%lld ticks=%lld "
+          "ops_per_sec=%lld kb_per_sec=%lld us_per_op=%lld "
+          "cache_hits=%lld cache_misses=%lld "
+          "sectors_read=%lld sectors_written=%lld\n",
+          p->bench, params != NULL ? " " : "", params != NULL ? params : "",
+          ops, bytes, ticks,
+          ops * end.ticks_per_sec / t,
+          bytes * end.ticks_per_sec / t / 1024,
+          ops > 0 ? t * 1000000 / end.ticks_per_sec / ops : 0,
+          end.cache_hits - p->start.cache_hits,
+          end.cache_misses - p->start.cache_misses,
+          end.sectors_read - p->start.sectors_read,
+          end.sectors_written - p->start.sectors_written);
+}
+
+/* Returns a new block of SIZE bytes, failing the benchmark if
+   memory is not available. */
+void *
+xmalloc (size_t size) 
+{
+  void *p = malloc (size);
+  if (p == NULL)
+    fail ("out of memory allocating %zu bytes", size);
+  return p;
+}
+
+/* Creates file NAME with SIZE bytes of data, written BUF_SIZE
+   bytes at a time from BUF. */
+void
+make_file (const char *name, size_t size, char *buf, size_t buf_size) 
+{
+  size_t ofs;
+  int fd;
+
+  if (!create (name, 0))
+    fail ("create \"%s\" failed", name);
+  fd = open (name);
+  if (fd < 0)
+    fail ("open \"%s\" failed", name);
+  for (ofs = 0; ofs < size; ofs += buf_size) 
+    {
+      size_t n = size - ofs < buf_size ? size - ofs : buf_size;
+      if (write (fd, buf, n) != (int) n)
+        fail ("write to \"%s\" failed at offset %zu", name, ofs);
+    }
+  close (fd);
+}
+
+/* Executes CHILD_CNT copies of CHILD_NAME, each with argument
+   ARGS followed by its index, storing their process IDs into
+   PIDS[]. */
+void
+exec_perf_children (const char *child_name, const char *args,
+                    pid_t pids[], size_t child_cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < child_cnt; i++) 
+    {
+      char cmd_line[128];
+      snprintf (cmd_line, sizeof cmd_line, "%s %s %zu",
+                child_name, args, i);
+      if ((pids[i] = exec (cmd_line)) == PID_ERROR)
+        fail ("exec \"%s\" failed", cmd_line);
+    }
+}
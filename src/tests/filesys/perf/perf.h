@@ -0,0 +1,22 @@
+#ifndef TESTS_FILESYS_PERF_PERF_H
+#define TESTS_FILESYS_PERF_PERF_H
+
+#include <stddef.h>
+#include <syscall.h>
+
+/* A measurement in progress. */
+struct perf 
+  {
+    const char *bench;          /* Benchmark name. */
+    struct fs_stats start;      /* Statistics when measurement began. */
+  };
+
+void perf_begin (struct perf *, const char *bench);
+void perf_end (struct perf *, const char *params, long ops, long long bytes);
+
+void *xmalloc (size_t);
+void make_file (const char *name, size_t size, char *buf, size_t buf_size);
+void exec_perf_children (const char *child_name, const char *args,
+                         pid_t pids[], size_t child_cnt);
+
+#endif /* tests/filesys/perf/perf.h */
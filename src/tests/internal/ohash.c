@@ -0,0 +1,158 @@
+/* Test program and benchmark for lib/kernel/ohash.c.
+
+   Checks the open-addressing hash table against a simple model
+   under a random mix of insertions, deletions and lookups, then
+   times lookups of sector-number keys in it and in the chained
+   hash table from lib/kernel/hash.c.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Number of distinct keys used by the random test. */
+#define KEY_CNT 1024
+
+/* Number of random operations in the random test. */
+#define OP_CNT 100000
+
+/* Number of elements and lookup passes in the benchmark. */
+#define BENCH_CNT 4096
+#define BENCH_PASSES 8
+
+/* An element of the chained hash table, for comparison. */
+struct value 
+  {
+    struct hash_elem elem;      /* Hash element. */
+    uint32_t key;               /* Key. */
+  };
+
+static void random_test (void);
+static void bench (size_t cnt);
+
+/* Test the open-addressing hash table. */
+void
+test (void) 
+{
+  random_test ();
+  bench (64);
+  bench (BENCH_CNT);
+  printf ("ohash: PASS\n");
+}
+
+/* Applies random operations to an ohash and checks each result
+   against an array recording which keys are present. */
+static void
+random_test (void) 
+{
+  static bool present[KEY_CNT];
+  struct ohash h;
+  size_t cnt = 0;
+  int i;
+
+  printf ("testing %d random operations...", OP_CNT);
+  ASSERT (ohash_init (&h, 0));
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      uint32_t key = random_ulong () % KEY_CNT;
+      void *value = (void *) (key + 1);
+
+      switch (random_ulong () % 3) 
+        {
+        case 0:
+          ASSERT (ohash_insert (&h, key, value) == !present[key]);
+          cnt += !present[key];
+          present[key] = true;
+          break;
+        case 1:
+          ASSERT (ohash_delete (&h, key) == (present[key] ? value : NULL));
+          cnt -= present[key];
+          present[key] = false;
+          break;
+        case 2:
+          ASSERT (ohash_find (&h, key) == (present[key] ? value : NULL));
+          break;
+        }
+      ASSERT (ohash_size (&h) == cnt);
+    }
+  ohash_destroy (&h);
+  printf (" done\n");
+}
+
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED) 
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
+
+/* Prints the average number of cycles per lookup since START,
+   for NAME, over CNT lookups. */
+static void
+report (const char *name, uint64_t start, size_t cnt) 
+{
+  uint64_t cycles = rdtsc () - start;
+  printf ("  %-8s %"PRIu64" cycles/lookup\n", name, cycles / cnt);
+}
+
+/* Times successful lookups of CNT sector-number keys in both
+   kinds of hash table.  The keys are spread out the way that
+   sectors of a file system tend to be. */
+static void
+bench (size_t cnt) 
+{
+  struct value *values = malloc (sizeof *values * cnt);
+  struct hash chained;
+  struct ohash open;
+  uint64_t start;
+  size_t i;
+  int pass;
+
+  ASSERT (values != NULL);
+  ASSERT (hash_init (&chained, value_hash, value_less, NULL));
+  ASSERT (ohash_init (&open, 0));
+  for (i = 0; i < cnt; i++) 
+    {
+      values[i].key = i * 7 + random_ulong () % 7;
+      ASSERT (hash_insert (&chained, &values[i].elem) == NULL);
+      ASSERT (ohash_insert (&open, values[i].key, &values[i]));
+    }
+
+  printf ("benchmark, %zu elements:\n", cnt);
+  start = rdtsc ();
+  for (pass = 0; pass < BENCH_PASSES; pass++)
+    for (i = 0; i < cnt; i++) 
+      {
+        struct value key;
+        key.key = values[i].key;
+        ASSERT (hash_find (&chained, &key.elem) == &values[i].elem);
+      }
+  report ("hash", start, cnt * BENCH_PASSES);
+
+  start = rdtsc ();
+  for (pass = 0; pass < BENCH_PASSES; pass++)
+    for (i = 0; i < cnt; i++)
+      ASSERT (ohash_find (&open, values[i].key) == &values[i]);
+  report ("ohash", start, cnt * BENCH_PASSES);
+
+  hash_destroy (&chained, NULL);
+  ohash_destroy (&open);
+  free (values);
+}
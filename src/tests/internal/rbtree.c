@@ -0,0 +1,263 @@
+/* Test program and benchmark for lib/kernel/rbtree.c.
+
+   Inserts and deletes elements in random order, checking after
+   each step that the tree is ordered, that it keeps the
+   red-black properties, and that searches agree with the array
+   of elements.  Then times ordered insertion into a red-black
+   tree against list_insert_ordered().
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/test.h"
+
+/* Maximum number of elements in the random test. */
+#define MAX_SIZE 64
+
+/* Number of distinct values used by the random test, small
+   enough that duplicates are common. */
+#define VALUE_CNT 16
+
+/* Number of elements inserted by the largest benchmark run. */
+#define BENCH_CNT 4096
+
+/* A tree and list element. */
+struct value 
+  {
+    struct rb_elem rb_elem;     /* Tree element. */
+    struct list_elem list_elem; /* List element. */
+    int value;                  /* Item value. */
+    int seq;                    /* Insertion sequence number. */
+  };
+
+static void random_test (void);
+static void bench (size_t cnt);
+static int verify_subtree (const struct rb_elem *);
+static void verify_order (struct rbtree *, size_t cnt);
+static void shuffle (struct value **, size_t);
+static rb_less_func value_less;
+
+/* Test the red-black tree implementation. */
+void
+test (void) 
+{
+  random_test ();
+  bench (64);
+  bench (512);
+  bench (BENCH_CNT);
+  printf ("rbtree: PASS\n");
+}
+
+/* Inserts and deletes elements of every size up to MAX_SIZE in
+   random orders, verifying the tree after each operation. */
+static void
+random_test (void) 
+{
+  static struct value values[MAX_SIZE];
+  struct value *order[MAX_SIZE];
+  size_t size;
+
+  printf ("testing various size trees:");
+  for (size = 0; size < MAX_SIZE; size++) 
+    {
+      int repeat;
+
+      printf (" %zu", size);
+      for (repeat = 0; repeat < 10; repeat++) 
+        {
+          struct rbtree tree;
+          size_t i;
+
+          rb_init (&tree, value_less, NULL);
+          for (i = 0; i < size; i++) 
+            {
+              values[i].value = random_ulong () % VALUE_CNT;
+              values[i].seq = i;
+              order[i] = &values[i];
+            }
+
+          /* Insert in array order, so that equal values must
+             come out in order of SEQ. */
+          for (i = 0; i < size; i++) 
+            {
+              rb_insert (&tree, &values[i].rb_elem);
+              verify_order (&tree, i + 1);
+            }
+
+          /* Check searches for every value, present or not. */
+          for (i = 0; i <= VALUE_CNT; i++) 
+            {
+              struct value key;
+              struct rb_elem *lb, *ub, *found;
+
+              key.value = i;
+              lb = rb_lower_bound (&tree, &key.rb_elem);
+              ub = rb_upper_bound (&tree, &key.rb_elem);
+              found = rb_find (&tree, &key.rb_elem);
+              ASSERT (lb == NULL || value_less (&key.rb_elem, lb, NULL)
+                      || rb_entry (lb, struct value, rb_elem)->value
+                         == (int) i);
+              ASSERT (lb == NULL || rb_prev (lb) == NULL
+                      || value_less (rb_prev (lb), &key.rb_elem, NULL));
+              ASSERT (ub == NULL || value_less (&key.rb_elem, ub, NULL));
+              ASSERT (ub == NULL || rb_prev (ub) == NULL
+                      || !value_less (&key.rb_elem, rb_prev (ub), NULL));
+              ASSERT (found == NULL || found == lb);
+              ASSERT ((found != NULL) == (lb != NULL && lb != ub));
+            }
+
+          /* Delete in random order. */
+          shuffle (order, size);
+          for (i = 0; i < size; i++) 
+            {
+              rb_delete (&tree, &order[i]->rb_elem);
+              verify_order (&tree, size - i - 1);
+            }
+          ASSERT (rb_empty (&tree));
+        }
+    }
+  printf (" done\n");
+}
+
+/* Verifies that TREE contains CNT elements in nondecreasing
+   order, with equal values in insertion order, whether walked
+   forward or backward, and that it obeys the red-black
+   properties. */
+static void
+verify_order (struct rbtree *tree, size_t cnt) 
+{
+  struct rb_elem *e, *prev;
+  size_t i;
+
+  ASSERT (rb_size (tree) == cnt);
+  ASSERT (rb_empty (tree) == (cnt == 0));
+  ASSERT (tree->root == NULL || tree->root->parent == NULL);
+  ASSERT (!(tree->root != NULL && tree->root->red));
+  verify_subtree (tree->root);
+
+  prev = NULL;
+  i = 0;
+  for (e = rb_min (tree); e != NULL; e = rb_next (e)) 
+    {
+      if (prev != NULL) 
+        {
+          struct value *a = rb_entry (prev, struct value, rb_elem);
+          struct value *b = rb_entry (e, struct value, rb_elem);
+          ASSERT (a->value < b->value
+                  || (a->value == b->value && a->seq < b->seq));
+        }
+      ASSERT (rb_prev (e) == prev);
+      prev = e;
+      i++;
+    }
+  ASSERT (i == cnt);
+  ASSERT (rb_max (tree) == prev);
+}
+
+/* Verifies the parent links and red-black properties of the
+   subtree rooted at E and returns its black height. */
+static int
+verify_subtree (const struct rb_elem *e) 
+{
+  int left_height, right_height;
+
+  if (e == NULL)
+    return 1;
+  ASSERT (e->left == NULL || e->left->parent == e);
+  ASSERT (e->right == NULL || e->right->parent == e);
+  ASSERT (!e->red || ((e->left == NULL || !e->left->red)
+                      && (e->right == NULL || !e->right->red)));
+
+  left_height = verify_subtree (e->left);
+  right_height = verify_subtree (e->right);
+  ASSERT (left_height == right_height);
+  return left_height + !e->red;
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct rb_elem *a_, const struct rb_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = rb_entry (a_, struct value, rb_elem);
+  const struct value *b = rb_entry (b_, struct value, rb_elem);
+  
+  return a->value < b->value;
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_list_less (const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED) 
+{
+  const struct value *a = list_entry (a_, struct value, list_elem);
+  const struct value *b = list_entry (b_, struct value, list_elem);
+  
+  return a->value < b->value;
+}
+
+/* Times inserting CNT random values into a sorted list with
+   list_insert_ordered() and into a red-black tree, then
+   removing the minimum element repeatedly, as a scheduler or
+   timer queue would. */
+static void
+bench (size_t cnt) 
+{
+  struct value *values = malloc (sizeof *values * cnt);
+  struct list list;
+  struct rbtree tree;
+  uint64_t start, list_cycles, tree_cycles;
+  size_t i;
+
+  ASSERT (values != NULL);
+  for (i = 0; i < cnt; i++)
+    values[i].value = random_ulong ();
+
+  list_init (&list);
+  start = rdtsc ();
+  for (i = 0; i < cnt; i++)
+    list_insert_ordered (&list, &values[i].list_elem, value_list_less, NULL);
+  while (!list_empty (&list))
+    list_pop_front (&list);
+  list_cycles = rdtsc () - start;
+
+  rb_init (&tree, value_less, NULL);
+  start = rdtsc ();
+  for (i = 0; i < cnt; i++)
+    rb_insert (&tree, &values[i].rb_elem);
+  while (!rb_empty (&tree))
+    rb_delete (&tree, rb_min (&tree));
+  tree_cycles = rdtsc () - start;
+
+  printf ("benchmark, %zu elements:\n", cnt);
+  printf ("  %-8s %"PRIu64" cycles/element\n", "list", list_cycles / cnt);
+  printf ("  %-8s %"PRIu64" cycles/element\n", "rbtree", tree_cycles / cnt);
+  free (values);
+}
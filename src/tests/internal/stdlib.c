@@ -1,7 +1,9 @@
-/* Test program for sorting and searching in lib/stdlib.c.
+/* Test program and benchmark for sorting and searching in
+   lib/stdlib.c.
 
    Attempts to test the sorting and searching functionality that
-   is not sufficiently tested elsewhere in Pintos.
+   is not sufficiently tested elsewhere in Pintos, then times
+   qsort() against a plain heapsort on several kinds of input.
 
    This is not a test we will run on your submitted projects.
    It is here for completeness.
@@ -9,19 +11,47 @@
 
 #undef NDEBUG
 #include <debug.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <random.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include "threads/io.h"
 #include "threads/test.h"
 
 /* Maximum number of elements in an array that we will test. */
 #define MAX_CNT 4096
 
+/* Largest element size tested, in bytes. */
+#define MAX_SIZE 12
+
+/* Number of elements sorted by the benchmark. */
+#define BENCH_CNT 4096
+
+/* Kinds of input. */
+enum pattern 
+  {
+    RANDOM,                     /* Random permutation. */
+    SORTED,                     /* Already in order. */
+    REVERSED,                   /* In reverse order. */
+    ORGAN_PIPE,                 /* Ascending, then descending. */
+    FEW_VALUES,                 /* Only a few distinct values. */
+    PATTERN_CNT
+  };
+
+static const char *pattern_names[PATTERN_CNT] = 
+  {"random", "sorted", "reversed", "organ pipe", "few values"};
+
 static void shuffle (int[], size_t);
+static void fill (int[], size_t, enum pattern);
 static int compare_ints (const void *, const void *);
+static int compare_keys (const void *, const void *);
 static void verify_order (const int[], size_t);
 static void verify_bsearch (const int[], size_t);
+static void test_patterns (void);
+static void test_sizes (void);
+static void bench (void);
 
 /* Test sorting and searching implementations. */
 void
@@ -53,9 +83,194 @@ test (void)
     }
   
   printf (" done\n");
+
+  test_patterns ();
+  test_sizes ();
+  bench ();
   printf ("stdlib: PASS\n");
 }
 
+/* Sorts arrays with each kind of input pattern and verifies
+   that the result is ordered. */
+static void
+test_patterns (void) 
+{
+  static int values[MAX_CNT];
+  enum pattern pat;
+
+  printf ("testing input patterns:");
+  for (pat = 0; pat < PATTERN_CNT; pat++) 
+    {
+      size_t cnt;
+
+      printf (" %s", pattern_names[pat]);
+      for (cnt = 0; cnt < MAX_CNT; cnt = cnt * 4 / 3 + 1) 
+        {
+          size_t i;
+
+          fill (values, cnt, pat);
+          qsort (values, cnt, sizeof *values, compare_ints);
+          for (i = 1; i < cnt; i++)
+            ASSERT (values[i - 1] <= values[i]);
+        }
+    }
+  printf (" done\n");
+}
+
+/* Sorts arrays of elements of every size up to MAX_SIZE bytes,
+   each holding a distinct key in its first byte and a copy of
+   that key in its remaining bytes, and verifies the result.
+   This exercises both byte-wise and word-wise swapping. */
+static void
+test_sizes (void) 
+{
+  static unsigned char elems[256 * MAX_SIZE];
+  size_t size;
+
+  printf ("testing element sizes:");
+  for (size = 1; size <= MAX_SIZE; size++) 
+    {
+      int keys[256];
+      size_t i, j;
+
+      printf (" %zu", size);
+      for (i = 0; i < 256; i++)
+        keys[i] = i;
+      shuffle (keys, 256);
+      for (i = 0; i < 256; i++)
+        memset (elems + i * size, keys[i], size);
+
+      qsort (elems, 256, size, compare_keys);
+      for (i = 0; i < 256; i++)
+        for (j = 0; j < size; j++)
+          ASSERT (elems[i * size + j] == i);
+    }
+  printf (" done\n");
+}
+
+/* Compares the unsigned char keys at A_ and B_. */
+static int
+compare_keys (const void *a_, const void *b_) 
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  return *a - *b;
+}
+
+/* Swaps the SIZE-byte elements at A and B a byte at a time. */
+static void
+ref_swap (unsigned char *a, unsigned char *b, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      unsigned char t = a[i];
+      a[i] = b[i];
+      b[i] = t;
+    }
+}
+
+/* "Float down" the element with 1-based index I in the heap of
+   CNT ints in ARRAY, swapping a byte at a time. */
+static void
+ref_heapify (int *array, size_t i, size_t cnt) 
+{
+  int *base = array - 1;
+
+  for (;;) 
+    {
+      size_t left = 2 * i;
+      size_t right = 2 * i + 1;
+      size_t max = i;
+      if (left <= cnt && compare_ints (&base[left], &base[max]) > 0)
+        max = left;
+      if (right <= cnt && compare_ints (&base[right], &base[max]) > 0)
+        max = right;
+      if (max == i)
+        break;
+      ref_swap ((unsigned char *) &base[i], (unsigned char *) &base[max],
+                sizeof *base);
+      i = max;
+    }
+}
+
+/* Sorts the CNT ints in ARRAY with a plain heapsort, for
+   comparison with qsort(). */
+static void
+ref_heap_sort (int *array, size_t cnt) 
+{
+  size_t i;
+
+  for (i = cnt / 2; i > 0; i--)
+    ref_heapify (array, i, cnt);
+  for (i = cnt; i > 1; i--) 
+    {
+      ref_swap ((unsigned char *) &array[0], (unsigned char *) &array[i - 1],
+                sizeof *array);
+      ref_heapify (array, 1, i - 1);
+    }
+}
+
+/* Times qsort() and the reference heapsort on BENCH_CNT ints in
+   each input pattern. */
+static void
+bench (void) 
+{
+  static int values[BENCH_CNT];
+  enum pattern pat;
+
+  printf ("benchmark, %d ints, cycles/element:\n", BENCH_CNT);
+  for (pat = 0; pat < PATTERN_CNT; pat++) 
+    {
+      uint64_t start, heap_cycles, intro_cycles;
+
+      fill (values, BENCH_CNT, pat);
+      start = rdtsc ();
+      ref_heap_sort (values, BENCH_CNT);
+      heap_cycles = rdtsc () - start;
+
+      fill (values, BENCH_CNT, pat);
+      start = rdtsc ();
+      qsort (values, BENCH_CNT, sizeof *values, compare_ints);
+      intro_cycles = rdtsc () - start;
+
+      printf ("  %-12s heapsort %6"PRIu64"  qsort %6"PRIu64"\n",
+              pattern_names[pat], heap_cycles / BENCH_CNT,
+              intro_cycles / BENCH_CNT);
+    }
+}
+
+/* Fills ARRAY with CNT values in the given PATTERN. */
+static void
+fill (int *array, size_t cnt, enum pattern pattern) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    switch (pattern) 
+      {
+      case RANDOM:
+      case SORTED:
+        array[i] = i;
+        break;
+      case REVERSED:
+        array[i] = cnt - i;
+        break;
+      case ORGAN_PIPE:
+        array[i] = i < cnt / 2 ? i : cnt - i;
+        break;
+      case FEW_VALUES:
+        array[i] = random_ulong () % 4;
+        break;
+      default:
+        NOT_REACHED ();
+      }
+  if (pattern == RANDOM)
+    shuffle (array, cnt);
+}
+
 /* Shuffles the CNT elements in ARRAY into random order. */
 static void
 shuffle (int *array, size_t cnt) 
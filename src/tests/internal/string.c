@@ -0,0 +1,212 @@
+/* Test program and microbenchmark for the block memory functions
+   in lib/string.c.
+
+   Checks memcpy(), memmove(), memset() and their non-temporal
+   variants against simple byte-at-a-time reference versions
+   across a range of sizes and alignments, then reports the
+   throughput of each, in bytes per cycle, for the block sizes
+   the kernel cares about: a disk sector and a page.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/io.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Size of the test buffers. */
+#define BUF_SIZE 8192
+
+/* Number of repetitions per benchmark measurement. */
+#define BENCH_ITERS 256
+
+static uint8_t src_buf[BUF_SIZE + 16];
+static uint8_t dst_buf[BUF_SIZE + 16];
+static uint8_t ref_buf[BUF_SIZE + 16];
+
+static void check_copy (size_t size, int src_ofs, int dst_ofs);
+static void check_set (size_t size, int dst_ofs);
+static void check_move (size_t size, int ofs, int delta);
+static void bench (size_t size);
+
+/* Test and time the block memory functions. */
+void
+test (void) 
+{
+  size_t size;
+  int i, j;
+
+  printf ("testing block sizes:");
+  for (size = 0; size <= BUF_SIZE / 2; size = size < 64 ? size + 1 : size * 2)
+    {
+      printf (" %zu", size);
+      for (i = 0; i < 4; i++)
+        {
+          check_set (size, i);
+          for (j = 0; j < 4; j++)
+            check_copy (size, i, j);
+          for (j = -9; j <= 9; j++)
+            check_move (size, i, j);
+        }
+    }
+  printf (" done\n");
+
+  bench (BLOCK_SECTOR_SIZE);
+  bench (PGSIZE);
+  printf ("string: PASS\n");
+}
+
+/* Byte-at-a-time reference versions, as lib/string.c used to
+   implement them. */
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+static void *
+byte_memset (void *dst_, int value, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+/* Fills BUF_SIZE bytes at BUF with random data. */
+static void
+randomize (uint8_t *buf) 
+{
+  size_t i;
+
+  for (i = 0; i < BUF_SIZE; i++)
+    buf[i] = random_ulong ();
+}
+
+/* Checks that memcpy() and memcpy_nt() copy SIZE bytes between
+   the given offsets and touch nothing else. */
+static void
+check_copy (size_t size, int src_ofs, int dst_ofs) 
+{
+  randomize (src_buf);
+  randomize (dst_buf);
+  byte_memcpy (ref_buf, dst_buf, BUF_SIZE);
+
+  byte_memcpy (ref_buf + dst_ofs, src_buf + src_ofs, size);
+  ASSERT (memcpy (dst_buf + dst_ofs, src_buf + src_ofs, size)
+          == dst_buf + dst_ofs);
+  ASSERT (!memcmp (dst_buf, ref_buf, BUF_SIZE));
+
+  byte_memcpy (ref_buf + dst_ofs, src_buf + src_ofs + 1, size * 2);
+  ASSERT (memcpy_nt (dst_buf + dst_ofs, src_buf + src_ofs + 1, size * 2)
+          == dst_buf + dst_ofs);
+  ASSERT (!memcmp (dst_buf, ref_buf, BUF_SIZE));
+}
+
+/* Checks that memset() and memset_nt() set SIZE bytes at offset
+   DST_OFS and touch nothing else. */
+static void
+check_set (size_t size, int dst_ofs) 
+{
+  randomize (dst_buf);
+  byte_memcpy (ref_buf, dst_buf, BUF_SIZE);
+
+  byte_memset (ref_buf + dst_ofs, 0xa5, size);
+  ASSERT (memset (dst_buf + dst_ofs, 0xa5, size) == dst_buf + dst_ofs);
+  ASSERT (!memcmp (dst_buf, ref_buf, BUF_SIZE));
+
+  byte_memset (ref_buf + dst_ofs, 0, size * 2);
+  ASSERT (memset_nt (dst_buf + dst_ofs, 0, size * 2) == dst_buf + dst_ofs);
+  ASSERT (!memcmp (dst_buf, ref_buf, BUF_SIZE));
+}
+
+/* Checks that memmove() moves SIZE bytes from offset OFS to
+   offset OFS + DELTA, where the two blocks may overlap. */
+static void
+check_move (size_t size, int ofs, int delta) 
+{
+  static uint8_t tmp[BUF_SIZE];
+  uint8_t *src = dst_buf + 16 + ofs;
+
+  randomize (dst_buf);
+  byte_memcpy (ref_buf, dst_buf, BUF_SIZE);
+  byte_memcpy (tmp, src, size);
+  byte_memcpy (ref_buf + 16 + ofs + delta, tmp, size);
+
+  ASSERT (memmove (src + delta, src, size) == src + delta);
+  ASSERT (!memcmp (dst_buf, ref_buf, BUF_SIZE));
+}
+
+/* Function that copies or sets a block. */
+typedef void *bench_func (void *dst, const void *src, size_t size);
+
+static void *bench_byte_memset (void *dst, const void *src, size_t size);
+static void *bench_memset (void *dst, const void *src, size_t size);
+static void *bench_memset_nt (void *dst, const void *src, size_t size);
+
+/* Runs FUNC on SIZE-byte blocks BENCH_ITERS times and prints its
+   throughput, labeled NAME. */
+static void
+bench_one (const char *name, bench_func *func, size_t size) 
+{
+  uint64_t start, cycles, bytes_per_kcycle;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < BENCH_ITERS; i++)
+    func (dst_buf, src_buf, size);
+  cycles = rdtsc () - start;
+  if (cycles == 0)
+    cycles = 1;
+
+  bytes_per_kcycle = (uint64_t) size * BENCH_ITERS * 1000 / cycles;
+  printf ("  %-12s %5zu bytes: %4"PRIu64".%03"PRIu64" bytes/cycle\n",
+          name, size, bytes_per_kcycle / 1000, bytes_per_kcycle % 1000);
+}
+
+/* Times each implementation on SIZE-byte blocks. */
+static void
+bench (size_t size) 
+{
+  printf ("benchmark, %zu-byte blocks:\n", size);
+  bench_one ("byte memcpy", byte_memcpy, size);
+  bench_one ("memcpy", memcpy, size);
+  bench_one ("memcpy_nt", memcpy_nt, size);
+  bench_one ("memmove", memmove, size);
+  bench_one ("byte memset", bench_byte_memset, size);
+  bench_one ("memset", bench_memset, size);
+  bench_one ("memset_nt", bench_memset_nt, size);
+}
+
+static void *
+bench_byte_memset (void *dst, const void *src UNUSED, size_t size) 
+{
+  return byte_memset (dst, 0, size);
+}
+
+static void *
+bench_memset (void *dst, const void *src UNUSED, size_t size) 
+{
+  return memset (dst, 0, size);
+}
+
+static void *
+bench_memset_nt (void *dst, const void *src UNUSED, size_t size) 
+{
+  return memset_nt (dst, 0, size);
+}
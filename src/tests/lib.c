@@ -159,6 +159,20 @@ check_file (const char *file_name, const void *buf, size_t size)
   close (fd);
 }
 
+/* Creates a file named FILE_NAME and writes the SIZE bytes in
+   BUF to it.  Returns a file descriptor for the new file, which
+   is left open just past the data written. */
+int
+create_file (const char *file_name, const void *buf, size_t size) 
+{
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, size) == (int) size, "write \"%s\"", file_name);
+  return fd;
+}
+
 void
 compare_bytes (const void *read_data_, const void *expected_data_, size_t size,
                size_t ofs, const char *file_name) 
@@ -43,6 +43,7 @@ void wait_children (pid_t pids[], size_t child_cnt);
 void check_file_handle (int fd, const char *file_name,
                         const void *buf_, size_t filesize);
 void check_file (const char *file_name, const void *buf, size_t filesize);
+int create_file (const char *file_name, const void *buf, size_t size);
 
 void compare_bytes (const void *read_data, const void *expected_data,
                     size_t size, size_t ofs, const char *file_name);
@@ -0,0 +1,19 @@
+/* Child process run by futex test.
+
+   Maps the parent's shared memory segment and increments its
+   counter under its lock, concurrently with the parent. */
+
+#include "tests/userprog/futex.inc"
+#include "tests/lib.h"
+
+const char *test_name = "child-futex";
+
+int
+main (void) 
+{
+  struct shared *s = shm_map (SHM_KEY, 0);
+  if (s == NULL)
+    fail ("map segment failed");
+  increment (s);
+  return 0;
+}
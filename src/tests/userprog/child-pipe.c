@@ -0,0 +1,30 @@
+/* Child process run by pipe test.
+
+   Writes several pages of data to the pipe whose write end it
+   inherited as the file descriptor passed as the first
+   command-line argument. */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define DATA_SIZE (3 * 4096 + 100)
+
+const char *test_name = "child-pipe";
+
+static char buf[DATA_SIZE];
+
+int
+main (int argc UNUSED, char *argv[]) 
+{
+  size_t i;
+
+  if (!isdigit (*argv[1]))
+    fail ("bad command-line arguments");
+  for (i = 0; i < DATA_SIZE; i++)
+    buf[i] = i % 251 + 1;
+  if (write (atoi (argv[1]), buf, DATA_SIZE) != DATA_SIZE)
+    fail ("write to pipe failed");
+  return 0;
+}
@@ -0,0 +1,33 @@
+/* Child process run by shm test.
+
+   Maps the shared memory segment whose key is passed as the
+   first command-line argument, checks that it holds the data
+   the parent wrote, and replaces it with data of its own. */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define SHM_SIZE (2 * 4096)
+
+const char *test_name = "child-shm";
+
+int
+main (int argc UNUSED, char *argv[]) 
+{
+  char *p;
+  size_t i;
+
+  if (!isdigit (*argv[1]))
+    fail ("bad command-line arguments");
+  p = shm_map (atoi (argv[1]), 0);
+  if (p == NULL)
+    fail ("map segment failed");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (p[i] != (char) (i % 251 + 1))
+      fail ("byte %zu differs from parent's", i);
+  for (i = 0; i < SHM_SIZE; i++)
+    p[i] = i % 241 + 2;
+  return 0;
+}
@@ -0,0 +1,43 @@
+/* Stores a file compressed, checks that its contents and its
+   compression flag survive closing and reopening it and
+   shrinking it, and that the flag can only be changed while the
+   file is empty. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  static const char text[] = "the quick brown fox jumps over the lazy dog\n";
+  size_t i;
+  int fd;
+
+  for (i = 0; i < FILE_SIZE; i++)
+    buf[i] = text[i % (sizeof text - 1)] + (i % 1000 == 0);
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (fcntl (fd, F_SETFL, O_COMPRESS) == 0, "set O_COMPRESS");
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE, "write \"data\"");
+  msg ("close \"data\"");
+  close (fd);
+
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (fcntl (fd, F_GETFL, 0) == O_COMPRESS, "O_COMPRESS is still set");
+  check_file_handle (fd, "data", buf, FILE_SIZE);
+
+  CHECK (ftruncate (fd, 5000), "shrink \"data\" to 5000 bytes");
+  seek (fd, 0);
+  check_file_handle (fd, "data", buf, 5000);
+
+  CHECK (fcntl (fd, F_SETFL, 0) == -1, "clear O_COMPRESS on non-empty file");
+  CHECK (ftruncate (fd, 0), "truncate \"data\"");
+  CHECK (fcntl (fd, F_SETFL, 0) == 0, "clear O_COMPRESS on empty file");
+  CHECK (fcntl (fd, F_GETFL, 0) == 0, "O_COMPRESS is clear");
+}
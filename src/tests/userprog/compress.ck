@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(compress) begin
+(compress) create "data"
+(compress) open "data"
+(compress) set O_COMPRESS
+(compress) write "data"
+(compress) close "data"
+(compress) open "data"
+(compress) O_COMPRESS is still set
+(compress) verified contents of "data"
+(compress) shrink "data" to 5000 bytes
+(compress) verified contents of "data"
+(compress) clear O_COMPRESS on non-empty file
+(compress) truncate "data"
+(compress) clear O_COMPRESS on empty file
+(compress) O_COMPRESS is clear
+(compress) end
+compress: exit(0)
+EOF
+pass;
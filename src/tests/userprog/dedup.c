@@ -0,0 +1,39 @@
+/* Writes the same data to two files, deduplicates them, and
+   checks that both keep their contents, including after each
+   is modified. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf_a, sizeof buf_a);
+  memcpy (buf_b, buf_a, sizeof buf_b);
+  close (create_file ("a", buf_a, FILE_SIZE));
+  fd = create_file ("b", buf_b, FILE_SIZE);
+
+  CHECK (dedup () > 0, "dedup merges \"b\" into \"a\"");
+  check_file ("a", buf_a, FILE_SIZE);
+  check_file ("b", buf_b, FILE_SIZE);
+
+  memset (buf_b + 100, 'b', 1000);
+  seek (fd, 100);
+  CHECK (write (fd, buf_b + 100, 1000) == 1000, "write 1000 bytes to \"b\"");
+  close (fd);
+  check_file ("a", buf_a, FILE_SIZE);
+  check_file ("b", buf_b, FILE_SIZE);
+
+  CHECK (remove ("a"), "remove \"a\"");
+  check_file ("b", buf_b, FILE_SIZE);
+}
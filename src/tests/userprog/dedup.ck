@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dedup) begin
+(dedup) create "a"
+(dedup) open "a"
+(dedup) write "a"
+(dedup) create "b"
+(dedup) open "b"
+(dedup) write "b"
+(dedup) dedup merges "b" into "a"
+(dedup) verified contents of "a"
+(dedup) verified contents of "b"
+(dedup) write 1000 bytes to "b"
+(dedup) verified contents of "a"
+(dedup) verified contents of "b"
+(dedup) remove "a"
+(dedup) verified contents of "b"
+(dedup) end
+dedup: exit(0)
+EOF
+pass;
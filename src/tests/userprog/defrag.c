@@ -0,0 +1,49 @@
+/* Grows two files in alternating small steps, so that their
+   sectors interleave on disk, then defragments one of them while
+   it is open and reads it back through the same descriptor.
+   Then defragments every file and checks both files again. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 16384
+#define STEP 512
+
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd_a, fd_b;
+  size_t ofs;
+
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write \"a\" and \"b\" in turn");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += STEP) 
+    {
+      if (write (fd_a, buf_a + ofs, STEP) != STEP)
+        fail ("write to \"a\" at offset %zu failed", ofs);
+      if (write (fd_b, buf_b + ofs, STEP) != STEP)
+        fail ("write to \"b\" at offset %zu failed", ofs);
+    }
+
+  CHECK (defrag ("a") == 1, "defrag \"a\"");
+  seek (fd_a, 0);
+  check_file_handle (fd_a, "a", buf_a, FILE_SIZE);
+  CHECK (defrag ("a") == 0, "defrag \"a\" again");
+  CHECK (defrag ("missing") == -1, "defrag \"missing\"");
+
+  CHECK (defrag (NULL) >= 0, "defrag all files");
+  check_file ("a", buf_a, FILE_SIZE);
+  check_file ("b", buf_b, FILE_SIZE);
+}
@@ -0,0 +1,49 @@
+/* Writes a file through a descriptor in direct I/O mode, with
+   sector-aligned and unaligned requests, and checks that a
+   second, cached descriptor for the same file sees every byte,
+   and the other way around.  Also checks fcntl()'s handling of
+   bad arguments. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd_direct, fd_cached;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd_direct = open ("data")) > 1, "open \"data\" for direct I/O");
+  CHECK ((fd_cached = open ("data")) > 1, "open \"data\" for cached I/O");
+  CHECK (fcntl (fd_direct, F_GETFL, 0) == 0, "flags are clear by default");
+  CHECK (fcntl (fd_direct, F_SETFL, O_DIRECT) == 0, "set O_DIRECT");
+  CHECK (fcntl (fd_direct, F_GETFL, 0) == O_DIRECT, "O_DIRECT is set");
+
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd_cached, buf, FILE_SIZE) == FILE_SIZE,
+         "write \"data\" through the cache");
+
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd_direct, buf, 100) == 100
+         && write (fd_direct, buf + 100, FILE_SIZE - 100) == FILE_SIZE - 100,
+         "overwrite \"data\" with direct I/O");
+  seek (fd_cached, 0);
+  check_file_handle (fd_cached, "data", buf, FILE_SIZE);
+
+  random_bytes (buf, sizeof buf);
+  seek (fd_cached, 0);
+  CHECK (write (fd_cached, buf, FILE_SIZE) == FILE_SIZE,
+         "overwrite \"data\" through the cache");
+  seek (fd_direct, 0);
+  check_file_handle (fd_direct, "data", buf, FILE_SIZE);
+
+  CHECK (fcntl (fd_direct, F_SETFL, 0x100) == -1, "set unknown flag");
+  CHECK (fcntl (fd_direct, 99, 0) == -1, "unknown command");
+  CHECK (fcntl (123, F_GETFL, 0) == -1, "bad file descriptor");
+}
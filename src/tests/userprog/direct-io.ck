@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(direct-io) begin
+(direct-io) create "data"
+(direct-io) open "data" for direct I/O
+(direct-io) open "data" for cached I/O
+(direct-io) flags are clear by default
+(direct-io) set O_DIRECT
+(direct-io) O_DIRECT is set
+(direct-io) write "data" through the cache
+(direct-io) overwrite "data" with direct I/O
+(direct-io) verified contents of "data"
+(direct-io) overwrite "data" through the cache
+(direct-io) verified contents of "data"
+(direct-io) set unknown flag
+(direct-io) unknown command
+(direct-io) bad file descriptor
+(direct-io) end
+direct-io: exit(0)
+EOF
+pass;
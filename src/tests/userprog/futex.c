@@ -0,0 +1,26 @@
+/* Runs a child process that, like the parent, increments a
+   counter in shared memory many times under a lock built on
+   futex_wait() and futex_wake(), and checks that no increment
+   was lost. */
+
+#include "tests/userprog/futex.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct shared *s;
+  pid_t child;
+  int status;
+
+  CHECK ((s = shm_map (SHM_KEY, sizeof *s)) != NULL, "map segment");
+  CHECK (!futex_wait (&s->lock, 1), "wait on changed value returns");
+  CHECK (futex_wake (&s->lock, 1) == 0, "wake with no waiters");
+  CHECK ((child = exec ("child-futex")) != -1, "exec child-futex");
+  increment (s);
+  status = wait (child);
+  CHECK (status == 0, "wait for child-futex");
+  CHECK (s->counter == 2 * ITERATIONS, "counter is %d", 2 * ITERATIONS);
+  CHECK (s->lock == 0, "lock is free");
+}
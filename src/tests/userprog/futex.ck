@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) map segment
+(futex) wait on changed value returns
+(futex) wake with no waiters
+(futex) exec child-futex
+child-futex: exit(0)
+(futex) wait for child-futex
+(futex) counter is 4000
+(futex) lock is free
+(futex) end
+futex: exit(0)
+EOF
+pass;
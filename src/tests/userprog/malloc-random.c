@@ -0,0 +1,108 @@
+/* Allocates, resizes, and frees blocks of random sizes in
+   random order, filling each block with a pattern and verifying
+   the pattern before the block is resized or freed, so that
+   overlapping blocks or a corrupted heap are detected. */
+
+#include <malloc.h>
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SLOT_CNT 256
+#define OP_CNT 20000
+
+/* Largest block size, spanning several pages. */
+#define MAX_SIZE 20000
+
+struct slot 
+  {
+    unsigned char *p;           /* Block, or null. */
+    size_t size;                /* Block size. */
+    unsigned char fill;         /* Fill byte. */
+  };
+
+static struct slot slots[SLOT_CNT];
+
+/* Returns a random size, usually small. */
+static size_t
+random_size (void) 
+{
+  switch (random_ulong () % 4) 
+    {
+    case 0:
+      return random_ulong () % MAX_SIZE + 1;
+    case 1:
+      return random_ulong () % 2048 + 1;
+    default:
+      return random_ulong () % 128 + 1;
+    }
+}
+
+/* Fails unless the SIZE bytes at P all equal FILL. */
+static void
+verify (const unsigned char *p, size_t size, unsigned char fill) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != fill)
+      fail ("byte %zu of %zu-byte block is %d, expected %d",
+            i, size, p[i], fill);
+}
+
+void
+test_main (void) 
+{
+  char *heap_end;
+  int i;
+
+  random_init (0);
+  msg ("perform %d random operations", OP_CNT);
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+
+      if (s->p == NULL) 
+        {
+          s->size = random_size ();
+          s->fill = random_ulong ();
+          s->p = malloc (s->size);
+          if (s->p == NULL)
+            fail ("malloc (%zu) failed", s->size);
+          memset (s->p, s->fill, s->size);
+        }
+      else if (random_ulong () % 4 == 0) 
+        {
+          size_t new_size = random_size ();
+          size_t keep = new_size < s->size ? new_size : s->size;
+
+          verify (s->p, s->size, s->fill);
+          s->p = realloc (s->p, new_size);
+          if (s->p == NULL)
+            fail ("realloc to %zu bytes failed", new_size);
+          verify (s->p, keep, s->fill);
+          s->size = new_size;
+          memset (s->p, s->fill, s->size);
+        }
+      else 
+        {
+          verify (s->p, s->size, s->fill);
+          free (s->p);
+          s->p = NULL;
+        }
+    }
+
+  msg ("free all blocks");
+  for (i = 0; i < SLOT_CNT; i++) 
+    {
+      if (slots[i].p != NULL)
+        verify (slots[i].p, slots[i].size, slots[i].fill);
+      free (slots[i].p);
+    }
+
+  heap_end = sbrk (0);
+  CHECK (calloc (1000, 4) != NULL, "calloc after freeing everything");
+  CHECK (sbrk (0) == heap_end, "heap did not grow");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-random) begin
+(malloc-random) perform 20000 random operations
+(malloc-random) free all blocks
+(malloc-random) calloc after freeing everything
+(malloc-random) heap did not grow
+(malloc-random) end
+malloc-random: exit(0)
+EOF
+pass;
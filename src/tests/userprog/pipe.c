@@ -0,0 +1,43 @@
+/* Runs a child process that writes several pages of data into a
+   pipe, and checks that the data read from the other end arrives
+   intact and is followed by end of file once the child exits.
+   Also checks that a pipe with no readers refuses writes. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DATA_SIZE (3 * 4096 + 100)
+
+static char buf[DATA_SIZE + 1];
+
+void
+test_main (void) 
+{
+  char cmd[32];
+  int fds[2];
+  size_t ofs = 0;
+  pid_t child;
+  int n;
+
+  CHECK (pipe (fds), "pipe");
+  snprintf (cmd, sizeof cmd, "child-pipe %d", fds[1]);
+  CHECK ((child = exec (cmd)) != -1, "exec child-pipe");
+  close (fds[1]);
+  while ((n = read (fds[0], buf + ofs, sizeof buf - ofs)) > 0)
+    ofs += n;
+  CHECK (n == 0 && ofs == DATA_SIZE, "read %d bytes then end of file",
+         DATA_SIZE);
+  for (ofs = 0; ofs < DATA_SIZE; ofs++)
+    if (buf[ofs] != (char) (ofs % 251 + 1))
+      fail ("byte %zu differs", ofs);
+  CHECK (wait (child) == 0, "wait for child-pipe");
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe");
+  CHECK (read (fds[1], buf, 1) == -1, "read from write end fails");
+  close (fds[0]);
+  CHECK (write (fds[1], buf, 10) == -1, "write with no reader fails");
+  close (fds[1]);
+}
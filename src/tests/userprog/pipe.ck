@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe) begin
+(pipe) pipe
+(pipe) exec child-pipe
+child-pipe: exit(0)
+(pipe) read 12388 bytes then end of file
+(pipe) wait for child-pipe
+(pipe) pipe
+(pipe) read from write end fails
+(pipe) write with no reader fails
+(pipe) end
+pipe: exit(0)
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Checks poll() and O_NONBLOCK on the ends of a pipe, the
+   console and an open file. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8192];
+
+void
+test_main (void) 
+{
+  struct pollfd pfds[3];
+  int fds[2];
+  int fd;
+
+  CHECK (pipe (fds), "pipe");
+  pfds[0].fd = fds[0];
+  pfds[0].events = POLLIN;
+  pfds[1].fd = fds[1];
+  pfds[1].events = POLLOUT;
+  pfds[2].fd = 1234;
+  pfds[2].events = POLLIN;
+  CHECK (poll (pfds, 3, 0) == 2, "poll empty pipe");
+  CHECK (pfds[0].revents == 0 && pfds[1].revents == POLLOUT
+         && pfds[2].revents == POLLNVAL,
+         "write end ready, bad descriptor invalid");
+  CHECK (poll (pfds, 1, 50) == 0, "poll read end times out");
+
+  CHECK (fcntl (fds[0], F_SETFL, O_NONBLOCK) == 0,
+         "make read end non-blocking");
+  CHECK (fcntl (fds[0], F_GETFL, 0) == O_NONBLOCK, "flags are O_NONBLOCK");
+  CHECK (read (fds[0], buf, 10) == -1, "read empty pipe fails");
+  CHECK (write (fds[1], "abc", 3) == 3, "write 3 bytes");
+  CHECK (poll (pfds, 1, -1) == 1 && pfds[0].revents == POLLIN,
+         "read end ready");
+  CHECK (read (fds[0], buf, 10) == 3, "read 3 bytes");
+
+  CHECK (fcntl (fds[1], F_SETFL, O_NONBLOCK) == 0,
+         "make write end non-blocking");
+  CHECK (write (fds[1], buf, sizeof buf) == 4096, "fill pipe");
+  CHECK (poll (pfds + 1, 1, 0) == 0, "full pipe not writable");
+  CHECK (write (fds[1], buf, 1) == -1, "write full pipe fails");
+  close (fds[1]);
+  CHECK (poll (pfds, 1, 0) == 1 && pfds[0].revents == (POLLIN | POLLHUP),
+         "read end hung up");
+  CHECK (read (fds[0], buf, sizeof buf) == 4096, "drain pipe");
+  CHECK (read (fds[0], buf, 1) == 0, "end of file");
+  close (fds[0]);
+
+  pfds[0].fd = STDIN_FILENO;
+  pfds[1].fd = STDOUT_FILENO;
+  CHECK (poll (pfds, 2, 0) == 1 && pfds[0].revents == 0
+         && pfds[1].revents == POLLOUT, "console writable, no input");
+  CHECK (fcntl (STDIN_FILENO, F_SETFL, O_NONBLOCK) == 0,
+         "make console input non-blocking");
+  CHECK (read (STDIN_FILENO, buf, 1) == -1, "read console fails");
+
+  CHECK (create ("foo", 0), "create \"foo\"");
+  CHECK ((fd = open ("foo")) > 1, "open \"foo\"");
+  pfds[0].fd = fd;
+  pfds[0].events = POLLIN | POLLOUT;
+  CHECK (poll (pfds, 1, -1) == 1 && pfds[0].revents == (POLLIN | POLLOUT),
+         "file ready");
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(poll) begin
+(poll) pipe
+(poll) poll empty pipe
+(poll) write end ready, bad descriptor invalid
+(poll) poll read end times out
+(poll) make read end non-blocking
+(poll) flags are O_NONBLOCK
+(poll) read empty pipe fails
+(poll) write 3 bytes
+(poll) read end ready
+(poll) read 3 bytes
+(poll) make write end non-blocking
+(poll) fill pipe
+(poll) full pipe not writable
+(poll) write full pipe fails
+(poll) read end hung up
+(poll) drain pipe
+(poll) end of file
+(poll) console writable, no input
+(poll) make console input non-blocking
+(poll) read console fails
+(poll) create "foo"
+(poll) open "foo"
+(poll) file ready
+(poll) end
+poll: exit(0)
+EOF
+pass;
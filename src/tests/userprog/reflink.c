@@ -0,0 +1,52 @@
+/* Clones a file with reflink(), then writes to the clone and to
+   the original, checking that each write shows up only in the
+   file written and that bad arguments are rejected. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+
+static char orig[FILE_SIZE];
+static char copy[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (orig, sizeof orig);
+  fd = create_file ("orig", orig, FILE_SIZE);
+
+  CHECK (reflink ("orig", "copy"), "reflink \"orig\" as \"copy\"");
+  memcpy (copy, orig, FILE_SIZE);
+  check_file ("copy", copy, FILE_SIZE);
+
+  memset (copy + 1000, 'c', 3000);
+  close (fd);
+  CHECK ((fd = open ("copy")) > 1, "open \"copy\"");
+  seek (fd, 1000);
+  CHECK (write (fd, copy + 1000, 3000) == 3000,
+         "write 3000 bytes to \"copy\"");
+  close (fd);
+  check_file ("copy", copy, FILE_SIZE);
+  check_file ("orig", orig, FILE_SIZE);
+
+  memset (orig + 5000, 'o', 10);
+  CHECK ((fd = open ("orig")) > 1, "open \"orig\"");
+  seek (fd, 5000);
+  CHECK (write (fd, orig + 5000, 10) == 10, "write 10 bytes to \"orig\"");
+  close (fd);
+  check_file ("orig", orig, FILE_SIZE);
+  check_file ("copy", copy, FILE_SIZE);
+
+  CHECK (remove ("orig"), "remove \"orig\"");
+  check_file ("copy", copy, FILE_SIZE);
+
+  CHECK (!reflink ("orig", "other"), "reflink missing file");
+  CHECK (create ("other", 0), "create \"other\"");
+  CHECK (!reflink ("copy", "other"), "reflink onto existing file");
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(reflink) begin
+(reflink) create "orig"
+(reflink) open "orig"
+(reflink) write "orig"
+(reflink) reflink "orig" as "copy"
+(reflink) verified contents of "copy"
+(reflink) open "copy"
+(reflink) write 3000 bytes to "copy"
+(reflink) verified contents of "copy"
+(reflink) verified contents of "orig"
+(reflink) open "orig"
+(reflink) write 10 bytes to "orig"
+(reflink) verified contents of "orig"
+(reflink) verified contents of "copy"
+(reflink) remove "orig"
+(reflink) verified contents of "copy"
+(reflink) reflink missing file
+(reflink) create "other"
+(reflink) reflink onto existing file
+(reflink) end
+reflink: exit(0)
+EOF
+pass;
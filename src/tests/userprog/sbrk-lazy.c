@@ -0,0 +1,40 @@
+/* Grows the heap with sbrk() well beyond the amount of memory a
+   process could afford to have zeroed at once, touches a few
+   pages scattered through it, and checks that they read as
+   zeroes.  Then shrinks the heap and grows it again, checking
+   that the old contents are gone, and that the heap cannot be
+   shrunk below its start. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAP_SIZE (4 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+void
+test_main (void) 
+{
+  char *base, *p;
+  size_t ofs;
+
+  base = sbrk (0);
+  CHECK (sbrk (HEAP_SIZE) == base, "grow heap by %d bytes", HEAP_SIZE);
+  CHECK (sbrk (0) == base + HEAP_SIZE, "check new break");
+
+  msg ("touch pages");
+  for (ofs = 0; ofs < HEAP_SIZE; ofs += 64 * PAGE_SIZE) 
+    {
+      p = base + ofs + ofs / (64 * PAGE_SIZE) % PAGE_SIZE;
+      if (*p != 0)
+        fail ("heap byte at offset %zu is %d, not zero", ofs, *p);
+      *p = 'x';
+    }
+  base[HEAP_SIZE - 1] = 'x';
+
+  CHECK (sbrk (-HEAP_SIZE) == base + HEAP_SIZE, "shrink heap");
+  CHECK (sbrk (PAGE_SIZE) == base, "grow heap by one page");
+  CHECK (base[0] == 0, "check heap is zeroed again");
+  CHECK (sbrk (-2 * PAGE_SIZE) == SBRK_FAILED, "shrink below heap start");
+  CHECK (brk (base) == 0, "reset break");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-lazy) begin
+(sbrk-lazy) grow heap by 4194304 bytes
+(sbrk-lazy) check new break
+(sbrk-lazy) touch pages
+(sbrk-lazy) shrink heap
+(sbrk-lazy) grow heap by one page
+(sbrk-lazy) check heap is zeroed again
+(sbrk-lazy) shrink below heap start
+(sbrk-lazy) reset break
+(sbrk-lazy) end
+sbrk-lazy: exit(0)
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Maps a shared memory segment, runs a child process that maps
+   the same segment, checks what the parent wrote and writes data
+   of its own, and checks that the parent sees the child's
+   writes. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SHM_KEY 1234
+#define SHM_SIZE (2 * 4096)
+
+void
+test_main (void) 
+{
+  char *p;
+  size_t i;
+
+  CHECK ((p = shm_map (SHM_KEY, SHM_SIZE)) != NULL, "map segment");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu of new segment is nonzero", i);
+  for (i = 0; i < SHM_SIZE; i++)
+    p[i] = i % 251 + 1;
+  CHECK (shm_map (SHM_KEY, SHM_SIZE + 4096) == NULL,
+         "mapping more than the segment fails");
+  CHECK (wait (exec ("child-shm 1234")) == 0, "run child-shm");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (p[i] != (char) (i % 241 + 2))
+      fail ("byte %zu differs from child's", i);
+  msg ("child's writes are visible");
+  CHECK (shm_unmap (p), "unmap segment");
+  CHECK (!shm_unmap (p), "unmap again fails");
+  CHECK (shm_map (SHM_KEY, 0) == NULL, "segment is gone");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm) begin
+(shm) map segment
+(shm) mapping more than the segment fails
+(shm) run child-shm
+child-shm: exit(0)
+(shm) child's writes are visible
+(shm) unmap segment
+(shm) unmap again fails
+(shm) segment is gone
+(shm) end
+shm: exit(0)
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Writes many short lines to a file through a buffered stream,
+   then reads them back with fgets() and fread() and checks
+   them, exercising buffer refills, seeks, and switches between
+   reading and writing. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LINE_CNT 2000
+
+void
+test_main (void) 
+{
+  char line[64], expected[64];
+  FILE *f;
+  long size;
+  int i;
+
+  CHECK ((f = fopen ("lines", "w")) != NULL, "fopen \"lines\" for writing");
+  CHECK (setvbuf (f, NULL, _IOFBF, 512) == 0, "set 512-byte buffer");
+  msg ("write %d lines", LINE_CNT);
+  for (i = 0; i < LINE_CNT; i++)
+    if (fprintf (f, "line %d\n", i) < 0)
+      fail ("fprintf failed on line %d", i);
+  size = ftell (f);
+  CHECK (fclose (f) == 0, "fclose \"lines\"");
+
+  CHECK ((f = fopen ("lines", "r+")) != NULL, "fopen \"lines\" for update");
+  msg ("read back %d lines", LINE_CNT);
+  for (i = 0; i < LINE_CNT; i++) 
+    {
+      snprintf (expected, sizeof expected, "line %d\n", i);
+      if (fgets (line, sizeof line, f) == NULL)
+        fail ("fgets failed on line %d", i);
+      if (strcmp (line, expected))
+        fail ("line %d is \"%s\", expected \"%s\"", i, line, expected);
+    }
+  CHECK (fgets (line, sizeof line, f) == NULL && feof (f), "check end of file");
+  CHECK (ftell (f) == size, "check file size");
+
+  CHECK (fseek (f, 5, SEEK_SET) == 0, "seek into first line");
+  CHECK (fputc ('X', f) == 'X', "overwrite one byte");
+  CHECK (fseek (f, 0, SEEK_SET) == 0, "seek to start");
+  CHECK (fread (line, 1, 7, f) == 7 && !memcmp (line, "line X\n", 7),
+         "read back overwritten line");
+  CHECK (fclose (f) == 0, "fclose \"lines\"");
+}
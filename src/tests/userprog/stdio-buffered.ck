@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stdio-buffered) begin
+(stdio-buffered) fopen "lines" for writing
+(stdio-buffered) set 512-byte buffer
+(stdio-buffered) write 2000 lines
+(stdio-buffered) fclose "lines"
+(stdio-buffered) fopen "lines" for update
+(stdio-buffered) read back 2000 lines
+(stdio-buffered) check end of file
+(stdio-buffered) check file size
+(stdio-buffered) seek into first line
+(stdio-buffered) overwrite one byte
+(stdio-buffered) seek to start
+(stdio-buffered) read back overwritten line
+(stdio-buffered) fclose "lines"
+(stdio-buffered) end
+stdio-buffered: exit(0)
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Shrinks and grows a file with ftruncate() and truncate() and
+   preallocates part of it with fallocate(), checking that data
+   before the old end survives, that new bytes read as zeros
+   until written, and that bad arguments are rejected. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  fd = create_file ("data", buf, FILE_SIZE);
+
+  CHECK (ftruncate (fd, 1000), "shrink \"data\" to 1000 bytes");
+  seek (fd, 0);
+  check_file_handle (fd, "data", buf, 1000);
+
+  CHECK (ftruncate (fd, 3000), "grow \"data\" to 3000 bytes");
+  memset (buf + 1000, 0, FILE_SIZE - 1000);
+  seek (fd, 0);
+  check_file_handle (fd, "data", buf, 3000);
+
+  CHECK (fallocate (fd, 2000, 6000), "preallocate to 8000 bytes");
+  seek (fd, 0);
+  check_file_handle (fd, "data", buf, 8000);
+
+  memset (buf + 6000, 'x', 100);
+  seek (fd, 6000);
+  CHECK (write (fd, buf + 6000, 100) == 100, "write 100 bytes at 6000");
+  seek (fd, 0);
+  check_file_handle (fd, "data", buf, 8000);
+
+  CHECK (fallocate (fd, 0, 100), "preallocate inside \"data\"");
+  CHECK (filesize (fd) == 8000, "size is unchanged");
+
+  CHECK (truncate ("data", 0), "truncate \"data\" by name");
+  CHECK (filesize (fd) == 0, "size is 0");
+
+  CHECK (!truncate ("no-such-file", 0), "truncate missing file");
+  CHECK (!ftruncate (123, 0), "ftruncate bad file descriptor");
+  CHECK (!fallocate (fd, 0, 0), "preallocate 0 bytes");
+  CHECK (!fallocate (fd, 0, 0x7fffffff), "preallocate too much");
+}
@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(truncate) begin
+(truncate) create "data"
+(truncate) open "data"
+(truncate) write "data"
+(truncate) shrink "data" to 1000 bytes
+(truncate) verified contents of "data"
+(truncate) grow "data" to 3000 bytes
+(truncate) verified contents of "data"
+(truncate) preallocate to 8000 bytes
+(truncate) verified contents of "data"
+(truncate) write 100 bytes at 6000
+(truncate) verified contents of "data"
+(truncate) preallocate inside "data"
+(truncate) size is unchanged
+(truncate) truncate "data" by name
+(truncate) size is 0
+(truncate) truncate missing file
+(truncate) ftruncate bad file descriptor
+(truncate) preallocate 0 bytes
+(truncate) preallocate too much
+(truncate) end
+truncate: exit(0)
+EOF
+pass;
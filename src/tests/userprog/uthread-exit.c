@@ -0,0 +1,52 @@
+/* Exits the process while its other threads are blocked in the
+   kernel: in futex_wait(), reading a pipe whose only write end
+   the process itself holds, and in uthread_join().  The blocked
+   threads must give up instead of keeping the process alive,
+   and must die without returning to user code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int futex_word;
+static int fds[2];
+static uthread_t sleeper;
+
+static int
+wait_futex (void *aux UNUSED) 
+{
+  futex_wait (&futex_word, 0);
+  fail ("futex_wait returned");
+}
+
+static int
+read_pipe (void *aux UNUSED) 
+{
+  char c;
+  read (fds[0], &c, 1);
+  fail ("read returned");
+}
+
+static int
+join_sleeper (void *aux UNUSED) 
+{
+  uthread_join (sleeper);
+  fail ("uthread_join returned");
+}
+
+void
+test_main (void) 
+{
+  CHECK (pipe (fds), "pipe");
+  CHECK ((sleeper = uthread_create (wait_futex, NULL)) != UTHREAD_ERROR,
+         "create futex waiter");
+  CHECK (uthread_create (read_pipe, NULL) != UTHREAD_ERROR,
+         "create pipe reader");
+  CHECK (uthread_create (join_sleeper, NULL) != UTHREAD_ERROR,
+         "create joiner");
+
+  /* Give the threads time to block. */
+  poll (NULL, 0, 100);
+  msg ("exit");
+  exit (57);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-exit) begin
+(uthread-exit) pipe
+(uthread-exit) create futex waiter
+(uthread-exit) create pipe reader
+(uthread-exit) create joiner
+(uthread-exit) exit
+uthread-exit: exit(57)
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Runs threads in this process that allocate, fill, check and
+   free blocks of many sizes at the same time, and checks that
+   no thread's blocks were handed to another or overwritten. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define BLOCK_CNT 16
+#define ITERATIONS 500
+
+/* Allocates and frees blocks filled with the byte AUX, and
+   returns the number of times it found a block of its own
+   holding anything else. */
+static int
+allocator (void *aux) 
+{
+  char *blocks[BLOCK_CNT];
+  size_t sizes[BLOCK_CNT];
+  unsigned seed = (unsigned) aux;
+  int errors = 0;
+  int i, j;
+
+  memset (blocks, 0, sizeof blocks);
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int slot;
+
+      seed = seed * 1103515245 + 12345;
+      slot = (seed >> 16) % BLOCK_CNT;
+      if (blocks[slot] != NULL)
+        {
+          for (j = 0; (size_t) j < sizes[slot]; j++)
+            if (blocks[slot][j] != (char) (int) aux)
+              {
+                errors++;
+                break;
+              }
+          free (blocks[slot]);
+        }
+      sizes[slot] = 1 + (seed >> 8) % 3000;
+      blocks[slot] = malloc (sizes[slot]);
+      if (blocks[slot] == NULL)
+        return -1;
+      memset (blocks[slot], (int) aux, sizes[slot]);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  return errors;
+}
+
+void
+test_main (void) 
+{
+  uthread_t threads[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((threads[i] = uthread_create (allocator, (void *) (i + 1)))
+           != UTHREAD_ERROR, "create thread %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (uthread_join (threads[i]) == 0, "thread %d found its blocks intact",
+           i);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-malloc) begin
+(uthread-malloc) create thread 0
+(uthread-malloc) create thread 1
+(uthread-malloc) create thread 2
+(uthread-malloc) create thread 3
+(uthread-malloc) thread 0 found its blocks intact
+(uthread-malloc) thread 1 found its blocks intact
+(uthread-malloc) thread 2 found its blocks intact
+(uthread-malloc) thread 3 found its blocks intact
+(uthread-malloc) end
+uthread-malloc: exit(0)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Runs threads in this process that increment a shared counter
+   under the futex lock, and one that blocks reading a pipe that
+   the main thread then writes, and checks the values they pass
+   to uthread_exit() through uthread_join(). */
+
+#include "tests/userprog/futex.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 3
+
+static struct shared shared;
+static int fds[2];
+
+static int
+incrementer (void *aux) 
+{
+  increment (&shared);
+  return (int) aux;
+}
+
+static int
+reader (void *aux UNUSED) 
+{
+  char buf[16];
+  return read (fds[0], buf, sizeof buf);
+}
+
+void
+test_main (void) 
+{
+  uthread_t threads[THREAD_CNT];
+  uthread_t r;
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((threads[i] = uthread_create (incrementer, (void *) (i + 10)))
+           != UTHREAD_ERROR, "create thread %d", i);
+  increment (&shared);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (uthread_join (threads[i]) == i + 10, "join thread %d", i);
+  CHECK (shared.counter == (THREAD_CNT + 1) * ITERATIONS,
+         "counter is %d", (THREAD_CNT + 1) * ITERATIONS);
+  CHECK (uthread_join (threads[0]) == -1, "join thread 0 again fails");
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((r = uthread_create (reader, NULL)) != UTHREAD_ERROR,
+         "create reader");
+  CHECK (write (fds[1], "hello", 5) == 5, "write 5 bytes");
+  CHECK (uthread_join (r) == 5, "reader read 5 bytes");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread) begin
+(uthread) create thread 0
+(uthread) create thread 1
+(uthread) create thread 2
+(uthread) join thread 0
+(uthread) join thread 1
+(uthread) join thread 2
+(uthread) counter is 8000
+(uthread) join thread 0 again fails
+(uthread) pipe
+(uthread) create reader
+(uthread) write 5 bytes
+(uthread) reader read 5 bytes
+(uthread) end
+uthread: exit(0)
+EOF
+pass;
@@ -21,11 +21,15 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/tasklet.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -107,16 +111,21 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  tasklet_system_init ();
   timer_init ();
   kbd_init ();
   input_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  shm_init ();
+  futex_init ();
+  pipe_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  tasklet_start ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -243,6 +252,12 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-fblock"))
+        {
+          fs_block_sectors = value != NULL ? atoi (value) : 0;
+          if (fs_block_sectors < 1 || fs_block_sectors > MAX_BLOCK_SECTORS)
+            PANIC ("-fblock must be between 1 and %d", MAX_BLOCK_SECTORS);
+        }
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
@@ -315,6 +330,8 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"layout", 1, fsutil_layout},
+      {"defrag", 1, fsutil_defrag},
 #endif
       {NULL, 0, NULL},
     };
@@ -361,6 +378,8 @@ usage (void)
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  layout             Report file and free space fragmentation.\n"
+          "  defrag             Defragment files and compact free space.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -371,6 +390,7 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -fblock=SECTORS    Format with blocks of SECTORS sectors (1-8).\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
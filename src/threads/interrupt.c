@@ -6,9 +6,14 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/tasklet.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -37,6 +42,33 @@ static const char *intr_names[INTR_CNT];
    unexpected interrupt is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+/* Handler execution time histogram buckets.  Bucket 0 counts
+   handlers that took fewer than 2**INTR_HIST_SHIFT cycles; each
+   later bucket doubles the bound; the last bucket is open. */
+#define INTR_HIST_SHIFT 8
+#define INTR_HIST_BUCKETS 16
+
+/* Per-vector interrupt statistics. */
+struct intr_stats
+  {
+    unsigned int cnt;                   /* Number of invocations. */
+    uint64_t total_cycles;              /* Sum of handler execution time. */
+    uint64_t max_cycles;                /* Longest handler execution. */
+    unsigned int hist[INTR_HIST_BUCKETS]; /* Execution time histogram. */
+  };
+static struct intr_stats intr_stats[INTR_CNT];
+
+/* Interrupts-off latency tracking.  INTR_OFF_START is the
+   time-stamp counter value when interrupts were last turned off,
+   or 0 if they are on or the time is unknown.  The longest
+   window seen so far is kept so that long critical sections can
+   be tracked down, along with the caller of intr_enable() that
+   ended it, or the handler of the interrupt whose return ended
+   it. */
+static uint64_t intr_off_start;
+static uint64_t intr_off_max;
+static void *intr_off_max_where;
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
@@ -59,6 +91,8 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
+static void intr_account (uint8_t vec_no, uint64_t cycles);
+static void intr_off_end (void *where);
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -90,6 +124,9 @@ intr_enable (void)
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (old_level == INTR_OFF)
+    intr_off_end (__builtin_return_address (0));
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -110,6 +147,9 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON)
+    intr_off_start = rdtsc ();
+
   return old_level;
 }
 
@@ -345,7 +385,15 @@ void
 intr_handler (struct intr_frame *frame) 
 {
   bool external;
+  bool yield;
   intr_handler_func *handler;
+  uint64_t start = rdtsc ();
+
+  /* Interrupt gates turn interrupts off without going through
+     intr_disable(), so start an interrupts-off window here,
+     unless the interrupted code already had one open. */
+  if (intr_get_level () == INTR_OFF && intr_off_start == 0)
+    intr_off_start = start;
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
@@ -373,6 +421,7 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  intr_account (frame->vec_no, rdtsc () - start);
 
   /* Complete the processing of an external interrupt. */
   if (external) 
@@ -383,9 +432,28 @@ intr_handler (struct intr_frame *frame)
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no); 
 
-      if (yield_on_return) 
+      /* Run deferred bottom halves with interrupts on.  Another
+         interrupt may arrive meanwhile and clobber
+         yield_on_return, so sample it first. */
+      yield = yield_on_return;
+      tasklet_run_pending ();
+
+      if (yield) 
         thread_yield (); 
     }
+
+#ifdef USERPROG
+  /* A thread whose process is exiting dies instead of returning
+     to user mode. */
+  if (frame->cs == SEL_UCSEG)
+    process_check_exit ();
+#endif
+
+  /* Returning to code that had interrupts on turns them back on
+     without going through intr_enable(), so end the window here
+     and charge it to this vector's handler. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    intr_off_end ((void *) intr_handlers[frame->vec_no]);
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -406,6 +474,86 @@ unexpected_interrupt (const struct intr_frame *f)
     f->vec_no, intr_names[f->vec_no]);
 }
 
+/* Adds a CYCLES-long invocation of interrupt VEC_NO to its
+   statistics.  Handlers registered with INTR_ON may be
+   preempted, so the update is done with interrupts off.  They
+   are turned off and on directly, rather than by intr_disable()
+   and intr_set_level(), so that this bookkeeping does not show
+   up as interrupts-off windows of its own. */
+static void
+intr_account (uint8_t vec_no, uint64_t cycles)
+{
+  struct intr_stats *s = &intr_stats[vec_no];
+  enum intr_level old_level = intr_get_level ();
+  int bucket = 0;
+
+  asm volatile ("cli" : : : "memory");
+
+  while (bucket < INTR_HIST_BUCKETS - 1
+         && cycles >= (uint64_t) 1 << (INTR_HIST_SHIFT + bucket))
+    bucket++;
+
+  s->cnt++;
+  s->total_cycles += cycles;
+  if (cycles > s->max_cycles)
+    s->max_cycles = cycles;
+  s->hist[bucket]++;
+  if (old_level == INTR_ON)
+    asm volatile ("sti" : : : "memory");
+}
+
+/* Ends the current interrupts-off window, which is being closed
+   by code at WHERE, and records it if it is the longest yet.
+   Must be called with interrupts off. */
+static void
+intr_off_end (void *where)
+{
+  if (intr_off_start != 0)
+    {
+      uint64_t cycles = rdtsc () - intr_off_start;
+      if (cycles > intr_off_max)
+        {
+          intr_off_max = cycles;
+          intr_off_max_where = where;
+        }
+      intr_off_start = 0;
+    }
+}
+
+/* Prints interrupt statistics: invocation counts and handler
+   execution times for each vector that fired, and the longest
+   stretch of time spent with interrupts off. */
+void
+intr_print_stats (void)
+{
+  int vec;
+
+  for (vec = 0; vec < INTR_CNT; vec++)
+    {
+      const struct intr_stats *s = &intr_stats[vec];
+      int i;
+
+      if (s->cnt == 0)
+        continue;
+      printf ("Interrupt %#04x (%s): %u calls, "
+              "%"PRIu64" avg cycles, %"PRIu64" max cycles\n",
+              vec, intr_names[vec], s->cnt,
+              s->total_cycles / s->cnt, s->max_cycles);
+      printf ("  cycles:");
+      for (i = 0; i < INTR_HIST_BUCKETS; i++)
+        if (s->hist[i] != 0)
+          {
+            if (i < INTR_HIST_BUCKETS - 1)
+              printf (" <2^%d:%u", INTR_HIST_SHIFT + i, s->hist[i]);
+            else
+              printf (" >=2^%d:%u", INTR_HIST_SHIFT + i - 1, s->hist[i]);
+          }
+      printf ("\n");
+    }
+  printf ("Interrupts off: %"PRIu64" max cycles, ended at %p\n",
+          intr_off_max, intr_off_max_where);
+}
+
 /* Dumps interrupt frame F to the console, for debugging. */
 void
 intr_dump_frame (const struct intr_frame *f) 
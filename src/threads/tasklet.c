@@ -0,0 +1,149 @@
+#include "threads/tasklet.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Maximum number of tasklets to run on one interrupt return.
+   Anything left over is run by the tasklet thread instead, so
+   that an interrupt storm cannot starve the interrupted thread. */
+#define TASKLET_BUDGET 16
+
+/* Tasklets waiting to run.  Only accessed with interrupts off. */
+static struct list pending_list;
+
+/* Up'd to wake the tasklet thread. */
+static struct semaphore tasklet_sema;
+
+static thread_func tasklet_thread NO_RETURN;
+
+/* Initializes the tasklet system.  Must be called before
+   thread_start() enables interrupts, since intr_handler() runs
+   pending tasklets after every external interrupt. */
+void
+tasklet_system_init (void) 
+{
+  list_init (&pending_list);
+  sema_init (&tasklet_sema, 0);
+}
+
+/* Starts the tasklet thread.  Must be called after
+   thread_start() and before any device driver that uses
+   tasklets is initialized. */
+void
+tasklet_start (void) 
+{
+  thread_create ("tasklet", PRI_MAX, tasklet_thread, NULL);
+}
+
+/* Initializes tasklet T to call FUNCTION with AUX when it runs. */
+void
+tasklet_init (struct tasklet *t, tasklet_func *function, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (function != NULL);
+
+  t->pending = false;
+  t->running = false;
+  t->function = function;
+  t->aux = aux;
+}
+
+/* Queues tasklet T to run with interrupts enabled.  Scheduling a
+   tasklet that is already pending has no effect, so T runs once
+   no matter how many times it was scheduled in the meantime.
+   May be called from an external interrupt handler. */
+void
+tasklet_schedule (struct tasklet *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  if (!t->pending) 
+    {
+      t->pending = true;
+      list_push_back (&pending_list, &t->elem);
+    }
+  intr_set_level (old_level);
+}
+
+/* Removes and returns the first pending tasklet that is not
+   already running on some other thread, or returns a null
+   pointer if there is none.  Interrupts must be off. */
+static struct tasklet *
+next_tasklet (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&pending_list); e != list_end (&pending_list);
+       e = list_next (e)) 
+    {
+      struct tasklet *t = list_entry (e, struct tasklet, elem);
+      if (!t->running) 
+        {
+          list_remove (e);
+          t->pending = false;
+          return t;
+        }
+    }
+  return NULL;
+}
+
+/* Runs pending tasklets, turning interrupts on for the duration
+   of each one.  Called by intr_handler() on return from an
+   external interrupt, and by the tasklet thread.  Interrupts
+   must be off and we must not be in interrupt context.
+
+   A thread that is preempted while running a tasklet does not
+   hold up the others: whichever thread next returns from an
+   interrupt runs them.  Only a nested interrupt on the same
+   thread skips them, and a tasklet never runs on two threads at
+   once; one rescheduled meanwhile runs once the first run is
+   over. */
+void
+tasklet_run_pending (void) 
+{
+  struct thread *cur = thread_current ();
+  int budget = TASKLET_BUDGET;
+  struct tasklet *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!intr_context ());
+
+  if (cur->running_tasklets)
+    return;
+
+  cur->running_tasklets = true;
+  while ((t = next_tasklet ()) != NULL) 
+    {
+      if (budget-- == 0) 
+        {
+          /* Put it back for the tasklet thread. */
+          t->pending = true;
+          list_push_front (&pending_list, &t->elem);
+          sema_up (&tasklet_sema);
+          break;
+        }
+
+      t->running = true;
+      intr_enable ();
+      t->function (t->aux);
+      intr_disable ();
+      t->running = false;
+    }
+  cur->running_tasklets = false;
+}
+
+/* Tasklet thread.  Runs tasklets left over when an interrupt
+   return used up its budget. */
+static void
+tasklet_thread (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level;
+
+      sema_down (&tasklet_sema);
+      old_level = intr_disable ();
+      tasklet_run_pending ();
+      intr_set_level (old_level);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_TASKLET_H
+#define THREADS_TASKLET_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* A tasklet is a "bottom half": work that an external interrupt
+   handler defers so that it can run with interrupts enabled,
+   after the handler itself has returned.
+
+   An interrupt handler calls tasklet_schedule() to queue the
+   tasklet.  Pending tasklets run on return from the outermost
+   external interrupt, with interrupts on.  If a burst of
+   interrupts queues more work than can be done there, the rest
+   is handed to a dedicated kernel thread.
+
+   Tasklet functions run outside interrupt context, but on
+   whatever thread the interrupt happened to arrive on, so they
+   must not sleep.  They may call sema_up() and the like. */
+
+typedef void tasklet_func (void *aux);
+
+struct tasklet
+  {
+    struct list_elem elem;      /* Element in pending list. */
+    bool pending;               /* True while on the pending list. */
+    bool running;               /* True while its function runs. */
+    tasklet_func *function;     /* Function to call. */
+    void *aux;                  /* Auxiliary data for function. */
+  };
+
+void tasklet_system_init (void);
+void tasklet_start (void);
+void tasklet_init (struct tasklet *, tasklet_func *, void *aux);
+void tasklet_schedule (struct tasklet *);
+void tasklet_run_pending (void);
+
+#endif /* threads/tasklet.h */
@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <ohash.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -24,7 +25,6 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-#define MIN_FD 2
 #define NO_PARENT -1
 
 /* List of processes in THREAD_READY state, that is, processes
@@ -35,6 +35,12 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Table of all threads, keyed by tid, for looking up a process
+   by its pid.  Filled in from thread_start() on, since it needs
+   malloc(). */
+static struct ohash thread_table;
+static struct lock thread_table_lock;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -97,6 +103,7 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
+  lock_init (&thread_table_lock);
   list_init (&ready_list);
   list_init (&all_list);
 
@@ -112,6 +119,12 @@ thread_init (void)
 void
 thread_start (void) 
 {
+  /* Create the thread table, now that malloc() works, and enter
+     the initial thread in it. */
+  if (!ohash_init (&thread_table, 0)
+      || !ohash_insert (&thread_table, initial_thread->tid, initial_thread))
+    PANIC ("thread table allocation failed");
+
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
@@ -191,6 +204,18 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+  lock_acquire (&thread_table_lock);
+  if (!ohash_insert (&thread_table, tid, t))
+    {
+      lock_release (&thread_table_lock);
+      old_level = intr_disable ();
+      list_remove (&t->allelem);
+      intr_set_level (old_level);
+      palloc_free_page (t);
+      return TID_ERROR;
+    }
+  lock_release (&thread_table_lock);
+
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
      member cannot be observed. */
@@ -315,6 +340,10 @@ thread_exit (void)
   process_exit ();
 #endif
 
+  lock_acquire (&thread_table_lock);
+  ohash_delete (&thread_table, thread_current ()->tid);
+  lock_release (&thread_table_lock);
+
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
@@ -481,6 +510,8 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -491,15 +522,13 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-  list_push_back (&all_list, &t->allelem);
 
-  t->executable = NULL;
+  old_level = intr_disable ();
+  list_push_back (&all_list, &t->allelem);
+  intr_set_level (old_level);
 
   list_init(&t->lock_list);
 
-  list_init(&t->file_list);
-  t->fd = MIN_FD;
-
   list_init(&t->child_list);
   t->cp = NULL;
   t->parent = NO_PARENT;
@@ -621,18 +650,7 @@ uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
 bool thread_alive (int pid)
 {
-  struct list_elem *e;
-
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
-    {
-      struct thread *t = list_entry (e, struct thread, allelem);
-      if (t->tid == pid)
-	{
-	  return true;
-	}
-    }
-  return false;
+  return get_thread (pid) != NULL;
 }
 
 void release_locks (void)
@@ -652,17 +670,15 @@ void release_locks (void)
 
 struct thread * get_thread (int pid)
 {
-  struct list_elem *e;
+  struct thread *t;
 
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
+  if (pid == NO_PARENT)
     {
-      struct thread *t = list_entry (e, struct thread, allelem);
-      if (t->tid == pid)
-	{
-	  return t;
-	}
+      return NULL;
     }
-  return NULL;
+  lock_acquire (&thread_table_lock);
+  t = ohash_find (&thread_table, pid);
+  lock_release (&thread_table_lock);
+  return t;
 }
 
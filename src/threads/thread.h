@@ -93,9 +93,19 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by threads/tasklet.c. */
+    bool running_tasklets;              /* In tasklet_run_pending()? */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
-    uint32_t *pagedir;                  /* Page directory. */
+    uint32_t *pagedir;                  /* Page directory, shared by the
+                                           threads of a process. */
+    struct process *process;            /* Process, or null for a kernel
+                                           thread. */
+    struct user_thread *uthread;        /* Join record, or null for a
+                                           process's first thread. */
+    bool uthread_exited;                /* Left by process_thread_exit(). */
+    int uthread_status;                 /* Status passed to it. */
 #endif
 
     /* Owned by thread.c. */
@@ -104,19 +114,14 @@ struct thread
     // Needed to keep track of locks thread holds
     struct list lock_list;
 
-    // Needed for file system sys calls
-    struct list file_list;
-    int fd;
-
     // Needed for wait / exec sys calls
     struct list child_list;
     tid_t parent;
     // Points to child_process struct in parent's child list
     struct child_process* cp;
+    // Child being waited for in process_wait(), or null
+    struct child_process* waiting_on;
 
-    // Needed for denying writes to executables
-    struct file* executable;
-    
     //Needed for directory support
     struct dir* cur_dir;
   };
@@ -0,0 +1,130 @@
+#include "userprog/futex.h"
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Wait queues for user-space synchronization.  A user lock or
+   condition keeps its state in an int in user memory, updated
+   with atomic instructions, and calls into the kernel only to
+   sleep when the int shows contention, or to wake sleepers.
+
+   Waiters are queued by the kernel address of the int, which
+   names its physical location, so processes that map the same
+   shared memory at different user addresses still meet in the
+   same queue.  The queues are lists hashed into a fixed number
+   of buckets, all guarded by a single lock. */
+
+/* Number of wait queue buckets. */
+#define FUTEX_BUCKETS 64
+
+/* A thread sleeping in futex_block(). */
+struct futex_waiter
+  {
+    struct list_elem elem;              /* Element in bucket. */
+    const int *kaddr;                   /* Kernel address waited on. */
+    struct process *process;            /* Process of the thread. */
+    struct semaphore sema;              /* Upped to wake the thread. */
+  };
+
+static struct list buckets[FUTEX_BUCKETS];
+static struct lock futex_lock;          /* Protects `buckets'. */
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) 
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    list_init (&buckets[i]);
+  lock_init (&futex_lock);
+}
+
+/* Returns the bucket for waiters on KADDR. */
+static struct list *
+bucket_for (const int *kaddr) 
+{
+  return &buckets[hash_bytes (&kaddr, sizeof kaddr) % FUTEX_BUCKETS];
+}
+
+/* If the int at kernel address KADDR, which must be the kernel
+   mapping of a user int, still equals EXPECTED, sleeps until
+   futex_unblock() is called for KADDR, or futex_cancel() for
+   the current process, and returns true.  Otherwise, or if the
+   process is already exiting, returns false at once.  The
+   comparison and the queueing are atomic with respect to
+   futex_unblock() and futex_cancel(), so a wakeup sent after the
+   user changed the int, or after the process began to exit,
+   cannot be lost. */
+bool
+futex_block (const int *kaddr, int expected) 
+{
+  struct futex_waiter w;
+
+  lock_acquire (&futex_lock);
+  if (*kaddr != expected || process_exiting ()) 
+    {
+      lock_release (&futex_lock);
+      return false;
+    }
+  w.kaddr = kaddr;
+  w.process = thread_current ()->process;
+  sema_init (&w.sema, 0);
+  list_push_back (bucket_for (kaddr), &w.elem);
+  lock_release (&futex_lock);
+
+  sema_down (&w.sema);
+  return true;
+}
+
+/* Wakes up to CNT threads sleeping in futex_block() on KADDR,
+   in the order they went to sleep.  Returns the number woken. */
+int
+futex_unblock (const int *kaddr, int cnt) 
+{
+  struct list *bucket = bucket_for (kaddr);
+  struct list_elem *e;
+  int woken = 0;
+
+  lock_acquire (&futex_lock);
+  for (e = list_begin (bucket); e != list_end (bucket) && woken < cnt; ) 
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+      e = list_next (e);
+      if (w->kaddr == kaddr) 
+        {
+          list_remove (&w->elem);
+          sema_up (&w->sema);
+          woken++;
+        }
+    }
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Wakes every thread of process P sleeping in futex_block(),
+   because P is exiting. */
+void
+futex_cancel (struct process *p) 
+{
+  size_t i;
+
+  lock_acquire (&futex_lock);
+  for (i = 0; i < FUTEX_BUCKETS; i++) 
+    {
+      struct list_elem *e = list_begin (&buckets[i]);
+      while (e != list_end (&buckets[i])) 
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+          e = list_next (e);
+          if (w->process == p) 
+            {
+              list_remove (&w->elem);
+              sema_up (&w->sema);
+            }
+        }
+    }
+  lock_release (&futex_lock);
+}
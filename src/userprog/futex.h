@@ -0,0 +1,13 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+
+struct process;
+
+void futex_init (void);
+bool futex_block (const int *kaddr, int expected);
+int futex_unblock (const int *kaddr, int cnt);
+void futex_cancel (struct process *);
+
+#endif /* userprog/futex.h */
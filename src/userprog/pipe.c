@@ -0,0 +1,250 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+
+/* Pages in a pipe's buffer. */
+#define PIPE_PAGES 1
+
+/* Bytes in a pipe's buffer. */
+#define PIPE_SIZE (PIPE_PAGES * PGSIZE)
+
+/* A pipe: a ring buffer in kernel memory that carries a stream
+   of bytes from the processes holding its write end to those
+   holding its read end, without touching the file system.
+   Readers block while it is empty and writers while it is full.
+   The pipe is freed when its last end is closed. */
+struct pipe
+  {
+    struct lock lock;                   /* Protects the members below. */
+    struct condition not_empty;         /* Data or end of file arrived. */
+    struct condition not_full;          /* Space freed or readers gone. */
+    uint8_t *buffer;                    /* PIPE_SIZE bytes of data. */
+    size_t start;                       /* Offset of first byte. */
+    size_t used;                        /* Number of bytes in BUFFER. */
+    int readers;                        /* Open read ends. */
+    int writers;                        /* Open write ends. */
+    struct list_elem elem;              /* Element in `all_pipes'. */
+  };
+
+/* Every pipe, so that pipe_cancel_waits() can find sleepers. */
+static struct list all_pipes;
+static struct lock all_pipes_lock;      /* Protects `all_pipes'. */
+
+/* Initializes the pipe module. */
+void
+pipe_init (void) 
+{
+  list_init (&all_pipes);
+  lock_init (&all_pipes_lock);
+}
+
+/* Creates a pipe with one open read end and one open write end.
+   Returns the new pipe, or a null pointer if memory is
+   exhausted. */
+struct pipe *
+pipe_create (void) 
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buffer = palloc_get_multiple (0, PIPE_PAGES);
+  if (p->buffer == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  p->start = p->used = 0;
+  p->readers = p->writers = 1;
+  lock_acquire (&all_pipes_lock);
+  list_push_back (&all_pipes, &p->elem);
+  lock_release (&all_pipes_lock);
+  return p;
+}
+
+/* Opens another read end of P, or write end if WRITER is
+   true. */
+void
+pipe_open (struct pipe *p, bool writer) 
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITER is true.
+   Closing the last write end gives readers end of file, and
+   closing the last read end makes writes fail.  Frees P once
+   both kinds of end are closed. */
+void
+pipe_close (struct pipe *p, bool writer) 
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else 
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->not_full, &p->lock);
+    }
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead) 
+    {
+      lock_acquire (&all_pipes_lock);
+      list_remove (&p->elem);
+      lock_release (&all_pipes_lock);
+      palloc_free_multiple (p->buffer, PIPE_PAGES);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER and returns the
+   number read, which is 0 at end of file, that is, once P is
+   empty and has no write ends left.  If P is empty but still
+   has writers, waits for data if BLOCK is true, or returns -1
+   at once if BLOCK is false.  Also returns -1, instead of
+   waiting, once the current process has begun to exit.  Returns
+   as soon as some data has been read, without waiting for all
+   SIZE bytes. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size, bool block) 
+{
+  uint8_t *buffer = buffer_;
+  size_t cnt = 0;
+
+  lock_acquire (&p->lock);
+  while (p->used == 0 && p->writers > 0 && block && size > 0
+         && !process_exiting ())
+    cond_wait (&p->not_empty, &p->lock);
+  if (p->used == 0 && p->writers > 0 && size > 0)
+    {
+      lock_release (&p->lock);
+      return -1;
+    }
+  while (cnt < size && p->used > 0) 
+    {
+      size_t chunk = size - cnt;
+      if (chunk > p->used)
+        chunk = p->used;
+      if (chunk > PIPE_SIZE - p->start)
+        chunk = PIPE_SIZE - p->start;
+      memcpy (buffer + cnt, p->buffer + p->start, chunk);
+      p->start = (p->start + chunk) % PIPE_SIZE;
+      p->used -= chunk;
+      cnt += chunk;
+    }
+  if (cnt > 0)
+    cond_broadcast (&p->not_full, &p->lock);
+  lock_release (&p->lock);
+  return cnt;
+}
+
+/* Writes SIZE bytes from BUFFER into P, waiting for readers to
+   make room as necessary if BLOCK is true.  Returns the number
+   of bytes written, which is less than SIZE only if the last
+   read end is closed or, if BLOCK is false or the current
+   process has begun to exit, P filled up.  Returns -1 if
+   nothing could be written for any of these reasons. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size, bool block) 
+{
+  const uint8_t *buffer = buffer_;
+  size_t written = 0;
+
+  lock_acquire (&p->lock);
+  while (written < size && p->readers > 0) 
+    {
+      size_t end = (p->start + p->used) % PIPE_SIZE;
+      size_t chunk = size - written;
+
+      if (p->used == PIPE_SIZE) 
+        {
+          if (!block || process_exiting ())
+            break;
+          cond_wait (&p->not_full, &p->lock);
+          continue;
+        }
+      if (chunk > PIPE_SIZE - p->used)
+        chunk = PIPE_SIZE - p->used;
+      if (chunk > PIPE_SIZE - end)
+        chunk = PIPE_SIZE - end;
+      memcpy (p->buffer + end, buffer + written, chunk);
+      p->used += chunk;
+      written += chunk;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  lock_release (&p->lock);
+  return written == 0 && size > 0 ? -1 : (int) written;
+}
+
+/* Returns true if reading from P, or writing to it if WRITER is
+   true, would not have to wait.  That includes reaching end of
+   file and failing for lack of readers. */
+bool
+pipe_ready (struct pipe *p, bool writer) 
+{
+  bool ready;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    ready = p->used < PIPE_SIZE || p->readers == 0;
+  else
+    ready = p->used > 0 || p->writers == 0;
+  lock_release (&p->lock);
+  return ready;
+}
+
+/* Returns true if every end of P opposite to the kind given by
+   WRITER has been closed. */
+bool
+pipe_hung_up (struct pipe *p, bool writer) 
+{
+  bool hung_up;
+
+  lock_acquire (&p->lock);
+  hung_up = (writer ? p->readers : p->writers) == 0;
+  lock_release (&p->lock);
+  return hung_up;
+}
+
+/* Wakes every thread sleeping in pipe_read() or pipe_write(),
+   so that those of a process that has begun to exit can give
+   up.  The others go back to sleep. */
+void
+pipe_cancel_waits (void) 
+{
+  struct list_elem *e;
+
+  lock_acquire (&all_pipes_lock);
+  for (e = list_begin (&all_pipes); e != list_end (&all_pipes);
+       e = list_next (e)) 
+    {
+      struct pipe *p = list_entry (e, struct pipe, elem);
+      lock_acquire (&p->lock);
+      cond_broadcast (&p->not_empty, &p->lock);
+      cond_broadcast (&p->not_full, &p->lock);
+      lock_release (&p->lock);
+    }
+  lock_release (&all_pipes_lock);
+}
@@ -0,0 +1,19 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipe;
+
+void pipe_init (void);
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *, size_t size, bool block);
+int pipe_write (struct pipe *, const void *, size_t size, bool block);
+bool pipe_ready (struct pipe *, bool writer);
+bool pipe_hung_up (struct pipe *, bool writer);
+void pipe_cancel_waits (void);
+
+#endif /* userprog/pipe.h */
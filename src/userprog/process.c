@@ -5,8 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "devices/input.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -20,7 +24,30 @@
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
 
+/* Bytes below PHYS_BASE that the heap may not grow into, kept
+   free for the stack.  Its lower half holds shared memory
+   segments (see shm.c). */
+#define HEAP_STACK_GAP (8 * 1024 * 1024)
+
+/* The stacks of threads created by process_thread_create() lie
+   in the upper half of the gap, below the first thread's
+   one-page stack.  Each has UTHREAD_STACK_PAGES pages, with an
+   unmapped guard page below, and the first is also kept apart
+   from the first thread's stack by a guard page above. */
+#define UTHREAD_STACK_PAGES 2
+#define UTHREAD_STACK_TOP ((uint8_t *) PHYS_BASE - 2 * PGSIZE)
+#define UTHREAD_STACK_BOTTOM ((uint8_t *) PHYS_BASE - HEAP_STACK_GAP / 2)
+
+/* Lowest file descriptor handed out for files and pipes. */
+#define MIN_FD 2
+
 static thread_func start_process NO_RETURN;
+static thread_func start_user_thread NO_RETURN;
+static struct process *process_create (void);
+static void inherit_pipes (struct thread *parent);
+static bool range_pinned (struct process *, const uint8_t *start,
+                          const uint8_t *end);
+static void wake_child_waits (struct thread *, void *process);
 static bool load (const char *cmdline, void (**eip) (void), void **esp,
 		  char** save_ptr);
 
@@ -69,7 +96,19 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp, &save_ptr);
+  thread_current()->process = process_create();
+  if (thread_current()->process == NULL)
+    {
+      success = false;
+    }
+  else
+    {
+      if (thread_alive(thread_current()->parent))
+	{
+	  inherit_pipes(get_thread(thread_current()->parent));
+	}
+      success = load (file_name, &if_.eip, &if_.esp, &save_ptr);
+    }
   if (success)
     {
       thread_current()->cp->load = LOAD_SUCCESS;
@@ -127,38 +166,157 @@ process_wait (tid_t child_tid UNUSED)
   cp->wait = true;
   if (!cp->exit)
     {
-      sema_down(&cp->exit_sema);
+      /* Give up if the process begins to exit meanwhile; then
+	 the child's record is freed with ours. */
+      thread_current()->waiting_on = cp;
+      barrier();
+      if (!process_exiting())
+	{
+	  sema_down(&cp->exit_sema);
+	}
+      thread_current()->waiting_on = NULL;
+      if (!cp->exit)
+	{
+	  return ERROR;
+	}
     }
   int status = cp->status;
   remove_child_process(cp);
   return status;
 }
 
-/* Free the current process's resources. */
+/* Creates the state of a new process, with one thread, the
+   current one.  Returns a null pointer if memory is exhausted. */
+static struct process *
+process_create (void)
+{
+  struct thread *t = thread_current ();
+  struct process *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  lock_init (&p->lock);
+  p->pagedir = NULL;
+  p->thread_cnt = 1;
+  p->exiting = false;
+  p->exit_status = ERROR;
+  p->parent = t->parent;
+  p->cp = t->cp;
+  p->executable = NULL;
+  p->heap_start = p->heap_brk = NULL;
+  list_init (&p->file_list);
+  p->fd = MIN_FD;
+  p->console_nonblock[0] = p->console_nonblock[1] = false;
+  list_init (&p->shm_list);
+  list_init (&p->uthreads);
+  list_init (&p->pins);
+  cond_init (&p->unpinned);
+  return p;
+}
+
+/* Frees the current thread's resources.  If it is the last
+   thread of its process, frees the process's resources too.  */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct process *p = cur->process;
   uint32_t *pd;
+  bool last, report;
+
+  // Free child list
+  remove_child_processes();
+
+  if (p == NULL)
+    {
+      return;
+    }
+
+  /* Give back this thread's stack, once no other thread's system
+     call is using it, then leave the process.  A thread that is
+     not the last drops the page directory while holding the
+     process lock, so that the last thread cannot destroy it
+     while it is still in use. */
+  process_unpin_all ();
+  if (cur->uthread != NULL)
+    {
+      uint8_t *upage;
+      lock_acquire (&p->lock);
+      process_wait_unpinned (p, cur->uthread->stack,
+			     UTHREAD_STACK_PAGES * PGSIZE);
+      for (upage = cur->uthread->stack;
+	   upage < cur->uthread->stack + UTHREAD_STACK_PAGES * PGSIZE;
+	   upage += PGSIZE)
+	{
+	  void *kpage = pagedir_get_page (p->pagedir, upage);
+	  pagedir_clear_page (p->pagedir, upage);
+	  palloc_free_page (kpage);
+	}
+      lock_release (&p->lock);
+    }
+  lock_acquire (&p->lock);
+  last = --p->thread_cnt == 0;
+  if (!last)
+    {
+      cur->pagedir = NULL;
+      pagedir_activate (NULL);
+    }
+  if (cur->uthread != NULL)
+    {
+      sema_up (&cur->uthread->dead);
+    }
+
+  /* Whichever thread takes the count to zero decides how the
+     process ends.  If it left by uthread_exit() and nobody
+     called exit(), the process exits with its status as if it
+     had called exit() instead. */
+  report = last && cur->uthread_exited && !p->exiting;
+  if (report)
+    {
+      p->exiting = true;
+      p->exit_status = cur->uthread_status;
+    }
+  lock_release (&p->lock);
+  if (!last)
+    {
+      cur->process = NULL;
+      return;
+    }
+  if (report)
+    {
+      printf ("%s: exit(%d)\n", cur->name, p->exit_status);
+    }
 
   // Close all files opened by process
   lock_acquire(&filesys_lock);
   process_close_file(CLOSE_ALL);
-  if (cur->executable)
+  if (p->executable)
     {
-      file_close(cur->executable);
+      file_close(p->executable);
     }
   lock_release(&filesys_lock);
 
-  // Free child list
-  remove_child_processes();
+  // Unmap shared memory before the page directory frees its pages
+  if (p->pagedir != NULL)
+    {
+      shm_detach_all();
+    }
 
   // Set exit value to true in case killed by the kernel
-  if (thread_alive(cur->parent) && cur->cp && cur->executable)
+  if (thread_alive(p->parent) && p->cp && p->executable)
+    {
+      p->cp->status = p->exit_status;
+      p->cp->exit = true;
+      sema_up(&p->cp->exit_sema);
+    }
+
+  // Free records of threads never joined
+  while (!list_empty (&p->uthreads))
     {
-      cur->cp->exit = true;
-      sema_up(&cur->cp->exit_sema);
+      free (list_entry (list_pop_front (&p->uthreads),
+			struct user_thread, elem));
     }
+  cur->process = NULL;
+  free (p);
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -280,11 +438,12 @@ load (const char *file_name, void (**eip) (void), void **esp,
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
   off_t file_ofs;
+  uint32_t load_end = 0;
   bool success = false;
   int i;
 
   /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
+  t->pagedir = t->process->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
@@ -298,7 +457,7 @@ load (const char *file_name, void (**eip) (void), void **esp,
       goto done; 
     }
   file_deny_write(file);
-  t->executable = file;
+  t->process->executable = file;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -365,6 +524,8 @@ load (const char *file_name, void (**eip) (void), void **esp,
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+              if (mem_page + read_bytes + zero_bytes > load_end)
+                load_end = mem_page + read_bytes + zero_bytes;
             }
           else
             goto done;
@@ -372,6 +533,9 @@ load (const char *file_name, void (**eip) (void), void **esp,
         }
     }
 
+  /* The heap starts out empty, just past the highest segment. */
+  t->process->heap_start = t->process->heap_brk = (uint8_t *) load_end;
+
   /* Set up stack. */
   if (!setup_stack (esp, file_name, save_ptr))
     goto done;
@@ -594,6 +758,145 @@ install_page (void *upage, void *kpage, bool writable)
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
 
+/* Moves the current process's break by INCREMENT bytes and
+   returns the old break, or a null pointer if the new break
+   would fall below the start of the heap or into the stack's
+   reserved region.
+
+   Growing the heap only moves the break: pages are allocated
+   and zeroed one at a time by process_heap_fault() when first
+   touched.  Shrinking it frees any pages lying wholly above the
+   new break, so that growing it again yields zeroed memory,
+   first waiting for system calls of other threads that use those
+   pages to finish. */
+void *
+process_sbrk (intptr_t increment) 
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *old_brk, *new_brk;
+  uint8_t *upage;
+
+  lock_acquire (&p->lock);
+  for (;;)
+    {
+      old_brk = p->heap_brk;
+      new_brk = old_brk + increment;
+      if ((increment < 0 ? new_brk > old_brk : new_brk < old_brk)
+          || new_brk < p->heap_start
+          || new_brk > (uint8_t *) PHYS_BASE - HEAP_STACK_GAP)
+        {
+          lock_release (&p->lock);
+          return NULL;
+        }
+
+      /* Wait until no system call is using the pages to free.
+         The break may move meanwhile, so start over after. */
+      if (increment >= 0
+          || !range_pinned (p, pg_round_up (new_brk),
+                            pg_round_up (old_brk)))
+        break;
+      cond_wait (&p->unpinned, &p->lock);
+    }
+
+  for (upage = pg_round_up (new_brk); upage < old_brk; upage += PGSIZE) 
+    {
+      void *kpage = pagedir_get_page (p->pagedir, upage);
+      if (kpage != NULL) 
+        {
+          pagedir_clear_page (p->pagedir, upage);
+          palloc_free_page (kpage);
+        }
+    }
+  p->heap_brk = new_brk;
+  lock_release (&p->lock);
+  return old_brk;
+}
+
+/* Handles a not-present fault at user address UADDR in the
+   current process.  If UADDR lies in the heap, maps a fresh
+   zeroed page there and returns true; otherwise, or if memory is
+   exhausted, returns false and leaves the fault to be handled as
+   an error. */
+bool
+process_heap_fault (const void *uaddr) 
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *upage = pg_round_down (uaddr);
+  void *kpage;
+  bool success = false;
+
+  if (p == NULL || p->pagedir == NULL)
+    return false;
+
+  /* Another thread of the process may have brought in the page
+     first. */
+  lock_acquire (&p->lock);
+  if ((const uint8_t *) uaddr >= p->heap_start
+      && (const uint8_t *) uaddr < p->heap_brk)
+    {
+      if (pagedir_get_page (p->pagedir, upage) != NULL)
+        success = true;
+      else
+        {
+          kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+          if (kpage != NULL && install_page (upage, kpage, true))
+            success = true;
+          else if (kpage != NULL)
+            palloc_free_page (kpage);
+        }
+    }
+  lock_release (&p->lock);
+  return success;
+}
+
+
+/* Adds PF to the current process's descriptors under the next
+   free descriptor, which it returns. */
+static int add_fd (struct process_file *pf)
+{
+  struct process *p = thread_current()->process;
+  lock_acquire(&p->lock);
+  pf->fd = p->fd++;
+  list_push_back(&p->file_list, &pf->elem);
+  lock_release(&p->lock);
+  return pf->fd;
+}
+
+/* Returns process P's descriptor FD, or a null pointer if FD is
+   not open.  P's lock must be held.  The console descriptors
+   STDIN_FILENO and STDOUT_FILENO are open here only while
+   redirected by process_dup2(). */
+static struct process_file* lookup_fd (struct process *p, int fd)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&p->file_list); e != list_end (&p->file_list);
+       e = list_next (e))
+        {
+          struct process_file *pf = list_entry (e, struct process_file, elem);
+          if (fd == pf->fd)
+	    {
+	      return pf;
+	    }
+        }
+  return NULL;
+}
+
+/* Closes descriptor PF of process P and frees it.  P's lock
+   must be held, as must filesys_lock if PF is a file. */
+static void close_fd (struct process_file *pf)
+{
+  if (pf->pipe)
+    {
+      pipe_close(pf->pipe, pf->pipe_writer);
+    }
+  else
+    {
+      file_close(pf->file);
+    }
+  list_remove(&pf->elem);
+  free(pf);
+}
 
 int process_add_file (struct file *f)
 {
@@ -603,51 +906,626 @@ int process_add_file (struct file *f)
       return ERROR;
     }
   pf->file = f;
-  pf->fd = thread_current()->fd;
-  thread_current()->fd++;
-  list_push_back(&thread_current()->file_list, &pf->elem);
-  return pf->fd;
+  pf->pipe = NULL;
+  pf->pipe_writer = false;
+  pf->nonblock = false;
+  return add_fd(pf);
 }
 
+/* Adds an end of pipe P, the write end if WRITER is true, to
+   the current process's file descriptors, taking over the
+   caller's reference to it.  Returns the new descriptor, or
+   ERROR if memory is exhausted. */
+int process_add_pipe (struct pipe *p, bool writer)
+{
+  struct process_file *pf = malloc(sizeof(struct process_file));
+  if (!pf)
+    {
+      return ERROR;
+    }
+  pf->file = NULL;
+  pf->pipe = p;
+  pf->pipe_writer = writer;
+  pf->nonblock = false;
+  return add_fd(pf);
+}
+
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not an open file.  The caller must hold
+   filesys_lock, which keeps other threads from closing it. */
 struct file* process_get_file (int fd)
 {
-  struct thread *t = thread_current();
+  struct process *p = thread_current()->process;
+  struct process_file *pf;
+
+  lock_acquire(&p->lock);
+  pf = lookup_fd(p, fd);
+  lock_release(&p->lock);
+  return pf ? pf->file : NULL;
+}
+
+/* If FD is a pipe end in the current process, returns the pipe
+   with a new reference to the same end, which the caller must
+   drop with pipe_close(), and sets *WRITER to whether it is the
+   write end.  The reference keeps the pipe alive even if
+   another thread closes FD meanwhile.  Returns a null pointer if
+   FD is not a pipe end. */
+struct pipe *process_get_pipe (int fd, bool *writer)
+{
+  struct process *p = thread_current()->process;
+  struct process_file *pf;
+  struct pipe *pipe = NULL;
+
+  lock_acquire(&p->lock);
+  pf = lookup_fd(p, fd);
+  if (pf && pf->pipe)
+    {
+      pipe = pf->pipe;
+      *writer = pf->pipe_writer;
+      pipe_open(pipe, *writer);
+    }
+  lock_release(&p->lock);
+  return pipe;
+}
+
+/* Makes NEW_FD refer to the same pipe end as OLD_FD, first
+   closing NEW_FD if it is open.  Redirecting STDIN_FILENO or
+   STDOUT_FILENO this way takes the console's place until the
+   descriptor is closed.  Only pipe ends can be duplicated, since
+   open files have a position of their own.  Returns NEW_FD, or
+   ERROR on failure.  The caller must hold filesys_lock. */
+int process_dup2 (int old_fd, int new_fd)
+{
+  struct process *p = thread_current()->process;
+  struct process_file *old, *pf;
+  int result = ERROR;
+
+  pf = malloc(sizeof(struct process_file));
+  if (!pf)
+    {
+      return ERROR;
+    }
+  lock_acquire(&p->lock);
+  old = lookup_fd(p, old_fd);
+  if (old && old->pipe && new_fd >= 0)
+    {
+      result = new_fd;
+      if (old_fd != new_fd)
+	{
+	  struct process_file *victim = lookup_fd(p, new_fd);
+	  if (victim)
+	    {
+	      close_fd(victim);
+	    }
+	  pipe_open(old->pipe, old->pipe_writer);
+	  pf->file = NULL;
+	  pf->pipe = old->pipe;
+	  pf->pipe_writer = old->pipe_writer;
+	  pf->nonblock = old->nonblock;
+	  pf->fd = new_fd;
+	  if (new_fd >= p->fd)
+	    {
+	      p->fd = new_fd + 1;
+	    }
+	  list_push_back(&p->file_list, &pf->elem);
+	  pf = NULL;
+	}
+    }
+  lock_release(&p->lock);
+  free(pf);
+  return result;
+}
+
+/* Sets *NONBLOCK to whether descriptor FD of the current
+   process has O_NONBLOCK set.  Returns false if FD is not open.
+   The console descriptors count as open unless redirected. */
+bool process_get_nonblock (int fd, bool *nonblock)
+{
+  struct process *p = thread_current()->process;
+  struct process_file *pf;
+  bool open = true;
+
+  lock_acquire(&p->lock);
+  pf = lookup_fd(p, fd);
+  if (pf)
+    {
+      *nonblock = pf->nonblock;
+    }
+  else if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+    {
+      *nonblock = p->console_nonblock[fd];
+    }
+  else
+    {
+      open = false;
+    }
+  lock_release(&p->lock);
+  return open;
+}
+
+/* Sets or clears O_NONBLOCK on descriptor FD of the current
+   process.  Returns false if FD is not open. */
+bool process_set_nonblock (int fd, bool nonblock)
+{
+  struct process *p = thread_current()->process;
+  struct process_file *pf;
+  bool open = true;
+
+  lock_acquire(&p->lock);
+  pf = lookup_fd(p, fd);
+  if (pf)
+    {
+      pf->nonblock = nonblock;
+    }
+  else if (fd == STDIN_FILENO || fd == STDOUT_FILENO)
+    {
+      p->console_nonblock[fd] = nonblock;
+    }
+  else
+    {
+      open = false;
+    }
+  lock_release(&p->lock);
+  return open;
+}
+
+/* Gives the current process, which is starting up, its own
+   references to the pipe ends that PARENT's process has open,
+   under the same descriptors.  Open files are not inherited. */
+static void inherit_pipes (struct thread *parent)
+{
+  struct process *p = thread_current()->process;
+  struct process *pp = parent->process;
   struct list_elem *e;
 
-  for (e = list_begin (&t->file_list); e != list_end (&t->file_list);
+  if (!pp)
+    {
+      return;
+    }
+  lock_acquire(&pp->lock);
+  for (e = list_begin (&pp->file_list); e != list_end (&pp->file_list);
        e = list_next (e))
         {
-          struct process_file *pf = list_entry (e, struct process_file, elem);
-          if (fd == pf->fd)
+          struct process_file *ppf = list_entry (e, struct process_file,
+						 elem);
+          struct process_file *pf;
+          if (!ppf->pipe)
 	    {
-	      return pf->file;
+	      continue;
 	    }
+          pf = malloc(sizeof(struct process_file));
+          if (!pf)
+	    {
+	      break;
+	    }
+          pipe_open(ppf->pipe, ppf->pipe_writer);
+          *pf = *ppf;
+          if (pf->fd >= p->fd)
+	    {
+	      p->fd = pf->fd + 1;
+	    }
+          list_push_back(&p->file_list, &pf->elem);
         }
-  return NULL;
+  lock_release(&pp->lock);
 }
 
+/* Closes FD in the current process, or every descriptor if FD
+   is CLOSE_ALL.  The caller must hold filesys_lock. */
 void process_close_file (int fd)
 {
-  struct thread *t = thread_current();
-  struct list_elem *next, *e = list_begin(&t->file_list);
+  struct process *p = thread_current()->process;
+  struct list_elem *next, *e;
 
-  while (e != list_end (&t->file_list))
+  lock_acquire(&p->lock);
+  for (e = list_begin(&p->file_list); e != list_end (&p->file_list);
+       e = next)
     {
       next = list_next(e);
       struct process_file *pf = list_entry (e, struct process_file, elem);
       if (fd == pf->fd || fd == CLOSE_ALL)
 	{
-	  file_close(pf->file);
-	  list_remove(&pf->elem);
-	  free(pf);
+	  close_fd(pf);
 	  if (fd != CLOSE_ALL)
 	    {
-	      return;
+	      break;
+	    }
+	}
+    }
+  lock_release(&p->lock);
+}
+
+/* Starts the exit of the current process with STATUS, unless
+   another thread has already started it.  The other threads of
+   the process die the next time they return to user mode, and
+   the last one to die reports STATUS to the parent.  Returns
+   true if this call started the exit.
+
+   Threads of the process sleeping in the kernel are woken, and
+   give up their system calls: futex_wait(), pipe and console
+   reads and writes, uthread_join() and wait() all check
+   process_exiting() atomically with going to sleep. */
+bool process_begin_exit (int status)
+{
+  struct process *p = thread_current()->process;
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool first = false;
+
+  if (!p)
+    {
+      return false;
+    }
+  lock_acquire(&p->lock);
+  if (!p->exiting)
+    {
+      p->exiting = true;
+      p->exit_status = status;
+      first = true;
+      for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads);
+	   e = list_next (e))
+	{
+	  struct user_thread *ut = list_entry (e, struct user_thread, elem);
+	  if (ut->joining)
+	    {
+	      sema_up(&ut->dead);
+	    }
+	}
+    }
+  lock_release(&p->lock);
+
+  if (first)
+    {
+      futex_cancel(p);
+      pipe_cancel_waits();
+      input_wake_waiters();
+      old_level = intr_disable();
+      thread_foreach(wake_child_waits, p);
+      intr_set_level(old_level);
+    }
+  return first;
+}
+
+/* Wakes T if it belongs to PROCESS and is waiting for a child
+   in process_wait(). */
+static void wake_child_waits (struct thread *t, void *process)
+{
+  if (t->process == process && t->waiting_on)
+    {
+      sema_up(&t->waiting_on->exit_sema);
+    }
+}
+
+/* Returns true if the current thread's process has begun to
+   exit, so that a system call should give up instead of
+   sleeping. */
+bool process_exiting (void)
+{
+  struct process *p = thread_current()->process;
+  return p && p->exiting;
+}
+
+/* Terminates the current thread if its process is exiting.
+   Called on the way back to user mode. */
+void process_check_exit (void)
+{
+  if (process_exiting())
+    {
+      intr_enable();
+      thread_exit();
+    }
+}
+
+/* Pins the SIZE bytes at user address UADDR for the current
+   thread's system call, if all of their pages are mapped, and
+   returns true.  Returns false if some page is not mapped, which
+   can happen even after check_valid_buffer() if another thread
+   unmapped it. */
+bool process_pin (struct user_pin *pin, const void *uaddr, size_t size)
+{
+  struct thread *t = thread_current();
+  struct process *p = t->process;
+  const uint8_t *upage;
+  bool mapped = true;
+
+  pin->start = uaddr;
+  pin->end = pin->start + size;
+  pin->thread = t;
+  lock_acquire(&p->lock);
+  for (upage = pg_round_down (uaddr); upage < pin->end && mapped;
+       upage += PGSIZE)
+    {
+      mapped = pagedir_get_page (p->pagedir, upage) != NULL;
+    }
+  if (mapped)
+    {
+      list_push_back(&p->pins, &pin->elem);
+    }
+  lock_release(&p->lock);
+  return mapped;
+}
+
+/* Drops every pin of the current thread.  Called at the end of
+   each system call and when the thread exits. */
+void process_unpin_all (void)
+{
+  struct thread *t = thread_current();
+  struct process *p = t->process;
+  struct list_elem *e, *next;
+  bool dropped = false;
+
+  if (!p)
+    {
+      return;
+    }
+  lock_acquire(&p->lock);
+  for (e = list_begin (&p->pins); e != list_end (&p->pins); e = next)
+    {
+      next = list_next (e);
+      if (list_entry (e, struct user_pin, elem)->thread == t)
+	{
+	  list_remove (e);
+	  dropped = true;
+	}
+    }
+  if (dropped)
+    {
+      cond_broadcast(&p->unpinned, &p->lock);
+    }
+  lock_release(&p->lock);
+}
+
+/* Returns true if a thread of process P other than the current
+   one has pinned any byte from START up to END.  P's lock must
+   be held. */
+static bool range_pinned (struct process *p, const uint8_t *start,
+                          const uint8_t *end)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&p->pins); e != list_end (&p->pins);
+       e = list_next (e))
+    {
+      struct user_pin *pin = list_entry (e, struct user_pin, elem);
+      if (pin->thread != thread_current()
+	  && pin->start < end && pin->end > start)
+	{
+	  return true;
+	}
+    }
+  return false;
+}
+
+/* Waits until no other thread of process P has pinned any of
+   the SIZE bytes at UADDR, which are about to be unmapped.  P's
+   lock must be held. */
+void process_wait_unpinned (struct process *p, const void *uaddr,
+			    size_t size)
+{
+  ASSERT (lock_held_by_current_thread (&p->lock));
+  while (range_pinned (p, uaddr, (const uint8_t *) uaddr + size))
+    {
+      cond_wait(&p->unpinned, &p->lock);
+    }
+}
+
+/* Information passed from process_thread_create() to a new
+   thread. */
+struct uthread_start
+  {
+    struct process *process;    /* Process to join. */
+    struct user_thread *uthread; /* Join record. */
+    void (*eip) (void);         /* User code to start at. */
+    void *esp;                  /* Initial user stack pointer. */
+  };
+
+/* Returns the lowest page of the highest stack slot that is free
+   in process P, or a null pointer if all are in use.  P's lock
+   must be held. */
+static uint8_t *
+find_stack_slot (struct process *p)
+{
+  uint8_t *top;
+
+  for (top = UTHREAD_STACK_TOP;
+       top - (UTHREAD_STACK_PAGES + 1) * PGSIZE >= UTHREAD_STACK_BOTTOM;
+       top -= (UTHREAD_STACK_PAGES + 1) * PGSIZE)
+    {
+      uint8_t *stack = top - UTHREAD_STACK_PAGES * PGSIZE;
+      if (pagedir_get_page (p->pagedir, stack) == NULL)
+	return stack;
+    }
+  return NULL;
+}
+
+/* Creates a new thread in the current process, sharing its
+   address space, descriptors and current directory, with a
+   stack of its own.  The thread starts in user mode at EIP as if
+   called as EIP (FUNC, AUX), which lets the user library run
+   FUNC (AUX) and then exit the thread.  Returns the new
+   thread's tid, or TID_ERROR on failure. */
+tid_t
+process_thread_create (void (*eip) (void), void *func, void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread_start *start;
+  struct user_thread *ut;
+  struct child_process *cp;
+  uint32_t *frame;
+  uint8_t *stack;
+  void *kpages[UTHREAD_STACK_PAGES];
+  tid_t tid;
+  int i;
+
+  start = malloc (sizeof *start);
+  ut = malloc (sizeof *ut);
+  if (start == NULL || ut == NULL)
+    goto fail;
+
+  /* Allocate and map the stack. */
+  lock_acquire (&p->lock);
+  stack = find_stack_slot (p);
+  for (i = 0; i < UTHREAD_STACK_PAGES; i++)
+    {
+      kpages[i] = stack ? palloc_get_page (PAL_USER | PAL_ZERO) : NULL;
+      if (kpages[i] == NULL
+	  || !pagedir_set_page (p->pagedir, stack + i * PGSIZE, kpages[i],
+				true))
+	{
+	  if (kpages[i] != NULL)
+	    palloc_free_page (kpages[i]);
+	  while (i-- > 0)
+	    {
+	      pagedir_clear_page (p->pagedir, stack + i * PGSIZE);
+	      palloc_free_page (kpages[i]);
 	    }
+	  lock_release (&p->lock);
+	  goto fail;
+	}
+    }
+  p->thread_cnt++;
+  lock_release (&p->lock);
+
+  /* Push AUX, FUNC and a null return address. */
+  frame = (uint32_t *) ((uint8_t *) kpages[UTHREAD_STACK_PAGES - 1]
+			+ PGSIZE) - 3;
+  frame[0] = 0;
+  frame[1] = (uint32_t) func;
+  frame[2] = (uint32_t) aux;
+
+  ut->stack = stack;
+  ut->status = ERROR;
+  ut->joining = false;
+  sema_init (&ut->dead, 0);
+  start->process = p;
+  start->uthread = ut;
+  start->eip = eip;
+  start->esp = stack + UTHREAD_STACK_PAGES * PGSIZE - 3 * sizeof (uint32_t);
+
+  /* Hold the process lock so that the record is listed before
+     the new thread can exit. */
+  lock_acquire (&p->lock);
+  tid = ut->tid = thread_create (cur->name, PRI_DEFAULT,
+				 start_user_thread, start);
+  if (tid == TID_ERROR)
+    {
+      p->thread_cnt--;
+      for (i = 0; i < UTHREAD_STACK_PAGES; i++)
+	{
+	  pagedir_clear_page (p->pagedir, stack + i * PGSIZE);
+	  palloc_free_page (kpages[i]);
 	}
-      e = next;
+      lock_release (&p->lock);
+      goto fail;
     }
+  list_push_back (&p->uthreads, &ut->elem);
+  lock_release (&p->lock);
+
+  /* thread_create() recorded the thread as our child process,
+     unless it ran out of memory doing so, but it is not one. */
+  cp = get_child_process (tid);
+  if (cp != NULL)
+    {
+      remove_child_process (cp);
+    }
+  return tid;
+
+ fail:
+  free (start);
+  free (ut);
+  return TID_ERROR;
+}
+
+/* A thread function that starts a thread created by
+   process_thread_create() running in user mode. */
+static void
+start_user_thread (void *start_)
+{
+  struct uthread_start *start = start_;
+  struct thread *t = thread_current ();
+  struct intr_frame if_;
+
+  /* Our creator frees the child record that thread_create()
+     made; forget it without touching it. */
+  t->cp = NULL;
+  t->process = start->process;
+  t->uthread = start->uthread;
+  t->pagedir = start->process->pagedir;
+  process_activate ();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = start->eip;
+  if_.esp = start->esp;
+  free (start);
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
 }
 
+/* Waits for thread TID of the current process, created by
+   process_thread_create(), to exit and returns the status it
+   passed to process_thread_exit(), or -1 if it was killed.
+   Returns -1 at once if TID is not such a thread or has already
+   been joined or is being joined, and returns -1 early if the
+   process begins to exit. */
+int
+process_thread_join (tid_t tid)
+{
+  struct process *p = thread_current ()->process;
+  struct user_thread *ut = NULL;
+  struct list_elem *e;
+  int status;
 
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads);
+       e = list_next (e))
+    if (list_entry (e, struct user_thread, elem)->tid == tid)
+      {
+	ut = list_entry (e, struct user_thread, elem);
+	break;
+      }
+  if (ut == NULL || ut == thread_current ()->uthread || ut->joining
+      || p->exiting)
+    {
+      lock_release (&p->lock);
+      return ERROR;
+    }
+  ut->joining = true;
+  lock_release (&p->lock);
+
+  /* process_begin_exit() also ups DEAD.  In that case, leave the
+     record for the process's last thread to free. */
+  sema_down (&ut->dead);
+  lock_acquire (&p->lock);
+  if (p->exiting)
+    {
+      lock_release (&p->lock);
+      return ERROR;
+    }
+  list_remove (&ut->elem);
+  lock_release (&p->lock);
+  status = ut->status;
+  free (ut);
+  return status;
+}
 
+/* Exits the current thread with STATUS for
+   process_thread_join().  If it turns out to be the process's
+   last thread, the process exits with STATUS, as if by exit().
+   That is decided in process_exit(), when the thread leaves the
+   process's thread count, so that of several threads exiting at
+   once exactly one is last. */
+void
+process_thread_exit (int status)
+{
+  struct thread *t = thread_current ();
+
+  t->uthread_exited = true;
+  t->uthread_status = status;
+  if (t->uthread != NULL)
+    t->uthread->status = status;
+  thread_exit ();
+}
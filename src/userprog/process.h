@@ -1,17 +1,91 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include "threads/synch.h"
 #include "threads/thread.h"
+struct pipe;
+
+/* State shared by all the threads of a user process. */
+struct process
+  {
+    struct lock lock;           /* Protects the members below. */
+    uint32_t *pagedir;          /* Page directory. */
+    int thread_cnt;             /* Number of live threads. */
+    bool exiting;               /* Set by exit(): threads die on their
+                                   next return to user mode. */
+    int exit_status;            /* Status passed to exit(). */
+    tid_t parent;               /* Thread that started the process. */
+    struct child_process *cp;   /* PARENT's record of the process. */
+    struct file *executable;    /* Executable, denied writes. */
+    uint8_t *heap_start;        /* Start of heap, page-aligned. */
+    uint8_t *heap_brk;          /* Current end of heap. */
+    struct list file_list;      /* Open files and pipe ends. */
+    int fd;                     /* Next file descriptor. */
+    bool console_nonblock[2];   /* O_NONBLOCK on STDIN_FILENO and
+                                   STDOUT_FILENO, while they are
+                                   the console. */
+    struct list shm_list;       /* Mapped shared memory segments,
+                                   protected by shm.c's lock instead. */
+    struct list uthreads;       /* Threads not yet joined. */
+    struct list pins;           /* User memory in use by system
+                                   calls, as struct user_pin. */
+    struct condition unpinned;  /* Signaled when pins are dropped. */
+  };
+
+/* A range of user memory that a system call of one of the
+   process's threads is using through its kernel mapping.  Its
+   pages stay mapped until the thread calls process_unpin_all(),
+   since sbrk(), shm_unmap() and exiting threads wait for pins
+   before unmapping pages. */
+struct user_pin
+  {
+    const uint8_t *start;       /* First byte. */
+    const uint8_t *end;         /* One past the last byte. */
+    struct thread *thread;      /* Thread that pinned the range. */
+    struct list_elem elem;      /* Element in process's pins. */
+  };
+
+/* A thread created by process_thread_create(), as seen by
+   process_thread_join(). */
+struct user_thread
+  {
+    tid_t tid;                  /* Thread identifier. */
+    uint8_t *stack;             /* User address of lowest stack page. */
+    int status;                 /* Status passed to uthread_exit(). */
+    bool joining;               /* A thread is in process_thread_join(). */
+    struct semaphore dead;      /* Upped when the thread has exited. */
+    struct list_elem elem;      /* Element in process's uthreads. */
+  };
 struct process_file {
-  struct file *file;
+  struct file *file;            /* Open file, or null for a pipe end. */
+  struct pipe *pipe;            /* Pipe, if FILE is null. */
+  bool pipe_writer;             /* Write end of PIPE? */
+  bool nonblock;                /* O_NONBLOCK set by fcntl()? */
   int fd;
   struct list_elem elem;
 };
 int process_add_file (struct file *f);
+int process_add_pipe (struct pipe *p, bool writer);
 struct file* process_get_file (int fd);
+struct pipe *process_get_pipe (int fd, bool *writer);
+int process_dup2 (int old_fd, int new_fd);
+bool process_get_nonblock (int fd, bool *nonblock);
+bool process_set_nonblock (int fd, bool nonblock);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void *process_sbrk (intptr_t increment);
+bool process_heap_fault (const void *uaddr);
+bool process_begin_exit (int status);
+bool process_exiting (void);
+void process_check_exit (void);
+bool process_pin (struct user_pin *, const void *uaddr, size_t size);
+void process_unpin_all (void);
+void process_wait_unpinned (struct process *, const void *uaddr,
+                            size_t size);
+tid_t process_thread_create (void (*eip) (void), void *func, void *aux);
+int process_thread_join (tid_t);
+void process_thread_exit (int status) NO_RETURN;
 
 #endif /* userprog/process.h */
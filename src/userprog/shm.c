@@ -0,0 +1,277 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Shared memory segments.  A segment is a set of user pages,
+   named by an integer key, that every process that attaches the
+   key maps into its own address space, so that the processes
+   see each other's writes at once.  The pages are allocated and
+   zeroed when the segment is created, and freed when the last
+   process detaches it, after which the key is unused again.
+
+   Segments are mapped between SHM_BASE and SHM_LIMIT, in the
+   lower half of the gap that process_sbrk() keeps free between
+   the heap and the stack. */
+#define SHM_BASE ((uint8_t *) PHYS_BASE - 8 * 1024 * 1024)
+#define SHM_LIMIT ((uint8_t *) PHYS_BASE - 4 * 1024 * 1024)
+
+/* A shared memory segment. */
+struct shm_segment
+  {
+    struct list_elem elem;              /* Element in `segments'. */
+    int key;                            /* Key. */
+    size_t page_cnt;                    /* Number of pages. */
+    void **pages;                       /* Kernel addresses of pages. */
+    int map_cnt;                        /* Mappings in processes. */
+  };
+
+/* A mapping of a segment into a process. */
+struct shm_mapping
+  {
+    struct list_elem elem;              /* Element in process's shm_list. */
+    struct shm_segment *segment;        /* Segment mapped. */
+    uint8_t *upage;                     /* User address of first page. */
+  };
+
+static struct list segments;            /* All segments. */
+static struct lock shm_lock;            /* Protects `segments'. */
+
+/* Initializes the shared memory segments. */
+void
+shm_init (void) 
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Returns the segment with the given KEY, or a null pointer if
+   there is none. */
+static struct shm_segment *
+find_segment (int key) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e)) 
+    {
+      struct shm_segment *s = list_entry (e, struct shm_segment, elem);
+      if (s->key == key)
+        return s;
+    }
+  return NULL;
+}
+
+/* Frees segment S, which must have no mappings. */
+static void
+free_segment (struct shm_segment *s) 
+{
+  size_t i;
+
+  ASSERT (s->map_cnt == 0);
+  for (i = 0; i < s->page_cnt; i++)
+    if (s->pages[i] != NULL)
+      palloc_free_page (s->pages[i]);
+  free (s->pages);
+  free (s);
+}
+
+/* Creates a segment with the given KEY and PAGE_CNT zeroed
+   pages, with no mappings.  Returns the new segment, or a null
+   pointer if memory is exhausted. */
+static struct shm_segment *
+create_segment (int key, size_t page_cnt) 
+{
+  struct shm_segment *s = malloc (sizeof *s);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+  s->key = key;
+  s->page_cnt = page_cnt;
+  s->map_cnt = 0;
+  s->pages = calloc (page_cnt, sizeof *s->pages);
+  if (s->pages == NULL)
+    {
+      free (s);
+      return NULL;
+    }
+  for (i = 0; i < page_cnt; i++) 
+    {
+      s->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (s->pages[i] == NULL) 
+        {
+          free_segment (s);
+          return NULL;
+        }
+    }
+  list_push_back (&segments, &s->elem);
+  return s;
+}
+
+/* Returns the lowest user address at or above SHM_BASE where
+   PAGE_CNT consecutive pages are unmapped in page directory PD
+   and end at or below SHM_LIMIT, or a null pointer if there is
+   no such place. */
+static uint8_t *
+find_free_range (uint32_t *pd, size_t page_cnt) 
+{
+  uint8_t *start, *upage;
+
+  for (start = SHM_BASE;
+       start + page_cnt * PGSIZE <= SHM_LIMIT; start = upage + PGSIZE) 
+    {
+      for (upage = start; upage < start + page_cnt * PGSIZE; upage += PGSIZE)
+        if (pagedir_get_page (pd, upage) != NULL)
+          break;
+      if (upage == start + page_cnt * PGSIZE)
+        return start;
+    }
+  return NULL;
+}
+
+/* Removes the first PAGE_CNT pages at UPAGE from page directory
+   PD, without freeing them. */
+static void
+unmap_pages (uint32_t *pd, uint8_t *upage, size_t page_cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    pagedir_clear_page (pd, upage + i * PGSIZE);
+}
+
+/* Maps the shared memory segment with the given KEY into the
+   current process and returns its user address.  If no segment
+   has KEY, creates one of SIZE bytes, rounded up to whole pages,
+   unless SIZE is 0.  An existing segment may be attached with
+   any SIZE up to its own.  Returns a null pointer if there is no
+   such segment and SIZE is 0, if SIZE is larger than the
+   segment, or if memory or address space is exhausted. */
+void *
+shm_attach (int key, size_t size) 
+{
+  struct thread *t = thread_current ();
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct shm_segment *s;
+  struct shm_mapping *m;
+  uint8_t *upage;
+  size_t i;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+
+  lock_acquire (&shm_lock);
+  s = find_segment (key);
+  if (s == NULL && size > 0 && size <= (size_t) (SHM_LIMIT - SHM_BASE))
+    s = create_segment (key, page_cnt);
+  if (s == NULL || page_cnt > s->page_cnt)
+    goto fail;
+
+  upage = find_free_range (t->pagedir, s->page_cnt);
+  if (upage == NULL)
+    goto fail;
+  for (i = 0; i < s->page_cnt; i++)
+    if (!pagedir_set_page (t->pagedir, upage + i * PGSIZE, s->pages[i],
+                           true)) 
+      {
+        unmap_pages (t->pagedir, upage, i);
+        goto fail;
+      }
+
+  s->map_cnt++;
+  m->segment = s;
+  m->upage = upage;
+  list_push_back (&t->process->shm_list, &m->elem);
+  lock_release (&shm_lock);
+  return upage;
+
+ fail:
+  if (s != NULL && s->map_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      free_segment (s);
+    }
+  lock_release (&shm_lock);
+  free (m);
+  return NULL;
+}
+
+/* Unmaps mapping M from the current process and frees it,
+   freeing its segment too if this was the last mapping.  The
+   caller must hold shm_lock. */
+static void
+detach (struct shm_mapping *m) 
+{
+  struct thread *t = thread_current ();
+  struct shm_segment *s = m->segment;
+
+  unmap_pages (t->pagedir, m->upage, s->page_cnt);
+  list_remove (&m->elem);
+  free (m);
+
+  if (--s->map_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      free_segment (s);
+    }
+}
+
+/* Unmaps the segment that shm_attach() mapped at ADDR in the
+   current process, first waiting for system calls of other
+   threads that use its pages to finish.  Returns true if
+   successful, false if ADDR is not the address of a mapped
+   segment. */
+bool
+shm_detach (void *addr) 
+{
+  struct process *p = thread_current ()->process;
+  struct shm_mapping *m = NULL;
+  struct list_elem *e;
+
+  /* Holding P's lock keeps other threads of P from detaching M
+     or pinning its pages once they are unpinned. */
+  lock_acquire (&p->lock);
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&p->shm_list); e != list_end (&p->shm_list);
+       e = list_next (e)) 
+    if (list_entry (e, struct shm_mapping, elem)->upage == addr) 
+      {
+        m = list_entry (e, struct shm_mapping, elem);
+        break;
+      }
+  lock_release (&shm_lock);
+
+  if (m != NULL) 
+    {
+      process_wait_unpinned (p, m->upage, m->segment->page_cnt * PGSIZE);
+      lock_acquire (&shm_lock);
+      detach (m);
+      lock_release (&shm_lock);
+    }
+  lock_release (&p->lock);
+  return m != NULL;
+}
+
+/* Unmaps every segment mapped in the current process, which is
+   exiting.  Must be called before the process's page directory
+   is destroyed, since that would free the shared pages. */
+void
+shm_detach_all (void) 
+{
+  struct list *mappings = &thread_current ()->process->shm_list;
+
+  lock_acquire (&shm_lock);
+  while (!list_empty (mappings))
+    detach (list_entry (list_front (mappings), struct shm_mapping, elem));
+  lock_release (&shm_lock);
+}
@@ -0,0 +1,12 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void shm_init (void);
+void *shm_attach (int key, size_t size);
+bool shm_detach (void *addr);
+void shm_detach_all (void);
+
+#endif /* userprog/shm.h */
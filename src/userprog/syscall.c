@@ -1,18 +1,26 @@
 #include "userprog/syscall.h"
+#include <limits.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include <user/syscall.h>
+#include "devices/block.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
 #include "userprog/process.h"
+#include "userprog/shm.h"
 #include "filesys/directory.h"
 #include <string.h>
 
@@ -23,10 +31,20 @@ static void syscall_handler (struct intr_frame *);
 int user_to_kernel_ptr(const void *vaddr);
 void get_arg (struct intr_frame *f, int *arg, int n);
 void check_valid_ptr (const void *vaddr);
-void check_valid_buffer (void* buffer, unsigned size);
-void check_valid_string (const void* str);
+void check_valid_buffer (struct user_pin *pin, void* buffer, unsigned size);
+void check_valid_string (struct user_pin *pin, const void* str);
 char * resolve_file (const void* str);
 char * resolve_dir (const void* dir);
+static unsigned user_page_chunk (const void *uaddr, unsigned size);
+static void * user_to_kernel_page (const void *uaddr);
+static void copy_from_user (void *dst, const void *usrc, unsigned size);
+static void copy_to_user (void *udst, const void *src, unsigned size);
+static int read_pipe (struct pipe *p, void *buffer, unsigned size,
+		      bool nonblock);
+static int write_pipe (struct pipe *p, const void *buffer, unsigned size,
+		       bool nonblock);
+static bool console_getc (uint8_t *key, bool block);
+static short poll_fd (int fd, short events);
 
 void
 syscall_init (void) 
@@ -35,10 +53,15 @@ syscall_init (void)
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* User memory that a system call uses through the kernel's
+   mapping is pinned by check_valid_buffer() or
+   check_valid_string(), so that other threads of the process
+   cannot unmap it meanwhile, and unpinned on return. */
 static void
 syscall_handler (struct intr_frame *f UNUSED) 
 {
   int arg[MAX_ARGS];
+  struct user_pin pins[2];
   int esp = user_to_kernel_ptr((const void*) f->esp);
   switch (* (int *) esp)
     {
@@ -56,7 +79,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_EXEC:
       {
 	get_arg(f, &arg[0], 1);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = exec((const char *) arg[0]); 
 	break;
@@ -70,7 +93,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_CREATE:
       {
 	get_arg(f, &arg[0], 2);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = create((const char *)arg[0], (unsigned) arg[1]);
 	break;
@@ -78,7 +101,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_REMOVE:
       {
 	get_arg(f, &arg[0], 1);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = remove((const char *) arg[0]);
 	break;
@@ -86,7 +109,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_OPEN:
       {
 	get_arg(f, &arg[0], 1);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = open((const char *) arg[0]);
 	break; 		
@@ -100,16 +123,14 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_READ:
       {
 	get_arg(f, &arg[0], 3);
-	check_valid_buffer((void *) arg[1], (unsigned) arg[2]);
-	arg[1] = user_to_kernel_ptr((const void *) arg[1]);
+	check_valid_buffer(&pins[0], (void *) arg[1], (unsigned) arg[2]);
 	f->eax = read(arg[0], (void *) arg[1], (unsigned) arg[2]);
 	break;
       }
     case SYS_WRITE:
       { 
 	get_arg(f, &arg[0], 3);
-	check_valid_buffer((void *) arg[1], (unsigned) arg[2]);
-	arg[1] = user_to_kernel_ptr((const void *) arg[1]);
+	check_valid_buffer(&pins[0], (void *) arg[1], (unsigned) arg[2]);
 	f->eax = write(arg[0], (const void *) arg[1],
 		       (unsigned) arg[2]);
 	break;
@@ -135,7 +156,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_CHDIR:
       {
 	get_arg(f, &arg[0], 1);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = chdir((const char *) arg[0]);
 	break; 		
@@ -143,7 +164,7 @@ syscall_handler (struct intr_frame *f UNUSED)
     case SYS_MKDIR:
       {
 	get_arg(f, &arg[0], 1);
-	check_valid_string((const void *) arg[0]);
+	check_valid_string(&pins[0], (const void *) arg[0]);
 	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
 	f->eax = mkdir((const char *) arg[0]);
 	break; 		
@@ -154,7 +175,143 @@ syscall_handler (struct intr_frame *f UNUSED)
         f->eax = isdir(arg[0]);
         break;
       }
+    case SYS_SBRK:
+      {
+	get_arg(f, &arg[0], 1);
+	f->eax = (uint32_t) sbrk((intptr_t) arg[0]);
+	break;
+      }
+    case SYS_FSSTATS:
+      {
+	get_arg(f, &arg[0], 1);
+	check_valid_buffer(&pins[0], (void *) arg[0], sizeof (struct fs_stats));
+	f->eax = fsstats((struct fs_stats *) arg[0]);
+	break;
+      }
+    case SYS_DEFRAG:
+      {
+	get_arg(f, &arg[0], 1);
+	if (arg[0] != 0)
+	  {
+	    check_valid_string(&pins[0], (const void *) arg[0]);
+	    arg[0] = user_to_kernel_ptr((const void *) arg[0]);
+	  }
+	f->eax = defrag((const char *) arg[0]);
+	break;
+      }
+    case SYS_FCNTL:
+      {
+	get_arg(f, &arg[0], 3);
+	f->eax = fcntl(arg[0], arg[1], arg[2]);
+	break;
+      }
+    case SYS_TRUNCATE:
+      {
+	get_arg(f, &arg[0], 2);
+	check_valid_string(&pins[0], (const void *) arg[0]);
+	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
+	f->eax = truncate((const char *) arg[0], (unsigned) arg[1]);
+	break;
+      }
+    case SYS_FTRUNCATE:
+      {
+	get_arg(f, &arg[0], 2);
+	f->eax = ftruncate(arg[0], (unsigned) arg[1]);
+	break;
+      }
+    case SYS_FALLOCATE:
+      {
+	get_arg(f, &arg[0], 3);
+	f->eax = fallocate(arg[0], (unsigned) arg[1], (unsigned) arg[2]);
+	break;
+      }
+    case SYS_REFLINK:
+      {
+	get_arg(f, &arg[0], 2);
+	check_valid_string(&pins[0], (const void *) arg[0]);
+	check_valid_string(&pins[1], (const void *) arg[1]);
+	arg[0] = user_to_kernel_ptr((const void *) arg[0]);
+	arg[1] = user_to_kernel_ptr((const void *) arg[1]);
+	f->eax = reflink((const char *) arg[0], (const char *) arg[1]);
+	break;
+      }
+    case SYS_DEDUP:
+      {
+	f->eax = dedup();
+	break;
+      }
+    case SYS_PIPE:
+      {
+	get_arg(f, &arg[0], 1);
+	check_valid_buffer(&pins[0], (void *) arg[0], 2 * sizeof (int));
+	f->eax = pipe((int *) arg[0]);
+	break;
+      }
+    case SYS_DUP2:
+      {
+	get_arg(f, &arg[0], 2);
+	f->eax = dup2(arg[0], arg[1]);
+	break;
+      }
+    case SYS_SHM_MAP:
+      {
+	get_arg(f, &arg[0], 2);
+	f->eax = (uint32_t) shm_map(arg[0], (size_t) arg[1]);
+	break;
+      }
+    case SYS_SHM_UNMAP:
+      {
+	get_arg(f, &arg[0], 1);
+	f->eax = shm_unmap((void *) arg[0]);
+	break;
+      }
+    case SYS_FUTEX_WAIT:
+      {
+	get_arg(f, &arg[0], 2);
+	check_valid_buffer(&pins[0], (void *) arg[0], sizeof (int));
+	f->eax = futex_wait((int *) arg[0], arg[1]);
+	break;
+      }
+    case SYS_FUTEX_WAKE:
+      {
+	get_arg(f, &arg[0], 2);
+	check_valid_buffer(&pins[0], (void *) arg[0], sizeof (int));
+	f->eax = futex_wake((int *) arg[0], arg[1]);
+	break;
+      }
+    case SYS_POLL:
+      {
+	get_arg(f, &arg[0], 3);
+	if ((unsigned) arg[1] > UINT_MAX / sizeof (struct pollfd))
+	  {
+	    exit(ERROR);
+	  }
+	check_valid_buffer(&pins[0], (void *) arg[0],
+			   (unsigned) arg[1] * sizeof (struct pollfd));
+	f->eax = poll((struct pollfd *) arg[0], (unsigned) arg[1], arg[2]);
+	break;
+      }
+    case SYS_UTHREAD_CREATE:
+      {
+	get_arg(f, &arg[0], 3);
+	f->eax = process_thread_create((void (*) (void)) arg[0],
+				       (void *) arg[1], (void *) arg[2]);
+	break;
+      }
+    case SYS_UTHREAD_JOIN:
+      {
+	get_arg(f, &arg[0], 1);
+	f->eax = uthread_join(arg[0]);
+	break;
+      }
+    case SYS_UTHREAD_EXIT:
+      {
+	get_arg(f, &arg[0], 1);
+	uthread_exit(arg[0]);
+	break;
+      }
     }
+  process_unpin_all();
 }
 
 void halt (void)
@@ -162,14 +319,13 @@ void halt (void)
   shutdown_power_off();
 }
 
+/* Exits the current process, including all of its threads. */
 void exit (int status)
 {
-  struct thread *cur = thread_current();
-  if (thread_alive(cur->parent) && cur->cp)
+  if (process_begin_exit(status))
     {
-      cur->cp->status = status;
+      printf ("%s: exit(%d)\n", thread_current()->name, status);
     }
-  printf ("%s: exit(%d)\n", cur->name, status);
   thread_exit();
 }
 
@@ -252,17 +408,46 @@ int filesize (int fd)
   return size;
 }
 
+/* BUFFER is a user address, already checked by
+   check_valid_buffer().  It is accessed a page at a time, since
+   consecutive user pages need not be consecutive in the kernel's
+   mapping of physical memory. */
 int read (int fd, void *buffer, unsigned size)
 {
+  int bytes = 0;
+  bool writer, nonblock = false;
+  process_get_nonblock(fd, &nonblock);
+  struct pipe *p = process_get_pipe(fd, &writer);
+  if (p)
+    {
+      bytes = writer ? ERROR : read_pipe(p, buffer, size, nonblock);
+      pipe_close(p, writer);
+      return bytes;
+    }
   if (fd == STDIN_FILENO)
     {
-      unsigned i;
-      uint8_t* local_buffer = (uint8_t *) buffer;
-      for (i = 0; i < size; i++)
+      /* Without O_NONBLOCK, wait for every byte; with it, take
+	 only the keys already typed. */
+      while (size > 0)
 	{
-	  local_buffer[i] = input_getc();
+	  unsigned i, chunk = user_page_chunk(buffer, size);
+	  uint8_t* local_buffer = user_to_kernel_page(buffer);
+	  for (i = 0; i < chunk; i++)
+	    {
+	      if (!console_getc(&local_buffer[i], !nonblock))
+		{
+		  break;
+		}
+	    }
+	  bytes += i;
+	  if (i < chunk)
+	    {
+	      break;
+	    }
+	  buffer = (uint8_t *) buffer + chunk;
+	  size -= chunk;
 	}
-      return size;
+      return bytes == 0 && size > 0 ? ERROR : bytes;
     }
   lock_acquire(&filesys_lock);
   struct file *f = process_get_file(fd);
@@ -271,17 +456,59 @@ int read (int fd, void *buffer, unsigned size)
       lock_release(&filesys_lock);
       return ERROR;
     }
-  int bytes = file_read(f, buffer, size);
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(buffer, size);
+      int n = file_read(f, user_to_kernel_page(buffer), chunk);
+      bytes += n;
+      if (n < (int) chunk)
+	{
+	  break;
+	}
+      buffer = (uint8_t *) buffer + chunk;
+      size -= chunk;
+    }
   lock_release(&filesys_lock);
   return bytes;
 }
 
+/* BUFFER is a user address, as for read(). */
 int write (int fd, const void *buffer, unsigned size)
 {
+  int bytes = 0;
+  bool writer, nonblock = false;
+  process_get_nonblock(fd, &nonblock);
+  struct pipe *p = process_get_pipe(fd, &writer);
+  if (p)
+    {
+      bytes = writer ? write_pipe(p, buffer, size, nonblock) : ERROR;
+      pipe_close(p, writer);
+      return bytes;
+    }
   if (fd == STDOUT_FILENO)
     {
-      putbuf(buffer, size);
-      return size;
+      /* Keep writes of up to a page together on the console, even
+	 if they cross a page boundary. */
+      if (size <= PGSIZE && user_page_chunk(buffer, size) < size)
+	{
+	  void *bounce = palloc_get_page(0);
+	  if (bounce)
+	    {
+	      copy_from_user(bounce, buffer, size);
+	      putbuf(bounce, size);
+	      palloc_free_page(bounce);
+	      return size;
+	    }
+	}
+      while (size > 0)
+	{
+	  unsigned chunk = user_page_chunk(buffer, size);
+	  putbuf(user_to_kernel_page(buffer), chunk);
+	  buffer = (const uint8_t *) buffer + chunk;
+	  size -= chunk;
+	  bytes += chunk;
+	}
+      return bytes;
     }
   lock_acquire(&filesys_lock);
   struct file *f = process_get_file(fd);
@@ -290,11 +517,77 @@ int write (int fd, const void *buffer, unsigned size)
       lock_release(&filesys_lock);
       return ERROR;
     }
-  int bytes = file_write(f, buffer, size);
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(buffer, size);
+      int n = file_write(f, user_to_kernel_page(buffer), chunk);
+      bytes += n;
+      if (n < (int) chunk)
+	{
+	  break;
+	}
+      buffer = (const uint8_t *) buffer + chunk;
+      size -= chunk;
+    }
   lock_release(&filesys_lock);
   return bytes;
 }
 
+/* Reads from the read end of a pipe, waiting only until some
+   data or end of file arrives, or not at all if NONBLOCK is
+   true, in which case an empty pipe gives ERROR.  BUFFER is a
+   user address, as for read().  The pipe is not part of the file
+   system, so filesys_lock is not needed. */
+static int read_pipe (struct pipe *p, void *buffer, unsigned size,
+		      bool nonblock)
+{
+  int bytes = 0;
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(buffer, size);
+      int n = pipe_read(p, user_to_kernel_page(buffer), chunk,
+			bytes == 0 && !nonblock);
+      if (n < 0)
+	{
+	  return bytes > 0 ? bytes : ERROR;
+	}
+      bytes += n;
+      if (n < (int) chunk)
+	{
+	  break;
+	}
+      buffer = (uint8_t *) buffer + chunk;
+      size -= chunk;
+    }
+  return bytes;
+}
+
+/* Writes all of BUFFER, a user address, to the write end of a
+   pipe, as for read_pipe().  If NONBLOCK is true, writes only
+   as much as fits at once, giving ERROR if the pipe is full. */
+static int write_pipe (struct pipe *p, const void *buffer, unsigned size,
+		       bool nonblock)
+{
+  int bytes = 0;
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(buffer, size);
+      int n = pipe_write(p, user_to_kernel_page(buffer), chunk, !nonblock);
+      if (n < 0)
+	{
+	  return bytes > 0 ? bytes : ERROR;
+	}
+      bytes += n;
+      if (n < (int) chunk)
+	{
+	  break;
+	}
+      buffer = (const uint8_t *) buffer + chunk;
+      size -= chunk;
+    }
+  return bytes;
+}
+
 void seek (int fd, unsigned position)
 {
   lock_acquire(&filesys_lock);
@@ -345,6 +638,329 @@ bool isdir (int fd)
   return true;
 }
 
+void *sbrk (intptr_t increment)
+{
+  void *old_brk = process_sbrk(increment);
+  if (!old_brk)
+    {
+      return SBRK_FAILED;
+    }
+  return old_brk;
+}
+
+/* STATS is a user address, as for read(). */
+bool fsstats (struct fs_stats *stats)
+{
+  struct fs_stats s;
+  unsigned long long read_cnt, write_cnt;
+
+  s.ticks = timer_ticks();
+  s.ticks_per_sec = TIMER_FREQ;
+  lock_acquire(&filesys_lock);
+  cache_get_stats(&s.cache_hits, &s.cache_misses);
+  block_get_stats(fs_device, &read_cnt, &write_cnt);
+  lock_release(&filesys_lock);
+  s.sectors_read = read_cnt;
+  s.sectors_written = write_cnt;
+  copy_to_user(stats, &s, sizeof s);
+  return true;
+}
+
+/* Gets (F_GETFL) or sets (F_SETFL) the status flags of FD. */
+/* O_NONBLOCK applies to any descriptor, the other flags only to
+   open files. */
+int fcntl (int fd, int cmd, int arg)
+{
+  lock_acquire(&filesys_lock);
+  struct file *f = process_get_file(fd);
+  bool nonblock;
+  int result = ERROR;
+  if (!process_get_nonblock(fd, &nonblock))
+    {
+      /* Not open. */
+    }
+  else if (cmd == F_GETFL)
+    {
+      result = nonblock ? O_NONBLOCK : 0;
+      if (f)
+	{
+	  result |= ((file_is_direct(f) ? O_DIRECT : 0)
+		     | (file_is_compressed(f) ? O_COMPRESS : 0));
+	}
+    }
+  else if (cmd == F_SETFL
+	   && (arg & ~(O_DIRECT | O_COMPRESS | O_NONBLOCK)) == 0
+	   && (f || (arg & (O_DIRECT | O_COMPRESS)) == 0)
+	   && (!f || file_set_compressed(f, (arg & O_COMPRESS) != 0)))
+    {
+      if (f)
+	{
+	  file_set_direct(f, (arg & O_DIRECT) != 0);
+	}
+      process_set_nonblock(fd, (arg & O_NONBLOCK) != 0);
+      result = 0;
+    }
+  lock_release(&filesys_lock);
+  return result;
+}
+
+/* Sets the revents member of each of the NFDS entries of FDS,
+   a user array already checked by check_valid_buffer(), to
+   those of its requested events that its descriptor is ready
+   for, plus POLLHUP, POLLERR or POLLNVAL where they apply.
+   Entries with negative descriptors are ignored.  Waits until
+   some entry has events or TIMEOUT milliseconds pass, forever
+   if TIMEOUT is negative.  Returns the number of entries with
+   events.
+
+   Like timer_sleep(), waits by yielding the CPU between checks,
+   since the console, pipes and files have no common event to
+   block on. */
+int poll (struct pollfd *fds, unsigned nfds, int timeout)
+{
+  int64_t start = timer_ticks();
+  int64_t ticks = ((int64_t) timeout * TIMER_FREQ + 999) / 1000;
+
+  for (;;)
+    {
+      int ready = 0;
+      unsigned i;
+
+      for (i = 0; i < nfds; i++)
+	{
+	  struct pollfd pfd;
+	  copy_from_user(&pfd, &fds[i], sizeof pfd);
+	  pfd.revents = pfd.fd < 0 ? 0 : poll_fd(pfd.fd, pfd.events);
+	  copy_to_user(&fds[i].revents, &pfd.revents, sizeof pfd.revents);
+	  if (pfd.revents != 0)
+	    {
+	      ready++;
+	    }
+	}
+      if (ready > 0 || process_exiting()
+	  || (timeout >= 0 && timer_elapsed(start) >= ticks))
+	{
+	  return ready;
+	}
+      thread_yield();
+    }
+}
+
+/* Returns the events of EVENTS that descriptor FD is ready for,
+   plus POLLHUP or POLLERR if the other end of a pipe is closed,
+   or POLLNVAL if FD is not open.  Open files are always ready. */
+static short poll_fd (int fd, short events)
+{
+  short revents = 0;
+  bool writer;
+  struct pipe *p = process_get_pipe(fd, &writer);
+  if (p)
+    {
+      if (pipe_ready(p, writer))
+	{
+	  revents |= events & (writer ? POLLOUT : POLLIN);
+	}
+      if (pipe_hung_up(p, writer))
+	{
+	  revents |= writer ? POLLERR : POLLHUP;
+	}
+      pipe_close(p, writer);
+      return revents;
+    }
+  if (fd == STDIN_FILENO)
+    {
+      enum intr_level old_level = intr_disable();
+      if (!input_empty())
+	{
+	  revents |= events & POLLIN;
+	}
+      intr_set_level(old_level);
+      return revents;
+    }
+  if (fd == STDOUT_FILENO)
+    {
+      return events & POLLOUT;
+    }
+  lock_acquire(&filesys_lock);
+  struct file *f = process_get_file(fd);
+  lock_release(&filesys_lock);
+  return f ? events & (POLLIN | POLLOUT) : POLLNVAL;
+}
+
+/* Reads a key from the console into *KEY, waiting for one to be
+   typed if BLOCK is true, and returns true.  Returns false if
+   there is no key and BLOCK is false, or if the process begins to
+   exit while waiting. */
+static bool console_getc (uint8_t *key, bool block)
+{
+  enum intr_level old_level = intr_disable();
+  bool ready;
+  while (input_empty() && block && !process_exiting())
+    {
+      input_wait();
+    }
+  ready = !input_empty();
+  if (ready)
+    {
+      *key = input_getc();
+    }
+  intr_set_level(old_level);
+  return ready;
+}
+
+/* Sets the size of FILE to LENGTH bytes. */
+bool truncate (const char *file, unsigned length)
+{
+  lock_acquire(&filesys_lock);
+  struct file *f = filesys_open(file);
+  bool success = f && length <= INT32_MAX && file_truncate(f, length);
+  file_close(f);
+  lock_release(&filesys_lock);
+  return success;
+}
+
+/* Sets the size of the file open as FD to LENGTH bytes. */
+bool ftruncate (int fd, unsigned length)
+{
+  lock_acquire(&filesys_lock);
+  struct file *f = process_get_file(fd);
+  bool success = f && length <= INT32_MAX && file_truncate(f, length);
+  lock_release(&filesys_lock);
+  return success;
+}
+
+/* Reserves disk space for LENGTH bytes at OFFSET in the file
+   open as FD. */
+bool fallocate (int fd, unsigned offset, unsigned length)
+{
+  lock_acquire(&filesys_lock);
+  struct file *f = process_get_file(fd);
+  bool success = (f && offset <= INT32_MAX && length <= INT32_MAX
+		  && file_allocate(f, offset, length));
+  lock_release(&filesys_lock);
+  return success;
+}
+
+/* Creates NEW_FILE as a copy of FILE that shares its data
+   blocks until either one is written. */
+bool reflink (const char *file, const char *new_file)
+{
+  lock_acquire(&filesys_lock);
+  bool success = filesys_clone(file, new_file);
+  lock_release(&filesys_lock);
+  return success;
+}
+
+/* Makes identical sectors of all files share one sector.
+   Returns the number of sectors merged. */
+int dedup (void)
+{
+  lock_acquire(&filesys_lock);
+  int merged = filesys_dedup();
+  lock_release(&filesys_lock);
+  return merged;
+}
+
+/* Creates a pipe and stores the descriptors of its read and
+   write ends in FDS[0] and FDS[1], a user address checked by the
+   caller.  Child processes started by exec() inherit them. */
+bool pipe (int fds[2])
+{
+  int kfds[2];
+  struct pipe *p = pipe_create();
+  if (!p)
+    {
+      return false;
+    }
+  kfds[0] = process_add_pipe(p, false);
+  if (kfds[0] == ERROR)
+    {
+      pipe_close(p, false);
+      pipe_close(p, true);
+      return false;
+    }
+  kfds[1] = process_add_pipe(p, true);
+  if (kfds[1] == ERROR)
+    {
+      pipe_close(p, true);
+      close(kfds[0]);
+      return false;
+    }
+  copy_to_user(fds, kfds, sizeof kfds);
+  return true;
+}
+
+/* Makes NEW_FD another descriptor for the pipe end OLD_FD. */
+int dup2 (int old_fd, int new_fd)
+{
+  lock_acquire(&filesys_lock);
+  int fd = process_dup2(old_fd, new_fd);
+  lock_release(&filesys_lock);
+  return fd;
+}
+
+/* Maps the shared memory segment KEY, creating it with SIZE
+   bytes if it does not exist, and returns its address. */
+void *shm_map (int key, size_t size)
+{
+  return shm_attach(key, size);
+}
+
+/* Unmaps the shared memory segment mapped at ADDR. */
+bool shm_unmap (void *addr)
+{
+  return shm_detach(addr);
+}
+
+/* Returns the kernel address of the int at user address ADDR,
+   killing the process if ADDR is misaligned or unmapped.  An
+   aligned int lies within a single page. */
+static const int *futex_addr (int *addr)
+{
+  if ((uintptr_t) addr % sizeof *addr != 0)
+    {
+      exit(ERROR);
+    }
+  return (const int *) user_to_kernel_ptr(addr);
+}
+
+/* Sleeps until woken by futex_wake() on ADDR, if the int there
+   still equals EXPECTED.  Returns false if it did not. */
+bool futex_wait (int *addr, int expected)
+{
+  return futex_block(futex_addr(addr), expected);
+}
+
+/* Wakes up to CNT threads sleeping in futex_wait() on ADDR and
+   returns the number woken. */
+int futex_wake (int *addr, int cnt)
+{
+  return futex_unblock(futex_addr(addr), cnt);
+}
+
+/* Waits for thread TID of this process to exit and returns its
+   status. */
+int uthread_join (uthread_t tid)
+{
+  return process_thread_join(tid);
+}
+
+/* Exits the current thread, or the process if this is its last
+   thread. */
+void uthread_exit (int status)
+{
+  process_thread_exit(status);
+}
+
+/* Defragments FILE, or every file if FILE is null. */
+int defrag (const char *file)
+{
+  lock_acquire(&filesys_lock);
+  int moved = filesys_defrag(file);
+  lock_release(&filesys_lock);
+  return moved;
+}
+
 void check_valid_ptr (const void *vaddr)
 {
   if (!is_user_vaddr(vaddr) || vaddr < USER_VADDR_BOTTOM)
@@ -357,6 +973,10 @@ int user_to_kernel_ptr(const void *vaddr)
 {
   check_valid_ptr(vaddr);
   void *ptr = pagedir_get_page(thread_current()->pagedir, vaddr);
+  if (!ptr && process_heap_fault(vaddr))
+    {
+      ptr = pagedir_get_page(thread_current()->pagedir, vaddr);
+    }
   if (!ptr)
     {
       exit(ERROR);
@@ -433,22 +1053,93 @@ void get_arg (struct intr_frame *f, int *arg, int n)
     }
 }
 
-void check_valid_buffer (void* buffer, unsigned size)
+/* Checks that every page of the SIZE bytes at user address
+   BUFFER is mapped, bringing in heap pages as necessary, and
+   pins them with PIN, so that user_to_kernel_page() cannot fail
+   on any of them until the system call returns.  Kills the
+   process if another thread unmaps a page before it is pinned. */
+void check_valid_buffer (struct user_pin *pin, void* buffer, unsigned size)
 {
-  unsigned i;
-  char* local_buffer = (char *) buffer;
-  for (i = 0; i < size; i++)
+  uint8_t *local_buffer = (uint8_t *) buffer;
+  if (size == 0)
     {
-      check_valid_ptr((const void*) local_buffer);
-      local_buffer++;
+      return;
+    }
+  check_valid_ptr(local_buffer + size - 1);
+  if (local_buffer + size - 1 < local_buffer)
+    {
+      exit(ERROR);
+    }
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(local_buffer, size);
+      user_to_kernel_ptr(local_buffer);
+      local_buffer += chunk;
+      size -= chunk;
+    }
+  if (!process_pin(pin, buffer, local_buffer - (uint8_t *) buffer))
+    {
+      exit(ERROR);
     }
 }
 
-void check_valid_string (const void* str)
+/* Returns the number of bytes from user address UADDR to the end
+   of its page, but no more than SIZE. */
+static unsigned user_page_chunk (const void *uaddr, unsigned size)
 {
-  while (* (char *) user_to_kernel_ptr(str) != 0)
+  unsigned left = PGSIZE - pg_ofs(uaddr);
+  return size < left ? size : left;
+}
+
+/* Returns the kernel address for user address UADDR, which must
+   be mapped and pinned by check_valid_buffer(). */
+static void * user_to_kernel_page (const void *uaddr)
+{
+  void *ptr = pagedir_get_page(thread_current()->pagedir, uaddr);
+  ASSERT (ptr != NULL);
+  return ptr;
+}
+
+/* Copies SIZE bytes from user address USRC, which must have been
+   checked by check_valid_buffer(), to DST. */
+static void copy_from_user (void *dst, const void *usrc, unsigned size)
+{
+  while (size > 0)
+    {
+      unsigned chunk = user_page_chunk(usrc, size);
+      memcpy(dst, user_to_kernel_page(usrc), chunk);
+      usrc = (const uint8_t *) usrc + chunk;
+      dst = (uint8_t *) dst + chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies SIZE bytes from SRC to user address UDST, which must
+   have been checked by check_valid_buffer(). */
+static void copy_to_user (void *udst, const void *src, unsigned size)
+{
+  while (size > 0)
     {
-      str = (char *) str + 1;
+      unsigned chunk = user_page_chunk(udst, size);
+      memcpy(user_to_kernel_page(udst), src, chunk);
+      udst = (uint8_t *) udst + chunk;
+      src = (const uint8_t *) src + chunk;
+      size -= chunk;
+    }
+}
+
+/* Checks that the null-terminated string STR is mapped, and pins
+   it with PIN, as for check_valid_buffer(). */
+void check_valid_string (struct user_pin *pin, const void* str)
+{
+  const char *end = str;
+  while (* (char *) user_to_kernel_ptr(end) != 0)
+    {
+      end++;
+    }
+  if (!process_pin(pin, str, end + 1 - (const char *) str))
+    {
+      exit(ERROR);
     }
 }
 
@@ -0,0 +1,622 @@
+/* Benchmark workloads for fshost.
+
+   These mirror the tests/filesys/perf benchmarks, calling the
+   file system directly instead of through system calls:
+
+     seq      Sequential writes, then reads, of a 512 kB file,
+              at request sizes from 512 bytes to 64 kB.
+     seq-direct
+              The same, with direct I/O.
+     text     Sequential 4 kB writes, then reads, of a 512 kB
+              file of English-like text, stored uncompressed and
+              then compressed.  The buffer cache is flushed after
+              writing, and the file is much larger than the cache,
+              so the sector counts show the disk traffic saved.
+     clone    Duplicating files of 64 kB to 2 MB, by cloning
+              them and by copying them 64 kB at a time, and then
+              overwriting 4 kB of the duplicate.  The buffer cache
+              is flushed after each step.
+     random   Random aligned reads and writes within a 512 kB
+              file, at request sizes from 512 bytes to 16 kB.
+     create   Rounds of creating, writing, and removing 100
+              small files.
+     dir      Creating 400 files in the root directory, then
+              looking them up in random order, looking up names
+              that are absent, and removing them.
+     threads  Four threads reading and writing files of their
+              own, serialized by a lock as system calls are.
+
+   Each measurement prints a line of KEY=VALUE pairs in the
+   format of tests/filesys/perf/perf.c, except that time is
+   real time in nanoseconds ("ns" and "ns_per_op") instead of
+   timer ticks. */
+
+#include <pthread.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "fshost.h"
+#include "host.h"
+
+/* A measurement in progress. */
+struct bench 
+  {
+    const char *name;                   /* Workload name. */
+    uint64_t start_ns;                  /* Time measurement began. */
+    long long cache_hits, cache_misses; /* Cache statistics at start. */
+    unsigned long long sectors_read;    /* Device statistics at start. */
+    unsigned long long sectors_written;
+  };
+
+/* Starts measurement B of workload NAME. */
+static void
+bench_begin (struct bench *b, const char *name) 
+{
+  b->name = name;
+  cache_get_stats (&b->cache_hits, &b->cache_misses);
+  block_get_stats (fs_device, &b->sectors_read, &b->sectors_written);
+  b->start_ns = host_clock_ns ();
+}
+
+/* Ends measurement B, which performed OPS operations that
+   transferred BYTES bytes in total, and prints its summary line.
+   PARAMS, if nonnull, is a string of additional KEY=VALUE pairs
+   that identify the workload. */
+static void
+bench_end (struct bench *b, const char *params, long ops, long long bytes) 
+{
+  uint64_t ns = host_clock_ns () - b->start_ns;
+  long long hits, misses;
+  unsigned long long sectors_read, sectors_written;
+  double sec = ns > 0 ? ns / 1e9 : 1e-9;
+
+  cache_get_stats (&hits, &misses);
+  block_get_stats (fs_device, &sectors_read, &sectors_written);
+  printf ("bench=%s%s%s ops=%ld bytes=%lld ns=%llu "
+          "ops_per_sec=%.0f kb_per_sec=%.0f ns_per_op=%llu "
+          "cache_hits=%lld cache_misses=%lld "
+          "sectors_read=%llu sectors_written=%llu\n",
+          b->name, params != NULL ? " " : "", params != NULL ? params : "",
+          ops, bytes, (unsigned long long) ns,
+          ops / sec, bytes / sec / 1024,
+          ops > 0 ? (unsigned long long) ns / ops : 0,
+          hits - b->cache_hits, misses - b->cache_misses,
+          sectors_read - b->sectors_read,
+          sectors_written - b->sectors_written);
+}
+
+/* Aborts the benchmark with a message about a failed
+   operation. */
+static void
+bench_fail (const char *what, const char *name) 
+{
+  fprintf (stderr, "fshost: bench: %s \"%s\" failed\n", what, name);
+  exit (EXIT_FAILURE);
+}
+
+/* Returns a new block of SIZE bytes of random data. */
+static void *
+random_buffer (size_t size) 
+{
+  void *buf = malloc (size);
+  if (buf == NULL)
+    {
+      fprintf (stderr, "fshost: out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+  random_bytes (buf, size);
+  return buf;
+}
+
+/* Creates and opens file NAME, SIZE bytes long. */
+static struct file *
+create_file (const char *name, off_t size) 
+{
+  struct file *file;
+
+  if (!filesys_create (name, size))
+    bench_fail ("create", name);
+  file = filesys_open (name);
+  if (file == NULL)
+    bench_fail ("open", name);
+  return file;
+}
+
+/* Size of the files used by the "seq" and "random" workloads. */
+#define FILE_SIZE (512 * 1024)
+
+static void
+run_seq (bool direct) 
+{
+  static const off_t sizes[] = {512, 4096, 16384, 65536};
+  char *buf = random_buffer (65536);
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      off_t size = sizes[i];
+      struct file *file = create_file ("seq", 0);
+      struct bench b;
+      char params[64];
+      off_t ofs;
+
+      snprintf (params, sizeof params, "size=%d file_size=%d",
+                (int) size, FILE_SIZE);
+      file_set_direct (file, direct);
+
+      bench_begin (&b, direct ? "seq-write-direct" : "seq-write");
+      for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+        if (file_write (file, buf, size) != size)
+          bench_fail ("write", "seq");
+      bench_end (&b, params, FILE_SIZE / size, FILE_SIZE);
+
+      file_seek (file, 0);
+      bench_begin (&b, direct ? "seq-read-direct" : "seq-read");
+      for (ofs = 0; ofs < FILE_SIZE; ofs += size)
+        if (file_read (file, buf, size) != size)
+          bench_fail ("read", "seq");
+      bench_end (&b, params, FILE_SIZE / size, FILE_SIZE);
+
+      file_close (file);
+      if (!filesys_remove ("seq"))
+        bench_fail ("remove", "seq");
+    }
+  free (buf);
+}
+
+static void
+bench_seq (void) 
+{
+  run_seq (false);
+}
+
+static void
+bench_seq_direct (void) 
+{
+  run_seq (true);
+}
+
+/* Fills the SIZE bytes at BUF with random words separated by
+   spaces and newlines. */
+static void
+fill_text (char *buf, size_t size) 
+{
+  static const char *words[] = 
+    {
+      "the", "file", "system", "sector", "cache", "inode", "block",
+      "of", "and", "to", "a", "is", "directory", "write", "read",
+      "thread", "lock", "page", "disk", "in", "for", "that", "data",
+    };
+  size_t ofs = 0;
+
+  while (ofs < size)
+    {
+      const char *w = words[random_ulong () % (sizeof words / sizeof *words)];
+      size_t i;
+
+      for (i = 0; w[i] != '\0' && ofs < size; i++)
+        buf[ofs++] = w[i];
+      if (ofs < size)
+        buf[ofs++] = random_ulong () % 12 == 0 ? '\n' : ' ';
+    }
+}
+
+static void
+bench_text (void) 
+{
+  enum { SIZE = 4096 };
+  char *text = malloc (FILE_SIZE);
+  char *buf = malloc (SIZE);
+  int compressed;
+
+  if (text == NULL || buf == NULL)
+    bench_fail ("allocate", "text");
+  fill_text (text, FILE_SIZE);
+  for (compressed = 0; compressed <= 1; compressed++) 
+    {
+      struct file *file = create_file ("text", 0);
+      struct bench b;
+      char params[64];
+      off_t ofs;
+
+      snprintf (params, sizeof params, "compressed=%d size=%d file_size=%d",
+                compressed, SIZE, FILE_SIZE);
+      if (!file_set_compressed (file, compressed))
+        bench_fail ("compress", "text");
+
+      bench_begin (&b, "text-write");
+      for (ofs = 0; ofs < FILE_SIZE; ofs += SIZE)
+        if (file_write (file, text + ofs, SIZE) != SIZE)
+          bench_fail ("write", "text");
+      filesys_flush ();
+      bench_end (&b, params, FILE_SIZE / SIZE, FILE_SIZE);
+
+      file_seek (file, 0);
+      bench_begin (&b, "text-read");
+      for (ofs = 0; ofs < FILE_SIZE; ofs += SIZE)
+        if (file_read (file, buf, SIZE) != SIZE
+            || memcmp (buf, text + ofs, SIZE))
+          bench_fail ("read", "text");
+      bench_end (&b, params, FILE_SIZE / SIZE, FILE_SIZE);
+
+      file_close (file);
+      if (!filesys_remove ("text"))
+        bench_fail ("remove", "text");
+    }
+  free (text);
+  free (buf);
+}
+
+static void
+bench_clone (void) 
+{
+  static const off_t sizes[] = {64 * 1024, 512 * 1024, 2 * 1024 * 1024};
+  enum { CHUNK = 65536 };
+  char *buf = random_buffer (CHUNK);
+  size_t i;
+  int cloned;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    for (cloned = 0; cloned <= 1; cloned++) 
+      {
+        off_t size = sizes[i];
+        struct file *file = create_file ("orig", 0);
+        struct file *copy;
+        struct bench b;
+        char params[64];
+        off_t ofs;
+
+        snprintf (params, sizeof params, "cloned=%d file_size=%d",
+                  cloned, (int) size);
+        for (ofs = 0; ofs < size; ofs += CHUNK)
+          if (file_write (file, buf, CHUNK) != CHUNK)
+            bench_fail ("write", "orig");
+        filesys_flush ();
+
+        bench_begin (&b, "clone-dup");
+        if (cloned)
+          {
+            if (!filesys_clone ("orig", "dup"))
+              bench_fail ("clone", "orig");
+            copy = filesys_open ("dup");
+            if (copy == NULL)
+              bench_fail ("open", "dup");
+          }
+        else 
+          {
+            copy = create_file ("dup", 0);
+            file_seek (file, 0);
+            for (ofs = 0; ofs < size; ofs += CHUNK)
+              if (file_read (file, buf, CHUNK) != CHUNK
+                  || file_write (copy, buf, CHUNK) != CHUNK)
+                bench_fail ("copy", "orig");
+          }
+        filesys_flush ();
+        bench_end (&b, params, 1, size);
+
+        bench_begin (&b, "clone-write");
+        if (file_write_at (copy, buf, 4096, size / 2) != 4096)
+          bench_fail ("write", "dup");
+        filesys_flush ();
+        bench_end (&b, params, 1, 4096);
+
+        file_close (copy);
+        file_close (file);
+        if (!filesys_remove ("dup") || !filesys_remove ("orig"))
+          bench_fail ("remove", "dup");
+      }
+  free (buf);
+}
+
+static void
+bench_random (void) 
+{
+  static const off_t sizes[] = {512, 4096, 16384};
+  enum { OP_CNT = 1024 };
+  char *buf = random_buffer (16384);
+  struct file *file = create_file ("random", 0);
+  off_t ofs;
+  size_t i;
+
+  for (ofs = 0; ofs < FILE_SIZE; ofs += 16384)
+    if (file_write (file, buf, 16384) != 16384)
+      bench_fail ("write", "random");
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      off_t size = sizes[i];
+      struct bench b;
+      char params[64];
+      int op;
+
+      snprintf (params, sizeof params, "size=%d file_size=%d",
+                (int) size, FILE_SIZE);
+
+      bench_begin (&b, "random-read");
+      for (op = 0; op < OP_CNT; op++)
+        if (file_read_at (file, buf, size,
+                          random_ulong () % (FILE_SIZE / size) * size) != size)
+          bench_fail ("read", "random");
+      bench_end (&b, params, OP_CNT, (long long) OP_CNT * size);
+
+      bench_begin (&b, "random-write");
+      for (op = 0; op < OP_CNT; op++)
+        if (file_write_at (file, buf, size,
+                           random_ulong () % (FILE_SIZE / size) * size) != size)
+          bench_fail ("write", "random");
+      bench_end (&b, params, OP_CNT, (long long) OP_CNT * size);
+    }
+
+  file_close (file);
+  if (!filesys_remove ("random"))
+    bench_fail ("remove", "random");
+  free (buf);
+}
+
+static void
+bench_create (void) 
+{
+  enum { FILE_CNT = 100, ROUND_CNT = 4, SIZE = 100 };
+  char data[SIZE];
+  int round;
+
+  memset (data, 'x', sizeof data);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      struct bench b;
+      char params[64];
+      char name[16];
+      int i;
+
+      snprintf (params, sizeof params, "round=%d files=%d file_size=%d",
+                round, FILE_CNT, SIZE);
+
+      bench_begin (&b, "create");
+      for (i = 0; i < FILE_CNT; i++) 
+        {
+          struct file *file;
+
+          snprintf (name, sizeof name, "s%d", i);
+          file = create_file (name, 0);
+          if (file_write (file, data, SIZE) != SIZE)
+            bench_fail ("write", name);
+          file_close (file);
+        }
+      bench_end (&b, params, FILE_CNT, (long long) FILE_CNT * SIZE);
+
+      bench_begin (&b, "delete");
+      for (i = 0; i < FILE_CNT; i++) 
+        {
+          snprintf (name, sizeof name, "s%d", i);
+          if (!filesys_remove (name))
+            bench_fail ("remove", name);
+        }
+      bench_end (&b, params, FILE_CNT, 0);
+    }
+}
+
+static void
+bench_dir (void) 
+{
+  enum { FILE_CNT = 400 };
+  static int order[FILE_CNT];
+  struct bench b;
+  char params[64];
+  char name[16];
+  int i;
+
+  snprintf (params, sizeof params, "files=%d", FILE_CNT);
+
+  bench_begin (&b, "dir-create");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!filesys_create (name, 0))
+        bench_fail ("create", name);
+    }
+  bench_end (&b, params, FILE_CNT, 0);
+
+  for (i = 0; i < FILE_CNT; i++)
+    order[i] = i;
+  for (i = FILE_CNT - 1; i > 0; i--) 
+    {
+      int j = random_ulong () % (i + 1);
+      int t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+
+  bench_begin (&b, "dir-lookup");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      struct file *file;
+
+      snprintf (name, sizeof name, "file%d", order[i]);
+      file = filesys_open (name);
+      if (file == NULL)
+        bench_fail ("open", name);
+      file_close (file);
+    }
+  bench_end (&b, params, FILE_CNT, 0);
+
+  bench_begin (&b, "dir-lookup-miss");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "none%d", i);
+      if (filesys_open (name) != NULL)
+        bench_fail ("lookup of absent file", name);
+    }
+  bench_end (&b, params, FILE_CNT, 0);
+
+  bench_begin (&b, "dir-remove");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "file%d", order[i]);
+      if (!filesys_remove (name))
+        bench_fail ("remove", name);
+    }
+  bench_end (&b, params, FILE_CNT, 0);
+}
+
+/* The "threads" workload. */
+enum 
+  {
+    THREAD_CNT = 4,                     /* Number of threads. */
+    THREAD_OP_CNT = 256,                /* Operations per thread. */
+    THREAD_IO_SIZE = 4096,              /* Bytes per operation. */
+    THREAD_FILE_SIZE = 128 * 1024       /* Size of each file. */
+  };
+
+/* Serializes file system calls, like filesys_lock in
+   userprog/syscall.c. */
+static struct lock fs_lock;
+
+/* Reads or writes random blocks of the file named by AUX.
+   Threads with an odd-numbered file write, the others read. */
+static void *
+thread_worker (void *aux) 
+{
+  const char *name = aux;
+  bool writer = (name[strlen (name) - 1] - '0') % 2 != 0;
+  char *buf = malloc (THREAD_IO_SIZE);
+  struct file *file;
+  unsigned seed = name[strlen (name) - 1];
+  int op;
+
+  memset (buf, seed, THREAD_IO_SIZE);
+  lock_acquire (&fs_lock);
+  file = filesys_open (name);
+  lock_release (&fs_lock);
+  if (file == NULL)
+    bench_fail ("open", name);
+
+  for (op = 0; op < THREAD_OP_CNT; op++) 
+    {
+      off_t ofs;
+
+      seed = seed * 1103515245 + 12345;
+      ofs = (seed >> 8) % (THREAD_FILE_SIZE / THREAD_IO_SIZE) * THREAD_IO_SIZE;
+      lock_acquire (&fs_lock);
+      if ((writer
+           ? file_write_at (file, buf, THREAD_IO_SIZE, ofs)
+           : file_read_at (file, buf, THREAD_IO_SIZE, ofs)) != THREAD_IO_SIZE)
+        bench_fail (writer ? "write" : "read", name);
+      host_timer_advance (1);
+      lock_release (&fs_lock);
+    }
+
+  lock_acquire (&fs_lock);
+  file_close (file);
+  lock_release (&fs_lock);
+  free (buf);
+  return NULL;
+}
+
+static void
+bench_threads (void) 
+{
+  static char names[THREAD_CNT][16];
+  pthread_t threads[THREAD_CNT];
+  char *buf = random_buffer (THREAD_IO_SIZE);
+  struct bench b;
+  char params[64];
+  int i;
+
+  lock_init (&fs_lock);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct file *file;
+      off_t ofs;
+
+      snprintf (names[i], sizeof names[i], "t%d", i);
+      file = create_file (names[i], 0);
+      for (ofs = 0; ofs < THREAD_FILE_SIZE; ofs += THREAD_IO_SIZE)
+        if (file_write (file, buf, THREAD_IO_SIZE) != THREAD_IO_SIZE)
+          bench_fail ("write", names[i]);
+      file_close (file);
+    }
+
+  snprintf (params, sizeof params, "threads=%d size=%d",
+            THREAD_CNT, THREAD_IO_SIZE);
+  bench_begin (&b, "threads");
+  for (i = 0; i < THREAD_CNT; i++)
+    if (pthread_create (&threads[i], NULL, thread_worker, names[i]) != 0)
+      bench_fail ("pthread_create", names[i]);
+  for (i = 0; i < THREAD_CNT; i++)
+    pthread_join (threads[i], NULL);
+  bench_end (&b, params, (long) THREAD_CNT * THREAD_OP_CNT,
+             (long long) THREAD_CNT * THREAD_OP_CNT * THREAD_IO_SIZE);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (!filesys_remove (names[i]))
+      bench_fail ("remove", names[i]);
+  free (buf);
+}
+
+/* A benchmark workload. */
+struct workload 
+  {
+    const char *name;
+    void (*run) (void);
+  };
+
+static const struct workload workloads[] = 
+  {
+    {"seq", bench_seq},
+    {"seq-direct", bench_seq_direct},
+    {"text", bench_text},
+    {"clone", bench_clone},
+    {"random", bench_random},
+    {"create", bench_create},
+    {"dir", bench_dir},
+    {"threads", bench_threads},
+  };
+
+#define WORKLOAD_CNT (sizeof workloads / sizeof *workloads)
+
+/* Runs the workloads named in ARGV, or all of them if none are
+   named, ROUNDS times over (given by "-r ROUNDS").  Returns
+   true if successful, false if an argument is invalid. */
+bool
+bench_run (int argc, char *argv[]) 
+{
+  long rounds = 1, round;
+  bool selected[WORKLOAD_CNT];
+  bool any = false;
+  size_t w;
+  int i;
+
+  memset (selected, 0, sizeof selected);
+  for (i = 1; i < argc; i++) 
+    {
+      if (!strcmp (argv[i], "-r") && i + 1 < argc)
+        {
+          rounds = strtol (argv[++i], NULL, 10);
+          continue;
+        }
+      for (w = 0; w < WORKLOAD_CNT; w++)
+        if (!strcmp (argv[i], workloads[w].name))
+          break;
+      if (w >= WORKLOAD_CNT) 
+        {
+          fprintf (stderr, "fshost: bench: unknown workload \"%s\"\n",
+                   argv[i]);
+          return false;
+        }
+      selected[w] = any = true;
+    }
+
+  random_init (0);
+  fs_mount (true);
+  for (round = 0; round < rounds; round++)
+    for (w = 0; w < WORKLOAD_CNT; w++)
+      if (selected[w] || !any)
+        workloads[w].run ();
+  fs_unmount ();
+  return true;
+}
@@ -0,0 +1,663 @@
+/* Random operation sequences for fshost, checked against a
+   model.
+
+   Each run formats the disk, then performs a random sequence of
+   creates, removes, opens, closes, reads, writes, length
+   queries, truncations, preallocations, compression changes,
+   clones, deduplications, and defragmentations on a small set
+   of file names, through handles that switch between cached and
+   direct I/O, mirroring every one of them on an in-memory model
+   of what the file system should contain.  Writes alternate
+   between data that compresses well and data that does not.
+   Any difference between the file system's results and the
+   model's is reported along with the most recent
+   operations and the seed that reproduces the run.
+
+   Now and then the file system is unmounted and mounted again,
+   after which every file is read back in full, to check that
+   everything reached the disk.  Every so often, every file is
+   defragmented at once and read back.  The fake timer advances one
+   tick per operation, so the buffer cache's periodic flush also
+   happens at reproducible points.
+
+   Options:
+
+     -n OPS     Operations per run (default: 100000).
+     -r RUNS    Number of runs (default: 1).
+     -S SEED    Seed of the first run (default: 1).  Run I uses
+                seed SEED + I. */
+
+#include <debug.h>
+#include <random.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "fshost.h"
+#include "host.h"
+
+#define NAME_CNT 16             /* Number of distinct file names. */
+#define HANDLE_CNT 8            /* Maximum number of open files. */
+#define MAX_FILE_SIZE (192 * 1024) /* Largest file, in bytes. */
+#define MAX_IO_SIZE 8192        /* Largest read or write. */
+#define REMOUNT_INTERVAL 5000   /* Average operations per remount. */
+#define DEFRAG_INTERVAL 1000    /* Average operations per full defrag. */
+#define TRACE_CNT 32            /* Operations kept for reporting. */
+
+/* Model of a file's contents. */
+struct object 
+  {
+    uint8_t *data;              /* Contents. */
+    off_t size;                 /* Length in bytes. */
+    int open_cnt;               /* Number of handles open on it. */
+    bool linked;                /* Still has a name? */
+    bool compressed;            /* Stored compressed? */
+  };
+
+/* An open file and the model of the file it refers to. */
+struct handle 
+  {
+    struct file *file;          /* File system's file, or null. */
+    struct object *object;      /* Model. */
+  };
+
+static struct object *names[NAME_CNT];  /* Model of root directory. */
+static struct handle handles[HANDLE_CNT];
+
+/* Current run and operation. */
+static unsigned cur_seed;
+static long cur_op;
+
+/* Ring buffer of recent operations. */
+static char trace[TRACE_CNT][96];
+
+static void note (const char *, ...) PRINTF_FORMAT (1, 2);
+static void mismatch (const char *, ...) PRINTF_FORMAT (1, 2) NO_RETURN;
+
+/* Records the current operation for failure reports. */
+static void
+note (const char *format, ...) 
+{
+  va_list args;
+
+  va_start (args, format);
+  vsnprintf (trace[cur_op % TRACE_CNT], sizeof trace[0], format, args);
+  va_end (args);
+}
+
+/* Prints recent operations and the seed that reproduces them. */
+static void
+print_trace (void) 
+{
+  long op;
+
+  fprintf (stderr, "fshost: random: run with seed %u, last operations:\n",
+           cur_seed);
+  for (op = cur_op - TRACE_CNT + 1; op <= cur_op; op++)
+    if (op >= 0)
+      fprintf (stderr, "  %8ld: %s\n", op, trace[op % TRACE_CNT]);
+}
+
+/* Reports a mismatch between the file system and the model, and
+   exits. */
+static void
+mismatch (const char *format, ...) 
+{
+  va_list args;
+
+  print_trace ();
+  fprintf (stderr, "fshost: random: operation %ld: ", cur_op);
+  va_start (args, format);
+  vfprintf (stderr, format, args);
+  va_end (args);
+  fprintf (stderr, "\n");
+  exit (EXIT_FAILURE);
+}
+
+/* Returns a random number between 0 and N - 1. */
+static unsigned long
+rand_below (unsigned long n) 
+{
+  return random_ulong () % n;
+}
+
+/* Returns the file name for model index I. */
+static const char *
+name_of (int i) 
+{
+  static char name[16];
+  snprintf (name, sizeof name, "f%d", i);
+  return name;
+}
+
+/* Returns a new model file with SIZE zero bytes. */
+static struct object *
+object_create (off_t size) 
+{
+  struct object *o = calloc (1, sizeof *o);
+  if (o == NULL || (o->data = calloc (1, MAX_FILE_SIZE)) == NULL)
+    {
+      fprintf (stderr, "fshost: out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+  o->size = size;
+  o->linked = true;
+  return o;
+}
+
+/* Frees model file O if nothing refers to it any more. */
+static void
+object_release (struct object *o) 
+{
+  if (!o->linked && o->open_cnt == 0)
+    {
+      free (o->data);
+      free (o);
+    }
+}
+
+/* Checks that FILE's contents match model O. */
+static void
+verify_file (struct file *file, struct object *o, const char *name) 
+{
+  static uint8_t buf[MAX_FILE_SIZE + 1];
+  off_t n, i;
+
+  if (file_length (file) != o->size)
+    mismatch ("\"%s\" has length %d, model says %d",
+              name, (int) file_length (file), (int) o->size);
+  n = file_read_at (file, buf, o->size + 1, 0);
+  if (n != o->size)
+    mismatch ("reading all of \"%s\" returned %d bytes, model says %d",
+              name, (int) n, (int) o->size);
+  for (i = 0; i < n; i++)
+    if (buf[i] != o->data[i])
+      mismatch ("\"%s\" byte %d is %02x, model says %02x",
+                name, (int) i, buf[i], o->data[i]);
+}
+
+/* Checks that the root directory contains exactly the files in
+   the model, with the right contents. */
+static void
+verify_all (void) 
+{
+  int i;
+
+  for (i = 0; i < NAME_CNT; i++) 
+    {
+      struct file *file = filesys_open (name_of (i));
+      if ((file != NULL) != (names[i] != NULL))
+        mismatch ("\"%s\" %s, model says it %s", name_of (i),
+                  file != NULL ? "exists" : "does not exist",
+                  names[i] != NULL ? "does" : "does not");
+      if (file != NULL) 
+        {
+          verify_file (file, names[i], name_of (i));
+          file_close (file);
+        }
+    }
+}
+
+/* Closes handle H. */
+static void
+close_handle (struct handle *h) 
+{
+  file_close (h->file);
+  h->file = NULL;
+  h->object->open_cnt--;
+  object_release (h->object);
+}
+
+/* Returns a random open handle, or a null pointer if none are
+   open. */
+static struct handle *
+random_open_handle (void) 
+{
+  int start = rand_below (HANDLE_CNT);
+  int i;
+
+  for (i = 0; i < HANDLE_CNT; i++) 
+    {
+      struct handle *h = &handles[(start + i) % HANDLE_CNT];
+      if (h->file != NULL)
+        return h;
+    }
+  return NULL;
+}
+
+static void
+op_create (void) 
+{
+  int i = rand_below (NAME_CNT);
+  off_t size = rand_below (4) == 0 ? (off_t) rand_below (MAX_FILE_SIZE / 8) : 0;
+  bool compressed = size == 0 && rand_below (2);
+  bool ok;
+
+  note ("create \"%s\" %d%s", name_of (i), (int) size,
+        compressed ? " compressed" : "");
+  ok = filesys_create (name_of (i), size);
+  if (ok != (names[i] == NULL))
+    mismatch ("create \"%s\" returned %s", name_of (i), ok ? "true" : "false");
+  if (!ok)
+    return;
+  names[i] = object_create (size);
+  if (compressed)
+    {
+      struct file *file = filesys_open (name_of (i));
+      if (file == NULL || !file_set_compressed (file, true))
+        mismatch ("compressing new file \"%s\" failed", name_of (i));
+      file_close (file);
+      names[i]->compressed = true;
+    }
+}
+
+/* Clones one file as another, which must not exist yet. */
+static void
+op_clone (void) 
+{
+  int i = rand_below (NAME_CNT);
+  int j = rand_below (NAME_CNT);
+  char name[16];
+  bool ok;
+
+  /* name_of() returns a static buffer. */
+  strlcpy (name, name_of (i), sizeof name);
+  note ("clone \"%s\" as \"%s\"", name, name_of (j));
+  ok = filesys_clone (name, name_of (j));
+  if (ok != (names[i] != NULL && names[j] == NULL))
+    mismatch ("clone \"%s\" as \"%s\" returned %s",
+              name, name_of (j), ok ? "true" : "false");
+  if (!ok)
+    return;
+  names[j] = object_create (names[i]->size);
+  memcpy (names[j]->data, names[i]->data, names[i]->size);
+  names[j]->compressed = names[i]->compressed;
+}
+
+static void
+op_remove (void) 
+{
+  int i = rand_below (NAME_CNT);
+  bool ok;
+
+  note ("remove \"%s\"", name_of (i));
+  ok = filesys_remove (name_of (i));
+  if (ok != (names[i] != NULL))
+    mismatch ("remove \"%s\" returned %s", name_of (i), ok ? "true" : "false");
+  if (ok) 
+    {
+      names[i]->linked = false;
+      object_release (names[i]);
+      names[i] = NULL;
+    }
+}
+
+static void
+op_open (void) 
+{
+  int i = rand_below (NAME_CNT);
+  struct handle *h;
+  struct file *file;
+
+  for (h = handles; h < handles + HANDLE_CNT; h++)
+    if (h->file == NULL)
+      break;
+  if (h >= handles + HANDLE_CNT)
+    return;
+
+  note ("open \"%s\" as %d", name_of (i), (int) (h - handles));
+  file = filesys_open (name_of (i));
+  if ((file != NULL) != (names[i] != NULL))
+    mismatch ("open \"%s\" %s", name_of (i),
+              file != NULL ? "succeeded" : "failed");
+  if (file != NULL) 
+    {
+      h->file = file;
+      h->object = names[i];
+      h->object->open_cnt++;
+    }
+}
+
+static void
+op_close (void) 
+{
+  struct handle *h = random_open_handle ();
+
+  if (h != NULL) 
+    {
+      note ("close %d", (int) (h - handles));
+      close_handle (h);
+    }
+}
+
+static void
+op_write (void) 
+{
+  static uint8_t buf[MAX_IO_SIZE];
+  struct handle *h = random_open_handle ();
+  struct object *o;
+  off_t size, ofs, n, i;
+
+  if (h == NULL)
+    return;
+  o = h->object;
+  size = rand_below (MAX_IO_SIZE) + 1;
+  ofs = rand_below (o->size + BLOCK_SECTOR_SIZE * 4 < MAX_FILE_SIZE - size
+                    ? o->size + BLOCK_SECTOR_SIZE * 4
+                    : MAX_FILE_SIZE - size);
+  if (rand_below (2))
+    for (i = 0; i < size; i++)
+      buf[i] = cur_op * 7 + i;
+  else
+    for (i = 0; i < size; i++)
+      buf[i] = random_ulong ();
+
+  note ("write %d at %d to %d (length %d)",
+        (int) size, (int) ofs, (int) (h - handles), (int) o->size);
+  n = file_write_at (h->file, buf, size, ofs);
+  if (n != size)
+    mismatch ("write of %d bytes at %d returned %d",
+              (int) size, (int) ofs, (int) n);
+  memcpy (o->data + ofs, buf, size);
+  if (ofs + size > o->size)
+    o->size = ofs + size;
+}
+
+static void
+op_read (void) 
+{
+  static uint8_t buf[MAX_IO_SIZE];
+  struct handle *h = random_open_handle ();
+  struct object *o;
+  off_t size, ofs, n, expect, i;
+
+  if (h == NULL)
+    return;
+  o = h->object;
+  size = rand_below (MAX_IO_SIZE) + 1;
+  ofs = rand_below (o->size + BLOCK_SECTOR_SIZE);
+  expect = ofs < o->size ? o->size - ofs : 0;
+  if (expect > size)
+    expect = size;
+
+  note ("read %d at %d from %d (length %d)",
+        (int) size, (int) ofs, (int) (h - handles), (int) o->size);
+  n = file_read_at (h->file, buf, size, ofs);
+  if (n != expect)
+    mismatch ("read of %d bytes at %d returned %d, model says %d",
+              (int) size, (int) ofs, (int) n, (int) expect);
+  for (i = 0; i < n; i++)
+    if (buf[i] != o->data[ofs + i])
+      mismatch ("read at %d: byte %d is %02x, model says %02x",
+                (int) ofs, (int) (ofs + i), buf[i], o->data[ofs + i]);
+}
+
+static void
+op_length (void) 
+{
+  struct handle *h = random_open_handle ();
+
+  if (h != NULL) 
+    {
+      note ("length of %d", (int) (h - handles));
+      if (file_length (h->file) != h->object->size)
+        mismatch ("length is %d, model says %d",
+                  (int) file_length (h->file), (int) h->object->size);
+    }
+}
+
+/* Sets a file's length, usually shrinking it. */
+static void
+op_truncate (void) 
+{
+  struct handle *h = random_open_handle ();
+  struct object *o;
+  off_t length;
+
+  if (h == NULL)
+    return;
+  o = h->object;
+  length = rand_below (4) == 0 ? (off_t) rand_below (MAX_FILE_SIZE + 1)
+                               : (off_t) rand_below (o->size + 1);
+  if (rand_below (4) == 0)
+    length -= length % 4096;
+
+  note ("truncate %d to %d (length %d)",
+        (int) (h - handles), (int) length, (int) o->size);
+  if (!file_truncate (h->file, length))
+    mismatch ("truncate to %d failed", (int) length);
+  if (length < o->size)
+    memset (o->data + length, 0, o->size - length);
+  o->size = length;
+}
+
+/* Preallocates a range of a file, which may extend it. */
+static void
+op_allocate (void) 
+{
+  struct handle *h = random_open_handle ();
+  struct object *o;
+  off_t ofs, len;
+
+  if (h == NULL)
+    return;
+  o = h->object;
+  ofs = rand_below (o->size + MAX_IO_SIZE);
+  len = rand_below (MAX_IO_SIZE * 4) + 1;
+  if (ofs + len > MAX_FILE_SIZE)
+    len = MAX_FILE_SIZE - ofs;
+  if (len <= 0)
+    return;
+
+  note ("allocate %d at %d in %d (length %d)",
+        (int) len, (int) ofs, (int) (h - handles), (int) o->size);
+  if (!file_allocate (h->file, ofs, len))
+    mismatch ("allocate of %d bytes at %d failed", (int) len, (int) ofs);
+  if (ofs + len > o->size)
+    o->size = ofs + len;
+}
+
+/* Tries to switch a file between compressed and uncompressed
+   storage, which only works while it is empty. */
+static void
+op_compress (void) 
+{
+  struct handle *h = random_open_handle ();
+  struct object *o;
+  bool compressed, ok;
+
+  if (h == NULL)
+    return;
+  o = h->object;
+  compressed = !o->compressed;
+  note ("set %d %s (length %d)", (int) (h - handles),
+        compressed ? "compressed" : "uncompressed", (int) o->size);
+  ok = file_set_compressed (h->file, compressed);
+  if (ok != (o->size == 0))
+    mismatch ("setting compression returned %s", ok ? "true" : "false");
+  if (file_is_compressed (h->file) != (ok ? compressed : o->compressed))
+    mismatch ("file is %scompressed, model says otherwise",
+              file_is_compressed (h->file) ? "" : "not ");
+  if (ok)
+    o->compressed = compressed;
+}
+
+/* Switches a handle between cached and direct I/O. */
+static void
+op_direct (void) 
+{
+  struct handle *h = random_open_handle ();
+
+  if (h != NULL) 
+    {
+      bool direct = !file_is_direct (h->file);
+      note ("set %d %s", (int) (h - handles), direct ? "direct" : "cached");
+      file_set_direct (h->file, direct);
+    }
+}
+
+static void
+op_defrag (void) 
+{
+  int i = rand_below (NAME_CNT);
+  int moved;
+
+  note ("defrag \"%s\"", name_of (i));
+  moved = filesys_defrag (name_of (i));
+  if (names[i] == NULL ? moved != -1 : moved != 0 && moved != 1)
+    mismatch ("defrag \"%s\" returned %d", name_of (i), moved);
+  if (names[i] != NULL) 
+    {
+      struct file *file = filesys_open (name_of (i));
+      if (file == NULL)
+        mismatch ("open \"%s\" failed after defrag", name_of (i));
+      verify_file (file, names[i], name_of (i));
+      file_close (file);
+    }
+}
+
+/* Shares identical sectors between files.  Later reads and
+   remounts check that no file changed. */
+static void
+op_dedup (void) 
+{
+  note ("dedup");
+  if (filesys_dedup () < 0)
+    mismatch ("dedup failed");
+}
+
+/* Defragments every file, then checks every file. */
+static void
+op_defrag_all (void) 
+{
+  int moved;
+
+  note ("defrag all");
+  moved = filesys_defrag (NULL);
+  if (moved < 0)
+    mismatch ("defrag of all files returned %d", moved);
+  verify_all ();
+}
+
+/* Closes every handle, remounts the file system, and checks
+   every file. */
+static void
+op_remount (void) 
+{
+  int i;
+
+  note ("remount");
+  for (i = 0; i < HANDLE_CNT; i++)
+    if (handles[i].file != NULL)
+      close_handle (&handles[i]);
+  fs_unmount ();
+  fs_mount (false);
+  verify_all ();
+}
+
+/* An operation and its relative frequency. */
+struct op 
+  {
+    void (*run) (void);
+    int weight;
+  };
+
+static const struct op ops[] = 
+  {
+    {op_create, 10},
+    {op_remove, 6},
+    {op_clone, 4},
+    {op_open, 10},
+    {op_close, 8},
+    {op_write, 30},
+    {op_read, 30},
+    {op_length, 6},
+    {op_truncate, 4},
+    {op_allocate, 4},
+    {op_compress, 4},
+    {op_defrag, 2},
+    {op_dedup, 1},
+    {op_direct, 4},
+  };
+
+#define OP_CNT (sizeof ops / sizeof *ops)
+
+/* Runs OP_CNT random operations from SEED on a freshly
+   formatted file system. */
+static void
+run (unsigned seed, long op_cnt) 
+{
+  int weight_sum = 0;
+  size_t k;
+  int i;
+
+  for (k = 0; k < OP_CNT; k++)
+    weight_sum += ops[k].weight;
+
+  cur_seed = seed;
+  random_init (seed);
+  fs_mount (true);
+  for (cur_op = 0; cur_op < op_cnt; cur_op++) 
+    {
+      if (rand_below (REMOUNT_INTERVAL) == 0)
+        op_remount ();
+      else if (rand_below (DEFRAG_INTERVAL) == 0)
+        op_defrag_all ();
+      else
+        {
+          int w = rand_below (weight_sum);
+          for (k = 0; w >= ops[k].weight; k++)
+            w -= ops[k].weight;
+          ops[k].run ();
+        }
+      host_timer_advance (1);
+    }
+
+  note ("final check");
+  op_remount ();
+  for (i = 0; i < NAME_CNT; i++)
+    if (names[i] != NULL) 
+      {
+        names[i]->linked = false;
+        object_release (names[i]);
+        names[i] = NULL;
+      }
+  fs_unmount ();
+}
+
+/* Runs the "random" command with the given arguments.  Returns
+   true if every run passes.  On a mismatch, exits after
+   reporting it. */
+bool
+check_run (int argc, char *argv[]) 
+{
+  long op_cnt = 100000;
+  long run_cnt = 1;
+  unsigned seed = 1;
+  uint64_t start;
+  long r;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    if (!strcmp (argv[i], "-n") && i + 1 < argc)
+      op_cnt = strtol (argv[++i], NULL, 10);
+    else if (!strcmp (argv[i], "-r") && i + 1 < argc)
+      run_cnt = strtol (argv[++i], NULL, 10);
+    else if (!strcmp (argv[i], "-S") && i + 1 < argc)
+      seed = strtoul (argv[++i], NULL, 10);
+    else 
+      {
+        fprintf (stderr, "fshost: random: bad argument \"%s\"\n", argv[i]);
+        return false;
+      }
+
+  host_panic_hook = print_trace;
+  start = host_clock_ns ();
+  for (r = 0; r < run_cnt; r++)
+    run (seed + r, op_cnt);
+  printf ("random: %ld runs of %ld operations passed in %.1f s\n",
+          run_cnt, op_cnt, (host_clock_ns () - start) / 1e9);
+  return true;
+}
@@ -0,0 +1,209 @@
+/* fshost: runs the Pintos file system as a host program.
+
+   The sources in filesys/ and lib/kernel/ are compiled
+   unchanged against host.c, which stands in for the block
+   layer, timer, locks, and panic handling, with the file system
+   device kept in an ordinary file.  That makes the file system
+   quick to profile with native tools and to exercise with far
+   more operations than fit in a simulator run.
+
+   Usage: fshost [-d DISK] [-s MB] [-b SECTORS] COMMAND [ARG...]
+
+   DISK (default: fshost.dsk) is resized to MB megabytes if -s
+   is given or if DISK does not exist yet (default: 8).  A
+   command that formats DISK gives it blocks of SECTORS sectors
+   (default: 1).  The commands are:
+
+     bench [-r ROUNDS] [WORKLOAD...]
+       Runs benchmark workloads and prints one line of
+       KEY=VALUE measurements for each, in the format of the
+       tests/filesys/perf benchmarks.  See bench.c.
+
+     random [-n OPS] [-r RUNS] [-S SEED]
+       Runs random sequences of file system operations and
+       checks every result against a model.  See check.c.
+
+     layout
+       Prints the layout of the file system already on DISK,
+       which may be an image written by pintos-mkfs, and exits
+       with failure if its metadata is inconsistent.  See
+       filesys/layout.c.
+
+     defrag [FILE...]
+       Defragments each FILE on DISK, or if none is given,
+       defragments every file and compacts free space.  See
+       filesys_defrag().
+
+     dedup
+       Makes identical data blocks of the files on DISK share
+       a single block.  See filesys_dedup().
+
+   Commands other than layout, defrag and dedup format DISK
+   first. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/layout.h"
+#include "fshost.h"
+#include "host.h"
+
+/* Default disk size in megabytes. */
+#define DEFAULT_DISK_MB 8
+
+static bool layout_run (void);
+static bool defrag_run (int argc, char *argv[]);
+static bool dedup_run (void);
+static void usage (void);
+
+int
+main (int argc, char *argv[]) 
+{
+  const char *disk_name = "fshost.dsk";
+  unsigned long disk_mb = 0;
+  bool ok;
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+      if (!strcmp (argv[i], "-d") && i + 1 < argc)
+        disk_name = argv[++i];
+      else if (!strcmp (argv[i], "-s") && i + 1 < argc)
+        disk_mb = strtoul (argv[++i], NULL, 10);
+      else if (!strcmp (argv[i], "-b") && i + 1 < argc)
+        {
+          fs_block_sectors = strtoul (argv[++i], NULL, 10);
+          if (fs_block_sectors < 1 || fs_block_sectors > MAX_BLOCK_SECTORS)
+            usage ();
+        }
+      else
+        usage ();
+    }
+  if (i >= argc)
+    usage ();
+
+  if (disk_mb == 0) 
+    {
+      FILE *probe = fopen (disk_name, "rb");
+      if (probe != NULL)
+        fclose (probe);
+      else if (!strcmp (argv[i], "layout") || !strcmp (argv[i], "defrag")
+               || !strcmp (argv[i], "dedup"))
+        {
+          fprintf (stderr, "%s: no such disk\n", disk_name);
+          return EXIT_FAILURE;
+        }
+      else
+        disk_mb = DEFAULT_DISK_MB;
+    }
+  if (!host_disk_open (disk_name, disk_mb * 1024 * 1024 / BLOCK_SECTOR_SIZE))
+    return EXIT_FAILURE;
+
+  if (!strcmp (argv[i], "bench"))
+    ok = bench_run (argc - i, argv + i);
+  else if (!strcmp (argv[i], "random"))
+    ok = check_run (argc - i, argv + i);
+  else if (!strcmp (argv[i], "layout"))
+    ok = layout_run ();
+  else if (!strcmp (argv[i], "defrag"))
+    ok = defrag_run (argc - i, argv + i);
+  else if (!strcmp (argv[i], "dedup"))
+    ok = dedup_run ();
+  else
+    usage ();
+
+  host_disk_close ();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Mounts the file system, first formatting it if FORMAT is
+   true. */
+void
+fs_mount (bool format) 
+{
+  filesys_init (format);
+}
+
+/* Unmounts the file system, writing all of its data to the
+   disk.  No files may be open. */
+void
+fs_unmount (void) 
+{
+  filesys_done ();
+}
+
+/* Prints the layout of the file system on the disk.  Returns
+   true if it is consistent. */
+static bool
+layout_run (void) 
+{
+  bool ok;
+
+  fs_mount (false);
+  ok = layout_print ();
+  fs_unmount ();
+  return ok;
+}
+
+/* Defragments the files named in ARGV[1...], or every file if
+   there are none.  Returns true if successful. */
+static bool
+defrag_run (int argc, char *argv[]) 
+{
+  bool ok = true;
+  int i;
+
+  fs_mount (false);
+  if (argc < 2)
+    printf ("defrag: %d moves\n", filesys_defrag (NULL));
+  for (i = 1; i < argc; i++) 
+    {
+      int moved = filesys_defrag (argv[i]);
+      if (moved < 0)
+        {
+          fprintf (stderr, "defrag: %s: no such file\n", argv[i]);
+          ok = false;
+        }
+      else
+        printf ("defrag: %s: %s\n", argv[i], moved ? "moved" : "not moved");
+    }
+  fs_unmount ();
+  return ok;
+}
+
+/* Deduplicates the files on the disk.  Returns true if
+   successful. */
+static bool
+dedup_run (void) 
+{
+  int merged;
+
+  fs_mount (false);
+  merged = filesys_dedup ();
+  if (merged >= 0)
+    printf ("dedup: %d blocks merged\n", merged);
+  else
+    fprintf (stderr, "dedup: out of memory\n");
+  fs_unmount ();
+  return merged >= 0;
+}
+
+static void
+usage (void) 
+{
+  fprintf (stderr,
+           "usage: fshost [-d DISK] [-s MB] [-b SECTORS] COMMAND [ARG...]\n"
+           "Runs the Pintos file system on the host, on a disk kept in\n"
+           "file DISK (default: fshost.dsk) of MB megabytes.  Commands\n"
+           "other than layout, defrag and dedup format DISK first, with\n"
+           "blocks of SECTORS sectors (1 to 8, default: 1).\n"
+           "Commands:\n"
+           "  bench [-r ROUNDS] [WORKLOAD...]  run benchmark workloads\n"
+           "  random [-n OPS] [-r RUNS] [-S SEED]\n"
+           "                                   check random operations\n"
+           "  layout                           report disk layout\n"
+           "  defrag [FILE...]                 defragment files\n"
+           "  dedup                            share identical blocks\n");
+  exit (EXIT_FAILURE);
+}
@@ -0,0 +1,16 @@
+#ifndef FSHOST_FSHOST_H
+#define FSHOST_FSHOST_H
+
+#include <stdbool.h>
+
+/* fshost.c. */
+void fs_mount (bool format);
+void fs_unmount (void);
+
+/* bench.c. */
+bool bench_run (int argc, char *argv[]);
+
+/* check.c. */
+bool check_run (int argc, char *argv[]);
+
+#endif /* fshost/fshost.h */
@@ -0,0 +1,508 @@
+/* Host implementations of the kernel services that filesys/
+   depends on.  See host.h. */
+
+#define _XOPEN_SOURCE 700
+
+#include "host.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/synch.h"
+
+/* Block devices. */
+
+/* A block device backed by a host file. */
+struct block
+  {
+    char name[16];                      /* Block device name. */
+    enum block_type type;               /* Type of block device. */
+    block_sector_t size;                /* Size in sectors. */
+    int fd;                             /* Host file descriptor. */
+    unsigned long long read_cnt;        /* Number of sectors read. */
+    unsigned long long write_cnt;       /* Number of sectors written. */
+  };
+
+/* The block device that fulfills each role. */
+static struct block *block_by_role[BLOCK_ROLE_CNT];
+
+/* Opens FILE_NAME, creating it if necessary, and makes it the
+   file system device.  If SIZE is nonzero, the file is first
+   resized to SIZE sectors; otherwise its existing size is used,
+   rounded down to a whole number of sectors.  Returns true if
+   successful, false after printing a message on failure. */
+bool
+host_disk_open (const char *file_name, block_sector_t size)
+{
+  struct block *block;
+  off_t file_size;
+  int fd;
+
+  ASSERT (block_by_role[BLOCK_FILESYS] == NULL);
+
+  fd = open (file_name, O_RDWR | O_CREAT, 0666);
+  if (fd < 0)
+    {
+      fprintf (stderr, "%s: open: %s\n", file_name, strerror (errno));
+      return false;
+    }
+  if (size != 0 && ftruncate (fd, (off_t) size * BLOCK_SECTOR_SIZE) < 0)
+    {
+      fprintf (stderr, "%s: truncate: %s\n", file_name, strerror (errno));
+      close (fd);
+      return false;
+    }
+  file_size = lseek (fd, 0, SEEK_END);
+  if (file_size < BLOCK_SECTOR_SIZE)
+    {
+      fprintf (stderr, "%s: too small to hold a file system\n", file_name);
+      close (fd);
+      return false;
+    }
+
+  block = calloc (1, sizeof *block);
+  if (block == NULL)
+    PANIC ("out of memory");
+  strlcpy (block->name, "hdb1", sizeof block->name);
+  block->type = BLOCK_FILESYS;
+  block->size = file_size / BLOCK_SECTOR_SIZE;
+  block->fd = fd;
+  block_by_role[BLOCK_FILESYS] = block;
+  return true;
+}
+
+/* Closes the file system device. */
+void
+host_disk_close (void)
+{
+  struct block *block = block_by_role[BLOCK_FILESYS];
+
+  if (block != NULL)
+    {
+      close (block->fd);
+      free (block);
+      block_by_role[BLOCK_FILESYS] = NULL;
+    }
+}
+
+/* Returns a human-readable name for the given block device
+   TYPE. */
+const char *
+block_type_name (enum block_type type)
+{
+  static const char *block_type_names[BLOCK_CNT] =
+    {
+      "kernel",
+      "filesys",
+      "scratch",
+      "swap",
+      "raw",
+      "foreign",
+    };
+
+  ASSERT (type < BLOCK_CNT);
+  return block_type_names[type];
+}
+
+/* Returns the block device fulfilling the given ROLE, or a null
+   pointer if no block device has been assigned that role. */
+struct block *
+block_get_role (enum block_type role)
+{
+  ASSERT (role < BLOCK_ROLE_CNT);
+  return block_by_role[role];
+}
+
+/* Assigns BLOCK the given ROLE. */
+void
+block_set_role (enum block_type role, struct block *block)
+{
+  ASSERT (role < BLOCK_ROLE_CNT);
+  block_by_role[role] = block;
+}
+
+/* Verifies that SECTOR is a valid offset within BLOCK.
+   Panics if not. */
+static void
+check_sector (struct block *block, block_sector_t sector)
+{
+  if (sector >= block->size)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", "
+           "size=%"PRDSNu")\n", block->name, sector, block->size);
+}
+
+/* Reads sector SECTOR from BLOCK into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+void
+block_read (struct block *block, block_sector_t sector, void *buffer)
+{
+  check_sector (block, sector);
+  if (pread (block->fd, buffer, BLOCK_SECTOR_SIZE,
+             (off_t) sector * BLOCK_SECTOR_SIZE) != BLOCK_SECTOR_SIZE)
+    PANIC ("%s: read of sector %"PRDSNu" failed", block->name, sector);
+  block->read_cnt++;
+}
+
+/* Write sector SECTOR to BLOCK from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes. */
+void
+block_write (struct block *block, block_sector_t sector, const void *buffer)
+{
+  check_sector (block, sector);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (pwrite (block->fd, buffer, BLOCK_SECTOR_SIZE,
+              (off_t) sector * BLOCK_SECTOR_SIZE) != BLOCK_SECTOR_SIZE)
+    PANIC ("%s: write of sector %"PRDSNu" failed", block->name, sector);
+  block->write_cnt++;
+}
+
+/* Reads CNT sectors starting at SECTOR from BLOCK into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector + cnt - 1);
+  if (pread (block->fd, buffer, size, (off_t) sector * BLOCK_SECTOR_SIZE)
+      != (ssize_t) size)
+    PANIC ("%s: read of sectors %"PRDSNu"+%zu failed",
+           block->name, sector, cnt);
+  block->read_cnt += cnt;
+}
+
+/* Writes CNT sectors starting at SECTOR to BLOCK from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (pwrite (block->fd, buffer, size, (off_t) sector * BLOCK_SECTOR_SIZE)
+      != (ssize_t) size)
+    PANIC ("%s: write of sectors %"PRDSNu"+%zu failed",
+           block->name, sector, cnt);
+  block->write_cnt += cnt;
+}
+
+/* Returns the number of sectors in BLOCK. */
+block_sector_t
+block_size (struct block *block)
+{
+  return block->size;
+}
+
+/* Returns BLOCK's name (e.g. "hda"). */
+const char *
+block_name (struct block *block)
+{
+  return block->name;
+}
+
+/* Returns BLOCK's type. */
+enum block_type
+block_type (struct block *block)
+{
+  return block->type;
+}
+
+/* Stores the number of sectors read from and written to BLOCK
+   into *READ_CNT and *WRITE_CNT. */
+void
+block_get_stats (struct block *block, unsigned long long *read_cnt,
+                 unsigned long long *write_cnt)
+{
+  *read_cnt = block->read_cnt;
+  *write_cnt = block->write_cnt;
+}
+
+/* Prints statistics for each block device used for a Pintos role. */
+void
+block_print_stats (void)
+{
+  int i;
+
+  for (i = 0; i < BLOCK_ROLE_CNT; i++)
+    {
+      struct block *block = block_by_role[i];
+      if (block != NULL)
+        printf ("%s (%s): %llu reads, %llu writes\n",
+                block->name, block_type_name (block->type),
+                block->read_cnt, block->write_cnt);
+    }
+}
+
+/* Timer. */
+
+/* Number of ticks the fake timer has been advanced. */
+static int64_t ticks;
+
+/* Advances the fake timer by TICKS. */
+void
+host_timer_advance (int64_t ticks_)
+{
+  ticks += ticks_;
+}
+
+/* Returns the number of timer ticks so far. */
+int64_t
+timer_ticks (void) 
+{
+  return ticks;
+}
+
+/* Returns the number of timer ticks elapsed since THEN, which
+   should be a value once returned by timer_ticks(). */
+int64_t
+timer_elapsed (int64_t then) 
+{
+  return timer_ticks () - then;
+}
+
+/* Returns a monotonic real time in nanoseconds. */
+uint64_t
+host_clock_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Synchronization. */
+
+/* Initializes LOCK. */
+void
+lock_init (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+  pthread_mutex_init (&lock->mutex, NULL);
+  lock->held = false;
+}
+
+/* Acquires LOCK, sleeping until it becomes available if
+   necessary.  The lock must not already be held by the current
+   thread. */
+void
+lock_acquire (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  pthread_mutex_lock (&lock->mutex);
+  lock->holder = pthread_self ();
+  lock->held = true;
+}
+
+/* Tries to acquire LOCK and returns true if successful or false
+   on failure.  The lock must not already be held by the current
+   thread. */
+bool
+lock_try_acquire (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  if (pthread_mutex_trylock (&lock->mutex) != 0)
+    return false;
+  lock->holder = pthread_self ();
+  lock->held = true;
+  return true;
+}
+
+/* Releases LOCK, which must be owned by the current thread. */
+void
+lock_release (struct lock *lock) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (lock_held_by_current_thread (lock));
+
+  lock->held = false;
+  pthread_mutex_unlock (&lock->mutex);
+}
+
+/* Returns true if the current thread holds LOCK, false
+   otherwise.  (Note that testing whether some other thread holds
+   a lock would be racy.) */
+bool
+lock_held_by_current_thread (const struct lock *lock) 
+{
+  ASSERT (lock != NULL);
+
+  return lock->held && pthread_equal (lock->holder, pthread_self ());
+}
+
+/* Initializes condition variable COND. */
+void
+cond_init (struct condition *cond)
+{
+  ASSERT (cond != NULL);
+  pthread_cond_init (&cond->cond, NULL);
+}
+
+/* Atomically releases LOCK and waits for COND to be signaled by
+   some other piece of code, then reacquires LOCK before
+   returning.  LOCK must be held before calling this function. */
+void
+cond_wait (struct condition *cond, struct lock *lock) 
+{
+  ASSERT (cond != NULL);
+  ASSERT (lock_held_by_current_thread (lock));
+
+  lock->held = false;
+  pthread_cond_wait (&cond->cond, &lock->mutex);
+  lock->holder = pthread_self ();
+  lock->held = true;
+}
+
+/* If any threads are waiting on COND (protected by LOCK), then
+   this function signals one of them to wake up from its wait.
+   LOCK must be held before calling this function. */
+void
+cond_signal (struct condition *cond, struct lock *lock) 
+{
+  ASSERT (cond != NULL);
+  ASSERT (lock_held_by_current_thread (lock));
+
+  pthread_cond_signal (&cond->cond);
+}
+
+/* Wakes up all threads, if any, waiting on COND (protected by
+   LOCK).  LOCK must be held before calling this function. */
+void
+cond_broadcast (struct condition *cond, struct lock *lock) 
+{
+  ASSERT (cond != NULL);
+  ASSERT (lock_held_by_current_thread (lock));
+
+  pthread_cond_broadcast (&cond->cond);
+}
+
+/* Debugging. */
+
+void (*host_panic_hook) (void);
+
+/* Prints the file name, line number, function name, and the
+   formatted MESSAGE, calls host_panic_hook if set, and aborts
+   so that a debugger or core dump can take over. */
+void
+debug_panic (const char *file, int line, const char *function,
+             const char *message, ...) 
+{
+  va_list args;
+
+  fflush (stdout);
+  fprintf (stderr, "PANIC at %s:%d in %s(): ", file, line, function);
+  va_start (args, message);
+  vfprintf (stderr, message, args);
+  va_end (args);
+  fprintf (stderr, "\n");
+
+  if (host_panic_hook != NULL)
+    host_panic_hook ();
+  abort ();
+}
+
+/* Library extensions. */
+
+/* Copies string SRC to DST, truncating it to fit in SIZE bytes
+   including the null terminator.  Returns strlen(SRC).  See
+   lib/string.c. */
+size_t
+strlcpy (char *dst, const char *src, size_t size) 
+{
+  size_t src_len = strlen (src);
+
+  if (size > 0) 
+    {
+      size_t dst_len = size - 1;
+      if (src_len < dst_len)
+        dst_len = src_len;
+      memcpy (dst, src, dst_len);
+      dst[dst_len] = '\0';
+    }
+  return src_len;
+}
+
+/* Concatenates string SRC to DST, truncating the result to fit
+   in SIZE bytes including the null terminator.  Returns the
+   length the result would have had without truncation.  See
+   lib/string.c. */
+size_t
+strlcat (char *dst, const char *src, size_t size) 
+{
+  size_t src_len = strlen (src);
+  size_t dst_len = strlen (dst);
+
+  if (size > 0 && dst_len < size) 
+    {
+      size_t copy_cnt = size - dst_len - 1;
+      if (src_len < copy_cnt)
+        copy_cnt = src_len;
+      memcpy (dst + dst_len, src, copy_cnt);
+      dst[dst_len + copy_cnt] = '\0';
+    }
+  return src_len + dst_len;
+}
+
+/* Dumps the SIZE bytes in BUF to the console as hex bytes
+   arranged 16 per line, numbering them starting at OFS.  If
+   ASCII is true, printable characters are shown alongside.  See
+   lib/stdio.c. */
+void
+hex_dump (uintptr_t ofs, const void *buf_, size_t size, bool ascii)
+{
+  const uint8_t *buf = buf_;
+  const size_t per_line = 16;
+
+  while (size > 0)
+    {
+      size_t start, end, n;
+      size_t i;
+      
+      start = ofs % per_line;
+      end = per_line;
+      if (end - start > size)
+        end = start + size;
+      n = end - start;
+
+      printf ("%08jx  ", (uintmax_t) (ofs - start));
+      for (i = 0; i < start; i++)
+        printf ("   ");
+      for (; i < end; i++) 
+        printf ("%02hhx%c", buf[i - start], i == per_line / 2 - 1 ? '-' : ' ');
+      if (ascii) 
+        {
+          for (; i < per_line; i++)
+            printf ("   ");
+          printf ("|");
+          for (i = 0; i < start; i++)
+            printf (" ");
+          for (; i < end; i++)
+            printf ("%c", isprint (buf[i - start]) ? buf[i - start] : '.');
+          for (; i < per_line; i++)
+            printf (" ");
+          printf ("|");
+        }
+      printf ("\n");
+
+      ofs += n;
+      buf += n;
+      size -= n;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef FSHOST_HOST_H
+#define FSHOST_HOST_H
+
+/* Host environment for the Pintos file system.
+
+   host.c supplies what filesys/ needs from the rest of the
+   kernel when it is compiled as an ordinary host program: a
+   file system block device backed by a file, a fake timer,
+   locks (see include/threads/synch.h), and panics.  Memory
+   comes from the host's malloc(). */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/* File system device. */
+bool host_disk_open (const char *file_name, block_sector_t size);
+void host_disk_close (void);
+
+/* Fake timer.  timer_ticks() returns the number of ticks the
+   caller has advanced it by, so runs are reproducible. */
+void host_timer_advance (int64_t ticks);
+
+/* Real time, for measurements. */
+uint64_t host_clock_ns (void);
+
+/* Called by PANIC and failed assertions before aborting, if
+   nonnull. */
+extern void (*host_panic_hook) (void);
+
+#endif /* fshost/host.h */
@@ -0,0 +1,13 @@
+#ifndef FSHOST_STDIO_H
+#define FSHOST_STDIO_H
+
+/* The host C library's <stdio.h>, plus the Pintos extensions
+   that kernel code compiled for the host expects. */
+
+#include_next <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+void hex_dump (uintptr_t ofs, const void *, size_t size, bool ascii);
+
+#endif /* fshost/include/stdio.h */
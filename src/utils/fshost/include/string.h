@@ -0,0 +1,12 @@
+#ifndef FSHOST_STRING_H
+#define FSHOST_STRING_H
+
+/* The host C library's <string.h>, plus the Pintos extensions
+   that kernel code compiled for the host expects. */
+
+#include_next <string.h>
+
+size_t strlcpy (char *, const char *, size_t);
+size_t strlcat (char *, const char *, size_t);
+
+#endif /* fshost/include/string.h */
@@ -0,0 +1,42 @@
+#ifndef THREADS_SYNCH_H
+#define THREADS_SYNCH_H
+
+/* Host replacement for threads/synch.h.
+
+   Locks and condition variables are built on POSIX threads so
+   that kernel code which synchronizes with them can run, and be
+   stressed, in an ordinary multithreaded process.  Semaphores
+   are not provided. */
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/* Lock. */
+struct lock 
+  {
+    pthread_mutex_t mutex;      /* Underlying mutex. */
+    pthread_t holder;           /* Thread holding lock, if HELD. */
+    bool held;                  /* True while some thread holds lock. */
+  };
+
+void lock_init (struct lock *);
+void lock_acquire (struct lock *);
+bool lock_try_acquire (struct lock *);
+void lock_release (struct lock *);
+bool lock_held_by_current_thread (const struct lock *);
+
+/* Condition variable. */
+struct condition 
+  {
+    pthread_cond_t cond;        /* Underlying condition variable. */
+  };
+
+void cond_init (struct condition *);
+void cond_wait (struct condition *, struct lock *);
+void cond_signal (struct condition *, struct lock *);
+void cond_broadcast (struct condition *, struct lock *);
+
+/* Optimization barrier. */
+#define barrier() __asm__ volatile ("" : : : "memory")
+
+#endif /* threads/synch.h */
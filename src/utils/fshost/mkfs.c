@@ -0,0 +1,256 @@
+/* pintos-mkfs: builds a Pintos file system image on the host.
+
+   Usage: pintos-mkfs [OPTION...] IMAGE
+
+   Creates IMAGE, a file system partition of --filesys-size
+   megabytes (default: 2), formats it, and copies into its root
+   directory each file named by a -p option, just as if the
+   kernel had run with -f and extracted them from the scratch
+   disk.  Each file's space is preallocated before its data is
+   written, so its sectors are allocated in one contiguous run,
+   interleaved with its indirect blocks, and are not zeroed
+   first.  Files marked with -z are stored compressed instead.
+   With --dedup, identical blocks of the files are then made to
+   share a single block, as filesys_dedup() does.  The file
+   system has blocks of --block-size sectors (default: 1), as
+   with the kernel's -fblock option.
+
+   The file system code is the kernel's own, compiled for the
+   host (see fshost.c), so the image is exactly what the kernel
+   would have written.  Use it as the file system partition of a
+   new disk with "pintos --filesys=IMAGE" or
+   "pintos-mkdisk --filesys=IMAGE", and don't pass -f to the
+   kernel. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "host.h"
+
+/* A file to copy into the image. */
+struct put 
+  {
+    const char *host_name;      /* Name on the host. */
+    const char *guest_name;     /* Name in the image. */
+    bool compress;              /* Store compressed? */
+  };
+
+static void usage (int exit_code);
+static bool put_file (const struct put *);
+
+int
+main (int argc, char *argv[]) 
+{
+  struct put *puts = calloc (argc, sizeof *puts);
+  size_t put_cnt = 0;
+  const char *image = NULL;
+  double size_mb = 2;
+  bool dedup = false;
+  block_sector_t sectors;
+  FILE *probe;
+  bool ok = true;
+  size_t i;
+  int arg;
+
+  for (arg = 1; arg < argc; arg++) 
+    {
+      const char *opt = argv[arg];
+      const char *value = NULL;
+
+      if (!strncmp (opt, "--filesys-size=", 15))
+        size_mb = strtod (opt + 15, NULL);
+      else if (!strncmp (opt, "--block-size=", 13)) 
+        {
+          fs_block_sectors = strtoul (opt + 13, NULL, 10);
+          if (fs_block_sectors < 1 || fs_block_sectors > MAX_BLOCK_SECTORS)
+            {
+              fprintf (stderr, "pintos-mkfs: block size must be 1 to %d "
+                       "sectors\n", MAX_BLOCK_SECTORS);
+              return EXIT_FAILURE;
+            }
+        }
+      else if (!strcmp (opt, "--dedup"))
+        dedup = true;
+      else if (!strncmp (opt, "--put-file=", 11))
+        value = opt + 11;
+      else if (!strcmp (opt, "-p") && arg + 1 < argc)
+        value = argv[++arg];
+      else if (!strcmp (opt, "--compress") || !strcmp (opt, "-z")) 
+        {
+          if (put_cnt == 0)
+            {
+              fprintf (stderr, "pintos-mkfs: %s must follow -p\n", opt);
+              return EXIT_FAILURE;
+            }
+          puts[put_cnt - 1].compress = true;
+          continue;
+        }
+      else if (!strncmp (opt, "--as=", 5) || !strcmp (opt, "-a")) 
+        {
+          if (put_cnt == 0)
+            {
+              fprintf (stderr, "pintos-mkfs: %s must follow -p\n", opt);
+              return EXIT_FAILURE;
+            }
+          if (opt[1] == 'a' && arg + 1 >= argc)
+            usage (EXIT_FAILURE);
+          puts[put_cnt - 1].guest_name = opt[1] == 'a' ? argv[++arg] : opt + 5;
+          continue;
+        }
+      else if (!strcmp (opt, "-h") || !strcmp (opt, "--help"))
+        usage (EXIT_SUCCESS);
+      else if (opt[0] == '-' || image != NULL)
+        usage (EXIT_FAILURE);
+      else
+        image = opt;
+
+      if (value != NULL) 
+        {
+          puts[put_cnt].host_name = puts[put_cnt].guest_name = value;
+          put_cnt++;
+        }
+    }
+  if (image == NULL)
+    usage (EXIT_FAILURE);
+
+  sectors = size_mb * 1024 * 1024 / BLOCK_SECTOR_SIZE;
+  if (sectors < 16)
+    {
+      fprintf (stderr, "pintos-mkfs: file system size too small\n");
+      return EXIT_FAILURE;
+    }
+  probe = fopen (image, "rb");
+  if (probe != NULL) 
+    {
+      fclose (probe);
+      fprintf (stderr, "pintos-mkfs: %s: already exists\n", image);
+      return EXIT_FAILURE;
+    }
+  if (!host_disk_open (image, sectors))
+    return EXIT_FAILURE;
+
+  filesys_init (true);
+  for (i = 0; i < put_cnt && ok; i++)
+    ok = put_file (&puts[i]);
+  if (ok && dedup)
+    {
+      int merged = filesys_dedup ();
+      if (merged < 0)
+        {
+          fprintf (stderr, "pintos-mkfs: out of memory\n");
+          ok = false;
+        }
+      else
+        printf ("Shared %d duplicate blocks.\n", merged);
+    }
+  filesys_done ();
+  host_disk_close ();
+
+  if (!ok)
+    {
+      remove (image);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/* Copies file P into the image.  Returns true if successful,
+   false after printing a message on failure. */
+static bool
+put_file (const struct put *p) 
+{
+  static char buf[65536];
+  struct file *file;
+  FILE *host;
+  long size;
+  off_t ofs;
+  bool ok = true;
+
+  host = fopen (p->host_name, "rb");
+  if (host == NULL)
+    {
+      perror (p->host_name);
+      return false;
+    }
+  if (fseek (host, 0, SEEK_END) != 0 || (size = ftell (host)) < 0)
+    {
+      perror (p->host_name);
+      fclose (host);
+      return false;
+    }
+  rewind (host);
+
+  printf ("Putting '%s' into the file system...\n", p->guest_name);
+  if ((off_t) size != size
+      || !filesys_create (p->guest_name, 0)
+      || (file = filesys_open (p->guest_name)) == NULL)
+    {
+      fprintf (stderr, "pintos-mkfs: %s: can't create file "
+               "(name invalid or in use, or file system full)\n",
+               p->guest_name);
+      fclose (host);
+      return false;
+    }
+  if (p->compress && !file_set_compressed (file, true))
+    {
+      fprintf (stderr, "pintos-mkfs: %s: can't compress\n", p->guest_name);
+      file_close (file);
+      fclose (host);
+      return false;
+    }
+  if (size > 0 && !file_allocate (file, 0, size))
+    {
+      fprintf (stderr, "pintos-mkfs: %s: file system full\n",
+               p->guest_name);
+      file_close (file);
+      fclose (host);
+      return false;
+    }
+
+  for (ofs = 0; ofs < size && ok; ) 
+    {
+      size_t chunk = size - ofs < (long) sizeof buf
+                     ? (size_t) (size - ofs) : sizeof buf;
+
+      if (fread (buf, 1, chunk, host) != chunk)
+        {
+          fprintf (stderr, "pintos-mkfs: %s: read failed\n", p->host_name);
+          ok = false;
+        }
+      else if (file_write (file, buf, chunk) != (off_t) chunk)
+        {
+          fprintf (stderr, "pintos-mkfs: %s: write failed\n", p->guest_name);
+          ok = false;
+        }
+      ofs += chunk;
+    }
+
+  file_close (file);
+  fclose (host);
+  return ok;
+}
+
+static void
+usage (int exit_code) 
+{
+  printf ("pintos-mkfs, a utility for building Pintos file system images\n"
+          "Usage: pintos-mkfs [OPTION...] IMAGE\n"
+          "where IMAGE is the file system partition image to create\n"
+          "  and each OPTION is one of the following options.\n"
+          "  --filesys-size=SIZE      Make IMAGE SIZE MB (default: 2)\n"
+          "  --block-size=SECTORS     Use blocks of SECTORS sectors, 1 to 8\n"
+          "                           (default: 1)\n"
+          "  -p, --put-file=HOSTFN    Copy HOSTFN into IMAGE, by default\n"
+          "                           under same name\n"
+          "  -a, --as=FILENAME        Specifies name in IMAGE for the\n"
+          "                           preceding -p\n"
+          "  -z, --compress           Store the preceding -p compressed\n"
+          "  --dedup                  Share identical blocks between\n"
+          "                           files\n"
+          "  -h, --help               Display this help message.\n"
+          "Use IMAGE with \"pintos --filesys=IMAGE\" or "
+          "\"pintos-mkdisk --filesys=IMAGE\".\n");
+  exit (exit_code);
+}